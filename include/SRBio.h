@@ -19,8 +19,14 @@
 #ifndef SRBIO_H
 #define SRBIO_H
 
+#include <stddef.h>
+#include <stdint.h>
 #include "SRBio_config.h"
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 #ifdef SRBIO_ILP64
 typedef long int SRB_INT;
 #else
@@ -61,26 +67,398 @@ struct rb_matrix_info {
     // for element-wise
 };
 
+// CSC with 64-bit colptr and 32-bit row indices for nnz past 2^31, in lp64
+// and ilp64 builds alike; rowind64 takes the rows' place when they do not
+// fit in 32 bits, see SRB_mixed_rowind
+struct rb_matrix_mixed {
+    char descr[73];
+    char key[9];
+    char mtype;
+    char stype;
+    char ftype;
+    int64_t rows;
+    int64_t cols;
+    int64_t nnz;
+
+    int64_t *colptr;
+    int32_t *rowind;        // rows <= INT32_MAX
+    int64_t *rowind64;      // otherwise
+    SRB_Scalar *valptr_d;
+    int64_t *valptr_i;
+};
+
 enum rb_file_compress {
     SRB_COMPRESS_NONE = 0,
     SRB_COMPRESS_GZIP,
     SRB_COMPRESS_BZIP2
 };
 
+// flags of rb_read_opts
+#define SRB_READ_PATTERN 0x1    // load colptr/rowind only, mtype becomes 'p'
+#define SRB_READ_ZERO_BASED 0x4 // colptr/rowind count from 0 as in scipy
+#define SRB_READ_NO_STORE 0x8   // parse for opts->stats only, colptr is all that is kept
+
+// thread pinning of a parallel load
+#define SRB_PIN_NONE    0       // leave the workers to the scheduler
+#define SRB_PIN_COMPACT 1       // worker t on the t-th allowed cpu
+#define SRB_PIN_SPREAD  2       // workers evenly over the allowed cpus
+#define SRB_PIN_LIST    3       // worker t on cpus[t]
+
+// options for SRB_read_ex
+//
+// the transform is applied while the blocks are parsed, the stored matrix is
+// P_r * (D_r * A * D_c) * P_c^T; permutations and scale vectors are indexed
+// from 0 by the original row/column, NULL skips a step. Scaling and dropping
+// only touch real values; row indices within a column keep the file order.
+struct rb_read_opts {
+    int flags;
+    const SRB_INT *row_perm;        // original row i is stored as row_perm[i]
+    const SRB_INT *col_perm;        // original column j is stored as col_perm[j]
+    const SRB_Scalar *row_scale;    // D_r
+    const SRB_Scalar *col_scale;    // D_c
+    double drop_tol;                // drop |a_ij| < drop_tol after scaling, 0: keep all
+
+    // parallel load: with nthreads > 0, worker t first-touches columns
+    // [col_part[t], col_part[t + 1]) of colptr and their rowind/value ranges
+    // so the pages land on its NUMA node; the text is still parsed in order
+    int nthreads;
+    const SRB_INT *col_part;        // nthreads + 1 offsets from 0, NULL: even split
+    int pin;                        // SRB_PIN_*
+    const int *cpus;                // SRB_PIN_LIST
+
+    struct rb_stats *stats;         // filled in while parsing, NULL: none
+    uint64_t *fingerprint;          // 2 words, see below, NULL: none
+};
+
+// structure of the file as stored, before any transform; rows and columns
+// count from 1 and stored triangles are not expanded
+#define SRB_STATS_BINS 64
+
+struct rb_stats {
+    SRB_INT colhist[SRB_STATS_BINS];    // [0]: empty columns, [b]: 2^(b-1) <= nnz < 2^b
+    SRB_INT colnnz_min;
+    SRB_INT colnnz_max;
+    SRB_INT lower;          // entries with i > j
+    SRB_INT upper;          // entries with i < j
+    SRB_INT diag;           // diagonal entries
+    SRB_INT diag_missing;   // j <= min(rows, cols) without a diagonal entry
+    SRB_INT bw_lower;       // max i - j
+    SRB_INT bw_upper;       // max j - i
+    long long profile;      // sum over columns of j - (first row), if above the
+                            // diagonal; of (last row) - j for 's'/'z'/'h'
+    int values;             // 0: the value stats below were not collected
+    SRB_INT zeros;          // explicit zeros
+    double min_abs;         // smallest nonzero magnitude
+    double max_abs;
+};
+
+// a fingerprint is a 128-bit hash of the matrix as stored in the file:
+// rows, cols, nnz, mtype/stype/ftype, colptr, rowind and values. It does not
+// depend on the card layout, number formatting or compression, and the
+// writer hashes the values as they are printed, so reading a file back
+// gives the fingerprint of its save. Transforms of rb_read_opts are not
+// seen; SRB_READ_PATTERN hashes the pattern matrix.
+
+// block compressed rows for SpMV, from 0; blocks are r x c and row-major,
+// `values` is 64-byte aligned and holds explicit zeros of partial blocks
+struct rb_bsr {
+    SRB_INT rows;
+    SRB_INT cols;
+    SRB_INT r;
+    SRB_INT c;
+    SRB_INT mb;             // block rows
+    SRB_INT nb;             // block cols
+    SRB_INT nnz;            // nonzeros, stored triangles are expanded
+    SRB_INT nnzb;
+    SRB_INT *rowptr;        // mb + 1
+    SRB_INT *colind;        // nnzb block columns, sorted in each block row
+    SRB_Scalar *values;     // nnzb * r * c
+    double fill;            // stored values / nnz
+};
+
+// SELL-C-sigma, from 0: rows are sorted by length within windows of sigma
+// rows and packed in chunks of C, column-major in each chunk; the entry q of
+// slot s in chunk k is at chunkptr[k] + q * C + s, padding is (col 0, 0.0)
+struct rb_sell {
+    SRB_INT rows;
+    SRB_INT cols;
+    SRB_INT nnz;
+    SRB_INT C;
+    SRB_INT sigma;
+    SRB_INT nchunks;
+    SRB_INT *chunkptr;      // nchunks + 1
+    SRB_INT *chunklen;      // nchunks
+    SRB_INT *perm;          // rows, original row of each slot
+    SRB_INT *colind;
+    SRB_Scalar *values;     // 64-byte aligned
+    double fill;            // stored values / nnz
+};
+
+// codec and buffering parameters for SRB_write_ex,
+// fields left at -1 (or 0 for buffer_size) use the default
+struct rb_write_opts {
+    int level;          // gzip: 0-9, default 6
+    int strategy;       // gzip: Z_DEFAULT_STRATEGY, Z_FILTERED, Z_HUFFMAN_ONLY, Z_RLE
+    int window_bits;    // gzip: log2 of the window size, 9-15, default 15
+    int mem_level;      // gzip: 1-9, default 8
+    int block_size;     // bzip2: block size in units of 100k, 1-9, default 9
+    int work_factor;    // bzip2: 0-250, default 30
+    size_t buffer_size; // bytes batched before handing over to the codec
+    uint64_t *fingerprint;  // 2 words of the matrix as written, NULL: none;
+                            // not computed for SRB_WRITE_SHARDS
+};
+
+// growable output buffer for SRB_write_mem, data is appended at `size`
+struct rb_buffer {
+    char *data;
+    size_t size;
+    size_t capacity;
+};
+
+// result of SRB_diff, rows and columns count from 1; an entry present in
+// one file only is compared against 0 in the norms
+#define SRB_DIFF_REPORT 10
+
+struct rb_diff_entry {
+    SRB_INT row;
+    SRB_INT col;
+    double a;
+    double b;
+    char kind;          // 'v': values differ, 'a'/'b': only in A/B
+};
+
+struct rb_diff {
+    int equal;          // same pattern and all values within the tolerance
+    int header;         // 0: shape or symmetry differ, nothing else compared
+    int values;         // 0: a pattern file, values are not compared
+    SRB_INT common;     // entries in both patterns
+    SRB_INT only_a;
+    SRB_INT only_b;
+    SRB_INT mismatched; // common entries outside the tolerance
+    double max_abs;
+    double max_rel;     // |a - b| / max(|a|, |b|)
+    double norm_diff;   // Frobenius norms of the stored entries
+    double norm_a;
+    double norm_b;
+    int nreport;        // the first differences in column order
+    struct rb_diff_entry report[SRB_DIFF_REPORT];
+};
+
+// may be or-ed into the compress flag: open uncompressed files with
+// O_DIRECT (io_uring backend only)
+#define SRB_IO_DIRECT 0x100
+// may be or-ed into the compress flag of the writers: detect symmetric or
+// skew-symmetric 'u' matrices and store their lower triangle only
+#define SRB_WRITE_SYMMETRY 0x200
+// may be or-ed into the compress flag of the writers: colptr/rowind of the
+// matrix count from 0
+#define SRB_WRITE_ZERO_BASED 0x400
+// may be or-ed into the compress flag of the readers: read gzip files with
+// gzgets only, neither using nor creating the filename.zidx access-point
+// index that otherwise lets large files be inflated by several threads
+#define SRB_GZIP_NO_INDEX 0x800
+// may be or-ed into the compress flag of the writers: write filename as a
+// manifest of n column blocks, saved concurrently as filename.0, .1, ...
+// (each an ordinary RB file), see SRB_read_shards
+#define SRB_SHARDS_SHIFT 16
+#define SRB_SHARDS_MASK 0xff0000
+#define SRB_WRITE_SHARDS(n) ((rb_file_compress_t)(((n) & 0xff) << SRB_SHARDS_SHIFT))
+#define SRB_COMPRESS_MASK 0xff
+
 typedef struct rb_matrix_info rb_matrix_info_t;
+typedef struct rb_matrix_mixed rb_matrix_mixed_t;
+typedef struct rb_read_opts rb_read_opts_t;
+typedef struct rb_write_opts rb_write_opts_t;
+typedef struct rb_buffer rb_buffer_t;
+typedef struct rb_bsr rb_bsr_t;
+typedef struct rb_sell rb_sell_t;
+typedef struct rb_cache rb_cache_t;
+typedef struct rb_tar rb_tar_t;
+typedef struct rb_diff rb_diff_t;
+typedef struct rb_stats rb_stats_t;
+typedef struct rb_parser rb_parser_t;
+typedef struct rb_context rb_context_t;
+typedef struct rb_shm rb_shm_t;
+typedef struct rb_lines rb_lines_t;
 typedef enum rb_file_compress rb_file_compress_t;
 
 typedef void *(*SRB_open_f)(const char *, const char *);
 typedef void (*SRB_close_f)(void *);
 typedef char *(*SRB_gets_f)(char *, int, void *);
 typedef int (*SRB_puts_f)(const char*, void*);
+typedef long (*SRB_read_f)(void*, size_t, void*);
+typedef int (*SRB_write_f)(const void*, size_t, void*);
 
 int SRB_read(const char *, rb_matrix_info_t*, rb_file_compress_t);
+int SRB_read_ex(const char *, rb_matrix_info_t*, rb_file_compress_t, const rb_read_opts_t*);
+int SRB_read_mem(const void *, size_t, rb_matrix_info_t*, rb_file_compress_t);
+void SRB_read_opts_init(rb_read_opts_t*);
+
+// loads a file as rb_matrix_mixed_t, the row index width is picked from the
+// header's row count; opts may only carry SRB_READ_PATTERN and
+// SRB_READ_ZERO_BASED (-999 otherwise). SRB_read fails with -999 on files
+// whose nnz overflows SRB_INT, they are read with this instead.
+int SRB_read_mixed(const char *, rb_matrix_mixed_t*, rb_file_compress_t, const rb_read_opts_t*);
+void SRB_mixed_init(rb_matrix_mixed_t*);
+void SRB_mixed_destroy(rb_matrix_mixed_t*);
+
+// row index k of either width
+static inline int64_t SRB_mixed_rowind(const rb_matrix_mixed_t *mat, int64_t k){
+    return mat->rowind != NULL ? mat->rowind[k] : mat->rowind64[k];
+}
+
 int SRB_write(const char *, const rb_matrix_info_t*, rb_file_compress_t);
 int SRB_write_p(const char *, const rb_matrix_info_t*, int, rb_file_compress_t);
+int SRB_write_ex(const char *, const rb_matrix_info_t*, int, rb_file_compress_t, const rb_write_opts_t*);
+int SRB_write_mem(rb_buffer_t*, const rb_matrix_info_t*, int, rb_file_compress_t, const rb_write_opts_t*);
+void SRB_write_opts_init(rb_write_opts_t*);
+void SRB_buffer_init(rb_buffer_t*);
+void SRB_buffer_free(rb_buffer_t*);
+
+// text lines through the library's decoders and encoders, for card kernels
+// outside of it (SRBio.hpp); nothing here depends on SRB_INT or SRB_Scalar.
+// Mode "r" or "w", opts are the encoder's and may be NULL.
+rb_lines_t *SRB_lines_open(const char *, const char *, rb_file_compress_t,
+        const rb_write_opts_t*, int*);
+char *SRB_lines_gets(rb_lines_t*, char*, int);
+int SRB_lines_write(rb_lines_t*, const char*, size_t);
+int SRB_lines_close(rb_lines_t*);
+
+// a context keeps what every call would otherwise set up again: a pool of
+// nthreads - 1 workers for the parallel modes (nthreads <= 0: one thread per
+// online cpu), the decode/encode buffers and zlib states, and the options
+// SRB_read_ctx/SRB_write_ctx fall back to when given NULL. It serves one
+// call at a time.
+rb_context_t *SRB_context_create(int);
+void SRB_context_destroy(rb_context_t*);
+int SRB_context_threads(const rb_context_t*);
+rb_read_opts_t *SRB_context_read_opts(rb_context_t*);
+rb_write_opts_t *SRB_context_write_opts(rb_context_t*);
+int SRB_read_ctx(rb_context_t*, const char *, rb_matrix_info_t*, rb_file_compress_t,
+        const rb_read_opts_t*);
+int SRB_write_ctx(rb_context_t*, const char *, const rb_matrix_info_t*, int,
+        rb_file_compress_t, const rb_write_opts_t*);
+
+// shared read-only matrices, keyed by path and file identity
+rb_cache_t *SRB_cache_create(size_t);
+void SRB_cache_destroy(rb_cache_t*);
+void SRB_cache_set_budget(rb_cache_t*, size_t);
+size_t SRB_cache_usage(rb_cache_t*);
+const rb_matrix_info_t *SRB_cache_get(rb_cache_t*, const char *, rb_file_compress_t, int*);
+void SRB_cache_release(rb_cache_t*, const rb_matrix_info_t*);
+
+// matrices shared with other processes in a POSIX shared memory object:
+// SRB_shm_publish copies a matrix into a new object `name` (SRB_shm_load
+// parses a file into one), SRB_shm_attach maps it read-only without parsing.
+// Every handle holds a reference in the object, it is removed once the last
+// handle is detached; SRB_shm_unlink removes a name left behind by a process
+// that died holding one. Publisher and attachers are built with the same
+// SRB_INT and SRB_Scalar.
+rb_shm_t *SRB_shm_publish(const char *, const rb_matrix_info_t*, int*);
+rb_shm_t *SRB_shm_load(const char *, const char *, rb_file_compress_t, int*);
+rb_shm_t *SRB_shm_attach(const char *, int*);
+const rb_matrix_info_t *SRB_shm_matrix(const rb_shm_t*);
+void SRB_shm_detach(rb_shm_t*);
+int SRB_shm_unlink(const char *);
+
+// streaming tar reader: SRB_tar_next steps to the next regular member
+// (1, or 0 at the end, negative if the archive is damaged), SRB_tar_read
+// parses the current member
+rb_tar_t *SRB_tar_open(const char *, rb_file_compress_t);
+int SRB_tar_next(rb_tar_t*, const char **, size_t*);
+int SRB_tar_read(rb_tar_t*, rb_matrix_info_t*, const rb_read_opts_t*);
+void SRB_tar_close(rb_tar_t*);
+int SRB_read_tar(const char *, rb_file_compress_t, const char *, rb_matrix_info_t*);
+
+// push parser for text that arrives in chunks: SRB_parser_feed takes the
+// next bytes (cards may be split anywhere) and returns 0 for more input, 1
+// once the matrix is complete, negative as SRB_read on failure;
+// SRB_parser_finish ends the input and leaves the matrix in the
+// rb_matrix_info_t given to SRB_parser_create. Plain text only, the
+// options are limited to the flags, stats and fingerprint.
+rb_parser_t *SRB_parser_create(rb_matrix_info_t*, const rb_read_opts_t*);
+int SRB_parser_feed(rb_parser_t*, const void *, size_t);
+int SRB_parser_finish(rb_parser_t*);
+void SRB_parser_destroy(rb_parser_t*);
+
+// loads the shards of a manifest concurrently into one matrix
+int SRB_read_shards(const char *, rb_matrix_info_t*);
+
+// NUMA nodes of the pages of [addr, addr + bytes): count[i] pages on node i,
+// returns the pages not resident or beyond nnodes, negative on failure
+long SRB_numa_pages(const void *, size_t, long *, int);
+
+// compares two files column by column while both are parsed, entries match
+// if |a - b| <= atol + rtol * max(|a|, |b|)
+int SRB_diff(const char *, rb_file_compress_t, const char *, rb_file_compress_t,
+        double, double, rb_diff_t*);
+
+// out-of-core conversion of a file into another: the input is streamed
+// twice, the entries are spread over buckets of result columns that are
+// spilled to a temporary out.spill.XXXXXX and sorted one by one within
+// `budget` bytes (0: 256 MB); precision and flags as in SRB_write_p
+#define SRB_CONVERT_TRANSPOSE 0x1   // store A^T
+#define SRB_CONVERT_EXPAND 0x2      // store both triangles of 's'/'z'/'h', stype becomes 'u'
+
+int SRB_convert(const char *, rb_file_compress_t, const char *, int, rb_file_compress_t,
+        int, size_t);
+
+// copies a file into another codec as it is: the text is decoded in the
+// caller's thread and encoded in blocks by nthreads - 1 workers (nthreads
+// <= 0: one per online cpu), a few blocks per thread are kept in memory.
+// gzip output is one member, bzip2 output one stream per block as pbzip2
+// writes it. SRB_RECOMPRESS_CHECK parses the header and counts the cards
+// against it, the numbers are not looked at.
+#define SRB_RECOMPRESS_CHECK 0x1
+
+int SRB_recompress(const char *, rb_file_compress_t, const char *, rb_file_compress_t,
+        const rb_write_opts_t*, int, int);
+
+// 's', 'z' or 'u' from a transpose comparison of a square matrix
+char SRB_symmetry(const rb_matrix_info_t*);
+
+// CSC of nnz unsorted triplets (rowind[k], colind[k], val[k]), duplicates
+// summed in the order they come; val NULL gives a pattern matrix. The
+// result is what SRB_write_p takes, descr and key are left to the caller.
+// The triplets are scattered straight into the result, which is sorted and
+// merged in place and then shrunk to the merged count.
+#define SRB_COO_ZERO_BASED 0x1  // triplet indices count from 0
+#define SRB_COO_LOWER 0x2       // square input, keep i >= j only, stype becomes 's'
+
+int SRB_from_coo(rb_matrix_info_t*, SRB_INT, SRB_INT, SRB_INT,
+        const SRB_INT*, const SRB_INT*, const SRB_Scalar*, int);
+
+// blocked formats, r/c/C/sigma <= 0 pick the defaults; -1 if colptr is not
+// 1-based and non-decreasing up to nnz + 1 or a row index is out of range
+int SRB_bsr_detect(const rb_matrix_info_t*, SRB_INT*, SRB_INT*, double*);
+int SRB_to_bsr(const rb_matrix_info_t*, SRB_INT, SRB_INT, rb_bsr_t*);
+int SRB_to_sell(const rb_matrix_info_t*, SRB_INT, SRB_INT, rb_sell_t*);
+int SRB_read_bsr(const char *, rb_file_compress_t, SRB_INT, SRB_INT, rb_bsr_t*);
+int SRB_read_sell(const char *, rb_file_compress_t, SRB_INT, SRB_INT, rb_sell_t*);
+void SRB_bsr_free(rb_bsr_t*);
+void SRB_sell_free(rb_sell_t*);
+
+// the integer parse/format kernels are picked from the cpu when the library
+// is loaded, or named by the environment variable SRBIO_KERNEL (generic,
+// sse4.2, avx2, avx512); SRB_kernel_set forces a level, -999 if the cpu has
+// not got it, -1 goes back to the cpu's pick. Not to be called while the
+// library is in use by other threads.
+#define SRB_KERNEL_GENERIC 0
+#define SRB_KERNEL_SSE42 1
+#define SRB_KERNEL_AVX2 2
+#define SRB_KERNEL_AVX512 3
+
+int SRB_kernel_get(void);
+int SRB_kernel_set(int);
+const char *SRB_kernel_name(int);
+
 void SRB_init(rb_matrix_info_t*);
 void SRB_destroy(rb_matrix_info_t*);
 void SRB_print(const rb_matrix_info_t*);
 int SRB_digits(SRB_INT);
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif
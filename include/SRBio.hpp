@@ -0,0 +1,461 @@
+/*
+ * ===========================================================================
+ *
+ *       Filename:  SRBio.hpp
+ *
+ *    Description:  header-only C++ interface templated on index/scalar type
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 11:02:41 AM
+ *       Revision:  none
+ *       Compiler:  g++
+ *
+ *         Author:  Haoyang Liu (), liuhaoyang@pku.edu.cn
+ *   Organization:  BICMR, Peking University
+ *
+ * ===========================================================================
+ */
+
+#ifndef SRBIO_HPP
+#define SRBIO_HPP
+
+// Usage:
+//
+//   srbio::matrix<int32_t, double> A;
+//   int info = srbio::read("A.rb.gz", A, SRB_COMPRESS_GZIP);
+//
+// or, for caller-owned storage (std::vector, std::span, srbio::view):
+//
+//   srbio::reader<int64_t, float> r("A.rb", SRB_COMPRESS_NONE);
+//   std::vector<int64_t> colptr(r.info().cols + 1), rowind(r.info().nnz);
+//   std::vector<float> val(r.info().nnz);
+//   r.read(colptr, rowind, val);
+//
+// Numbers are parsed straight into the caller's index and scalar types, and
+// formatted from them, by the kernels below. The library only carries the
+// text lines (SRB_lines_*, through its decoders and encoders), so the
+// SRBIO_ILP64 and SRBIO_*_PRECISION macros play no part and any SRBio_*
+// library can be linked. The transforms of rb_read_opts are C only.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#if __cplusplus >= 202002L && __has_include(<span>)
+#include <span>
+#endif
+
+#include "SRBio.h"
+
+namespace srbio {
+
+struct header {
+    std::string descr;
+    std::string key;
+    char mtype = 'r';
+    char stype = 'u';
+    char ftype = 'a';
+    std::int64_t rows = 0;
+    std::int64_t cols = 0;
+    std::int64_t nnz = 0;
+};
+
+// non-owning contiguous storage, for pre-C++20 callers
+template <typename T>
+struct view {
+    T *data;
+    std::size_t size;
+};
+
+namespace detail {
+
+inline void rstrip(std::string &str){
+    std::size_t n = str.find_last_not_of(" \r\n");
+    str.erase(n == std::string::npos ? 0 : n + 1);
+}
+
+inline int digits(std::int64_t v){
+    int i = 1;
+    while ((v = v / 10) != 0) ++i;
+    return i;
+}
+
+// whether every index of a matrix of this shape fits in Index
+template <typename Index>
+bool fits(std::int64_t rows, std::int64_t cols, std::int64_t nnz){
+    if constexpr (std::is_integral_v<Index>){
+        const std::int64_t top = static_cast<std::int64_t>(
+                std::numeric_limits<Index>::max() < std::numeric_limits<std::int64_t>::max() ?
+                std::numeric_limits<Index>::max() : std::numeric_limits<std::int64_t>::max());
+        return rows <= top && cols <= top && nnz < top;
+    } else {
+        return true;
+    }
+}
+
+// integer field into T, digits are accumulated at the width of T; false
+// when the card has no number left
+template <typename T>
+inline bool parse_int(const char *&p, const char *end, T &out){
+    using acc_t = std::conditional_t<std::is_integral_v<T> && sizeof(T) <= 4,
+          std::uint32_t, std::uint64_t>;
+    const char *q = p;
+    while (q < end && (*q == ' ' || *q == '\t')) ++q;
+    bool neg = false;
+    if (q < end && (*q == '-' || *q == '+'))
+        neg = *q++ == '-';
+    if (q == end || static_cast<unsigned>(*q - '0') >= 10u)
+        return false;
+    acc_t v = 0;
+    for (; q < end && static_cast<unsigned>(*q - '0') < 10u; ++q)
+        v = static_cast<acc_t>(v * 10 + static_cast<acc_t>(*q - '0'));
+    p = q;
+    if constexpr (std::is_integral_v<T>)
+        out = static_cast<T>(neg ? acc_t(0) - v : v);
+    else
+        out = static_cast<T>(neg ? -static_cast<long double>(v) : static_cast<long double>(v));
+    return true;
+}
+
+// real field into T, converted once at the precision of T
+template <typename T>
+inline bool parse_real(const char *&p, T &out){
+    char *e;
+    if constexpr (std::is_same_v<T, float>)
+        out = std::strtof(p, &e);
+    else if constexpr (std::is_same_v<T, long double>)
+        out = std::strtold(p, &e);
+    else
+        out = static_cast<T>(std::strtod(p, &e));
+    if (e == p)
+        return false;
+    p = e;
+    return true;
+}
+
+// `count` numbers on `ncrd` cards: every card is parsed until it runs out,
+// as SRB_card_ints does, so a card need not hold count / ncrd of them.
+// -1 if a card is missing or the block comes up short
+template <bool Real, typename T>
+int read_block(rb_lines_t *s, std::int64_t ncrd, std::int64_t count, T *out){
+    char buffer[SRBIO_LINE_MAX + 2];
+    std::int64_t n = 0;
+    for (std::int64_t i = 0; i < ncrd; ++i){
+        const char *p = SRB_lines_gets(s, buffer, SRBIO_LINE_MAX + 2);
+        if (p == nullptr)
+            return -1;
+        const char *end = p + std::strlen(p);
+        if constexpr (Real){
+            while (n < count && parse_real(p, out[n])) ++n;
+        } else {
+            while (n < count && parse_int(p, end, out[n])) ++n;
+        }
+    }
+    return n < count ? -1 : 0;
+}
+
+// integer field right-aligned in `width`, wider numbers are not cut;
+// returns the chars written
+template <typename T>
+inline int format_int(char *dst, int width, T v){
+    using mag_t = std::conditional_t<std::is_integral_v<T> && sizeof(T) <= 4,
+          std::uint32_t, std::uint64_t>;
+    char tmp[24];
+    int n = 0;
+    bool neg;
+    mag_t m;
+    if constexpr (std::is_integral_v<T>){
+        neg = v < T(0);
+        m = neg ? mag_t(0) - static_cast<mag_t>(v) : static_cast<mag_t>(v);
+    } else {
+        long long w = static_cast<long long>(v);
+        neg = w < 0;
+        m = neg ? 0 - static_cast<mag_t>(w) : static_cast<mag_t>(w);
+    }
+    do {
+        tmp[n++] = static_cast<char>('0' + m % 10);
+        m /= 10;
+    } while (m != 0);
+    if (neg) tmp[n++] = '-';
+    int pad = width > n ? width - n : 0;
+    std::memset(dst, ' ', pad);
+    for (int j = 0; j < n; ++j)
+        dst[pad + j] = tmp[n - 1 - j];
+    return pad + n;
+}
+
+template <typename T>
+inline int format_real(char *dst, int size, int width, int precision, T v){
+    if constexpr (std::is_same_v<T, long double>)
+        return std::snprintf(dst, size, "%*.*Le", width, precision, v);
+    else
+        return std::snprintf(dst, size, "%*.*e", width, precision, static_cast<double>(v));
+}
+
+// `count` numbers, `per_line` to a card
+template <bool Real, typename T>
+int write_block(rb_lines_t *s, std::int64_t count, int per_line, int width, int precision,
+        const T *in){
+    // room for fields wider than the format
+    const int field = (width > 48 ? width : 48) + 1;
+    std::vector<char> card(static_cast<std::size_t>(per_line) * field + 2);
+    std::int64_t n = 0;
+    while (n < count){
+        int pos = 0;
+        for (int j = 0; j < per_line && n < count; ++j, ++n){
+            if constexpr (Real)
+                pos += format_real(card.data() + pos, field + 1, width, precision, in[n]);
+            else
+                pos += format_int(card.data() + pos, width, in[n]);
+        }
+        card[pos++] = '\n';
+        if (SRB_lines_write(s, card.data(), pos) != 0)
+            return -1;
+    }
+    return 0;
+}
+
+} // namespace detail
+
+// storage adaptors: return a pointer to at least n elements, or nullptr
+template <typename T>
+T *prepare(std::vector<T> &v, std::size_t n){
+    v.resize(n);
+    return v.data();
+}
+
+template <typename T>
+T *prepare(view<T> v, std::size_t n){
+    return v.size >= n ? v.data : nullptr;
+}
+
+#ifdef __cpp_lib_span
+template <typename T, std::size_t E>
+T *prepare(std::span<T, E> s, std::size_t n){
+    return s.size() >= n ? s.data() : nullptr;
+}
+#endif
+
+// the constructor parses lines 1-4, read() the blocks into the targets
+template <typename Index, typename Scalar>
+class reader {
+public:
+    reader(const char *filename, rb_file_compress_t flag){
+        s_ = SRB_lines_open(filename, "r", flag, nullptr, &info_);
+        if (info_ == 0)
+            info_ = read_header();
+    }
+
+    reader(const reader&) = delete;
+    reader &operator=(const reader&) = delete;
+    ~reader(){ SRB_lines_close(s_); }
+
+    // 0 if the header was parsed, otherwise the same codes as SRB_read
+    int status() const { return info_; }
+    const header &info() const { return h_; }
+
+    // values may be a dummy (e.g. empty vector) for pattern matrices;
+    // -5 if a target is too small or Index cannot hold the indices
+    template <typename PtrTarget, typename IndTarget, typename ValTarget>
+    int read(PtrTarget &&colptr, IndTarget &&rowind, ValTarget &&values){
+        if (info_ != 0)
+            return info_;
+        if (!detail::fits<Index>(h_.rows, h_.cols, h_.nnz))
+            return info_ = -5;
+        Index *ptr = prepare(colptr, static_cast<std::size_t>(h_.cols + 1));
+        Index *ind = prepare(rowind, static_cast<std::size_t>(h_.nnz));
+        if (ptr == nullptr || ind == nullptr)
+            return info_ = -5;
+
+        if (detail::read_block<false>(s_, ptrcrd_, h_.cols + 1, ptr) != 0)
+            return info_ = -1;
+        if (detail::read_block<false>(s_, indcrd_, h_.nnz, ind) != 0)
+            return info_ = -2;
+
+        switch (h_.mtype){
+            case 'r':
+            case 'i': {
+                Scalar *val = prepare(values, static_cast<std::size_t>(h_.nnz));
+                if (val == nullptr)
+                    return info_ = -5;
+                int ret = h_.mtype == 'r' ?
+                    detail::read_block<true>(s_, valcrd_, h_.nnz, val) :
+                    detail::read_block<false>(s_, valcrd_, h_.nnz, val);
+                if (ret != 0)
+                    return info_ = -3;
+                break;
+            }
+            case 'p':
+                break;
+            case 'c':
+            case 'q':
+                return info_ = -999;
+            default:
+                return info_ = -41;
+        }
+        return 0;
+    }
+
+private:
+    int read_header(){
+        char buffer[SRBIO_LINE_MAX + 2];
+        long long totcrd, ptrcrd, indcrd, valcrd, rows, cols, nnz;
+
+        // line 1: title and id
+        if (!SRB_lines_gets(s_, buffer, SRBIO_LINE_MAX + 2))
+            return -1;
+        std::size_t len = std::strlen(buffer);
+        h_.descr.assign(buffer, len < 72 ? len : 72);
+        h_.key.assign(len > 72 ? buffer + 72 : "", len > 72 ? (len - 72 < 8 ? len - 72 : 8) : 0);
+        detail::rstrip(h_.descr);
+        detail::rstrip(h_.key);
+
+        // line 2: lines info
+        if (!SRB_lines_gets(s_, buffer, SRBIO_LINE_MAX + 2))
+            return -2;
+        if (std::sscanf(buffer, "%lld %lld %lld %lld", &totcrd, &ptrcrd, &indcrd, &valcrd) != 4)
+            return -2;
+        ptrcrd_ = ptrcrd;
+        indcrd_ = indcrd;
+        valcrd_ = valcrd;
+
+        // line 3: matrix info
+        if (!SRB_lines_gets(s_, buffer, SRBIO_LINE_MAX + 2))
+            return -3;
+        if (std::sscanf(buffer, "%c%c%c", &h_.mtype, &h_.stype, &h_.ftype) != 3)
+            return -3;
+        if (h_.mtype < 'a') h_.mtype += 'a' - 'A';
+        if (h_.stype < 'a') h_.stype += 'a' - 'A';
+        if (h_.ftype < 'a') h_.ftype += 'a' - 'A';
+        if (h_.ftype == 'e')
+            return -999;
+        if (h_.ftype != 'a')
+            return -31;
+        if (std::sscanf(buffer + 3, "%lld %lld %lld", &rows, &cols, &nnz) != 3 ||
+                rows < 0 || cols < 0 || nnz < 0)
+            return -3;
+        h_.rows = rows;
+        h_.cols = cols;
+        h_.nnz = nnz;
+
+        // line 4: fortran format info, discarded
+        if (!SRB_lines_gets(s_, buffer, SRBIO_LINE_MAX + 2))
+            return -4;
+        return 0;
+    }
+
+    rb_lines_t *s_ = nullptr;
+    header h_;
+    std::int64_t ptrcrd_ = 0;
+    std::int64_t indcrd_ = 0;
+    std::int64_t valcrd_ = 0;
+    int info_ = 0;
+};
+
+template <typename Index, typename Scalar>
+struct matrix {
+    header info;
+    std::vector<Index> colptr;
+    std::vector<Index> rowind;
+    std::vector<Scalar> values;
+};
+
+template <typename Index, typename Scalar>
+int read(const char *filename, matrix<Index, Scalar> &mat,
+        rb_file_compress_t flag = SRB_COMPRESS_NONE){
+    reader<Index, Scalar> r(filename, flag);
+    if (r.status() != 0)
+        return r.status();
+    mat.info = r.info();
+    mat.values.clear();
+    return r.read(mat.colptr, mat.rowind, mat.values);
+}
+
+// write a csc matrix given by raw arrays in the card layout of SRB_write_p,
+// precision < 0 picks 7 for float and 15 for double; opts go to the encoder
+template <typename Index, typename Scalar>
+int write(const char *filename, const header &h, const Index *colptr,
+        const Index *rowind, const Scalar *values, int precision = -1,
+        rb_file_compress_t flag = SRB_COMPRESS_NONE,
+        const rb_write_opts_t *opts = nullptr){
+    if (h.ftype != 'a' || h.mtype == 'c' || h.mtype == 'q')
+        return -999;
+
+    if (precision < 0)
+        precision = std::is_floating_point_v<Scalar> ?
+            static_cast<int>(2 * sizeof(Scalar) - 1) : 15;
+    if (precision > SRBIO_MAX_PRECISION)
+        precision = SRBIO_MAX_PRECISION;
+
+    int ret;
+    rb_lines_t *s = SRB_lines_open(filename, "w", flag, opts, &ret);
+    if (s == nullptr)
+        return ret;
+
+    // same card layout as SRB_write_csc_header
+    int ptr_w = 1 + detail::digits(1 + h.nnz);
+    int ptr_n = SRBIO_LINE_MAX / ptr_w;
+    std::int64_t ptrcrd = (1 + h.cols + ptr_n - 1) / ptr_n;
+    int ind_w = 1 + detail::digits(h.rows);
+    int ind_n = SRBIO_LINE_MAX / ind_w;
+    std::int64_t indcrd = (h.nnz + ind_n - 1) / ind_n;
+    int val_w = h.mtype == 'r' ? 9 + precision : (h.mtype == 'i' ? 10 : 1);
+    int val_n = SRBIO_LINE_MAX / val_w;
+    std::int64_t valcrd = 0;
+    if (h.mtype == 'r' || h.mtype == 'i')
+        valcrd = (h.nnz + val_n - 1) / val_n;
+    else
+        val_n = 0;
+
+    char buffer[4 * (SRBIO_LINE_MAX + 2)];
+    char ptrfmt[17], indfmt[17], valfmt[21] = {'\0'};
+    int len = std::snprintf(buffer, SRBIO_LINE_MAX + 2, "%-72.72s%-8.8s\n",
+            h.descr.c_str(), h.key.c_str());
+    len += std::snprintf(buffer + len, SRBIO_LINE_MAX + 2, "%14lld %13lld %13lld %13lld\n",
+            static_cast<long long>(ptrcrd + indcrd + valcrd), static_cast<long long>(ptrcrd),
+            static_cast<long long>(indcrd), static_cast<long long>(valcrd));
+    len += std::snprintf(buffer + len, SRBIO_LINE_MAX + 2, "%c%c%c            %13lld %13lld %13lld %13ld\n",
+            h.mtype, h.stype, h.ftype, static_cast<long long>(h.rows),
+            static_cast<long long>(h.cols), static_cast<long long>(h.nnz), 0L);
+    std::snprintf(ptrfmt, 17, "(%dI%d)", ptr_n, ptr_w);
+    std::snprintf(indfmt, 17, "(%dI%d)", ind_n, ind_w);
+    if (h.mtype == 'r')
+        std::snprintf(valfmt, 21, "(%dE%d.%d)", val_n, val_w, precision);
+    else
+        std::snprintf(valfmt, 21, "(%dI%d)", val_n, val_w);
+    len += std::snprintf(buffer + len, SRBIO_LINE_MAX + 2, "%-16s%-16s%-20s\n",
+            ptrfmt, indfmt, valfmt);
+    SRB_lines_write(s, buffer, len);
+
+    ret = 0;
+    if (detail::write_block<false>(s, h.cols + 1, ptr_n, ptr_w, 0, colptr) != 0)
+        ret = -1;
+    else if (detail::write_block<false>(s, h.nnz, ind_n, ind_w, 0, rowind) != 0)
+        ret = -2;
+    else if (h.mtype == 'r' &&
+            detail::write_block<true>(s, h.nnz, val_n, val_w, precision, values) != 0)
+        ret = -3;
+    else if (h.mtype == 'i' &&
+            detail::write_block<false>(s, h.nnz, val_n, val_w, 0, values) != 0)
+        ret = -3;
+    if (SRB_lines_close(s) != 0 && ret == 0)
+        ret = -101;
+    return ret;
+}
+
+template <typename Index, typename Scalar>
+int write(const char *filename, const matrix<Index, Scalar> &mat, int precision = -1,
+        rb_file_compress_t flag = SRB_COMPRESS_NONE,
+        const rb_write_opts_t *opts = nullptr){
+    return write(filename, mat.info, mat.colptr.data(), mat.rowind.data(),
+            mat.values.data(), precision, flag, opts);
+}
+
+} // namespace srbio
+
+#endif
@@ -0,0 +1,91 @@
+/*
+ * ===========================================================================
+ *
+ *       Filename:  cards.h
+ *
+ *    Description:  streaming access to the blocks of an RB file
+ *
+ *        Version:  1.0
+ *        Created:  10/20/2026 12:31:44 AM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Haoyang Liu (), liuhaoyang@pku.edu.cn
+ *   Organization:  BICMR, Peking University
+ *
+ * ===========================================================================
+ */
+
+#ifndef SRBIO_PRIVATE_CARDS_H
+#define SRBIO_PRIVATE_CARDS_H
+
+#include <stdlib.h>
+#include "SRBio.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// numbers of one block, pulled card by card
+struct rb_cards {
+    void *fp;
+    SRB_gets_f gets;
+    char buffer[SRBIO_LINE_MAX + 2];
+    char *pos;
+};
+
+// a file read through two streams, one at the rowind block and one at the
+// value block, so only colptr has to stay in memory
+struct rb_stream {
+    rb_matrix_info_t hdr;       // header and colptr
+    SRB_close_f rb_close;
+    struct rb_cards ind;
+    struct rb_cards val;        // fp is NULL for patterns or without values
+};
+
+typedef struct rb_cards rb_cards_t;
+typedef struct rb_stream rb_stream_t;
+
+// `values`: 0 leaves the value stream closed
+int SRB_stream_open(rb_stream_t*, const char *, rb_file_compress_t, int);
+void SRB_stream_close(rb_stream_t*);
+
+static inline char *SRB_cards_token(rb_cards_t *c){
+    for (;;){
+        while (*c->pos == ' ' || *c->pos == '\t' || *c->pos == '\r')
+            ++c->pos;
+        if (*c->pos != '\0' && *c->pos != '\n')
+            return c->pos;
+        c->pos = c->gets(c->buffer, SRBIO_LINE_MAX + 2, c->fp);
+        if (c->pos == NULL)
+            return NULL;
+    }
+}
+
+static inline int SRB_cards_int(rb_cards_t *c, SRB_INT *v){
+    char *end, *p = SRB_cards_token(c);
+    if (p == NULL)
+        return -1;
+    *v = strtol(p, &end, 10);
+    if (end == p)
+        return -1;
+    c->pos = end;
+    return 0;
+}
+
+static inline int SRB_cards_real(rb_cards_t *c, double *v){
+    char *end, *p = SRB_cards_token(c);
+    if (p == NULL)
+        return -1;
+    *v = strtod(p, &end);
+    if (end == p)
+        return -1;
+    c->pos = end;
+    return 0;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
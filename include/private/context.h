@@ -0,0 +1,96 @@
+/*
+ * ===========================================================================
+ *
+ *       Filename:  context.h
+ *
+ *    Description:  worker pool and scratch state kept across calls
+ *
+ *        Version:  1.0
+ *        Created:  10/20/2026 03:31:05 AM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Haoyang Liu (), liuhaoyang@pku.edu.cn
+ *   Organization:  BICMR, Peking University
+ *
+ * ===========================================================================
+ */
+
+#ifndef SRBIO_PRIVATE_CONTEXT_H
+#define SRBIO_PRIVATE_CONTEXT_H
+
+#include <pthread.h>
+#include "SRBio.h"
+
+#ifdef SRBIO_USE_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// `fn(arg)` run once by each of up to n workers of a pool
+struct rb_pool_job {
+    void *(*fn)(void*);
+    void *arg;
+    int pending;        // runs not started yet
+    int running;
+    struct rb_pool_job *next;
+};
+
+typedef struct rb_pool_job rb_pool_job_t;
+
+struct rb_pool {
+    int nthreads;
+    pthread_t *threads;
+    pthread_mutex_t lock;
+    pthread_cond_t work;
+    pthread_cond_t done;
+    rb_pool_job_t *head;
+    rb_pool_job_t *tail;
+    int stop;
+};
+
+typedef struct rb_pool rb_pool_t;
+
+// the buffers are allocated on first use and kept at their size, the zlib
+// states are reset instead of set up again (a deflate state only while the
+// parameters stay the same); calls are served one at a time
+struct rb_context {
+    rb_pool_t pool;
+    rb_read_opts_t read_opts;
+    rb_write_opts_t write_opts;
+
+    // reading: compressed input and the text split into lines
+    char *ibuf;
+    char *lbuf;
+
+    // writing: staged text and encoder output
+    char *wbuf;
+    size_t wsize;
+    char *obuf;
+    size_t osize;
+
+#ifdef SRBIO_USE_ZLIB
+    z_stream inflate;
+    int has_inflate;
+    z_stream deflate;
+    int has_deflate;
+    int deflate_params[4];      // level, window bits, mem level, strategy
+#endif
+};
+
+int SRB_pool_init(rb_pool_t*, int);
+void SRB_pool_free(rb_pool_t*);
+void SRB_pool_submit(rb_pool_t*, rb_pool_job_t*, void *(*)(void*), void*, int);
+void SRB_pool_wait(rb_pool_t*, rb_pool_job_t*);
+
+// *buff grown to at least `size` bytes, kept otherwise
+char *SRB_context_buffer(char**, size_t*, size_t);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
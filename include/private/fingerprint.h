@@ -0,0 +1,111 @@
+/*
+ * ===========================================================================
+ *
+ *       Filename:  fingerprint.h
+ *
+ *    Description:  streaming 128-bit content hash of a matrix
+ *
+ *        Version:  1.0
+ *        Created:  10/20/2026 02:07:19 AM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Haoyang Liu (), liuhaoyang@pku.edu.cn
+ *   Organization:  BICMR, Peking University
+ *
+ * ===========================================================================
+ */
+
+#ifndef SRBIO_PRIVATE_FINGERPRINT_H
+#define SRBIO_PRIVATE_FINGERPRINT_H
+
+#include <string.h>
+#include "SRBio.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// the numbers of the three blocks are absorbed as 64-bit words in file
+// order (colptr and rowind from 1, reals as the bits of the parsed double,
+// -0 as 0), the header words last since SRB_READ_PATTERN changes mtype;
+// the mixing is the block step and finalizer of MurmurHash3 x64/128
+struct rb_fingerprint {
+    uint64_t h1;
+    uint64_t h2;
+    uint64_t n;
+};
+
+typedef struct rb_fingerprint rb_fingerprint_t;
+
+static inline uint64_t SRB_fp_rotl(uint64_t x, int r){
+    return (x << r) | (x >> (64 - r));
+}
+
+static inline uint64_t SRB_fp_fmix(uint64_t k){
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdULL;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ULL;
+    k ^= k >> 33;
+    return k;
+}
+
+static inline void SRB_fp_init(rb_fingerprint_t *f){
+    f->h1 = 0x5242696f5242696fULL;     // "RBioRBio"
+    f->h2 = 0x5242696f5242696fULL;
+    f->n = 0;
+}
+
+static inline void SRB_fp_word(rb_fingerprint_t *f, uint64_t w){
+    uint64_t k1 = w * 0x87c37b91114253d5ULL;
+    uint64_t k2 = w * 0x4cf5ad432745937fULL;
+
+    k1 = SRB_fp_rotl(k1, 31) * 0x4cf5ad432745937fULL;
+    f->h1 ^= k1;
+    f->h1 = SRB_fp_rotl(f->h1, 27) + f->h2;
+    f->h1 = f->h1 * 5 + 0x52dce729;
+
+    k2 = SRB_fp_rotl(k2, 33) * 0x87c37b91114253d5ULL;
+    f->h2 ^= k2;
+    f->h2 = SRB_fp_rotl(f->h2, 31) + f->h1;
+    f->h2 = f->h2 * 5 + 0x38495ab5;
+    ++f->n;
+}
+
+static inline void SRB_fp_int(rb_fingerprint_t *f, SRB_INT v){
+    SRB_fp_word(f, (uint64_t)(int64_t)v);
+}
+
+static inline void SRB_fp_real(rb_fingerprint_t *f, double v){
+    uint64_t w;
+    if (v == 0) v = 0.0;
+    memcpy(&w, &v, sizeof(w));
+    SRB_fp_word(f, w);
+}
+
+static inline void SRB_fp_finish(rb_fingerprint_t *f, const rb_matrix_info_t *mat,
+        uint64_t *out){
+    SRB_fp_int(f, mat->rows);
+    SRB_fp_int(f, mat->cols);
+    SRB_fp_int(f, mat->nnz);
+    SRB_fp_word(f, ((uint64_t)(unsigned char)mat->mtype << 16) |
+            ((uint64_t)(unsigned char)mat->stype << 8) | (unsigned char)mat->ftype);
+
+    f->h1 ^= f->n;
+    f->h2 ^= f->n;
+    f->h1 += f->h2;
+    f->h2 += f->h1;
+    f->h1 = SRB_fp_fmix(f->h1);
+    f->h2 = SRB_fp_fmix(f->h2);
+    f->h1 += f->h2;
+    f->h2 += f->h1;
+    out[0] = f->h1;
+    out[1] = f->h2;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
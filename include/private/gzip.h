@@ -0,0 +1,135 @@
+/*
+ * ===========================================================================
+ *
+ *       Filename:  gzip.h
+ *
+ *    Description:  gzip reader with a saved access-point index
+ *
+ *        Version:  1.0
+ *        Created:  10/20/2026 02:48:12 AM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Haoyang Liu (), liuhaoyang@pku.edu.cn
+ *   Organization:  BICMR, Peking University
+ *
+ * ===========================================================================
+ */
+
+#ifndef SRBIO_PRIVATE_GZIP_H
+#define SRBIO_PRIVATE_GZIP_H
+
+#include "SRBio_config.h"
+
+#ifdef SRBIO_USE_ZLIB
+#include <stdint.h>
+#include <pthread.h>
+#include <zlib.h>
+#include "private/source.h"
+#include "private/context.h"
+
+// output bytes between two access points
+#define SRBIO_GZ_SPAN (4 << 20)
+#define SRBIO_GZ_WINSIZE 32768
+// compressed files smaller than this are neither indexed nor split
+#define SRBIO_GZ_INDEX_MIN (16 << 20)
+#define SRBIO_GZ_BUFF_SIZE (1 << 18)
+#define SRBIO_GZ_MAX_THREADS 8
+// decoding threads, 0: one per online cpu
+#ifndef SRBIO_GZ_THREADS
+#define SRBIO_GZ_THREADS 0
+#endif
+
+// a deflate block boundary: inflate can restart at bit `bits` before
+// compressed byte `in` once the 32K of output before `out` are known
+struct rb_gz_point {
+    uint64_t in;
+    uint64_t out;
+    int bits;
+    unsigned dict_len;
+    unsigned char *dict;
+};
+
+typedef struct rb_gz_point rb_gz_point_t;
+
+// saved as filename.zidx, valid while the inode, size and mtime (to the
+// nanosecond) of the .gz match
+struct rb_gz_index {
+    uint64_t gz_ino;
+    uint64_t gz_size;
+    int64_t gz_mtime;
+    int64_t gz_mtime_ns;
+    uint64_t total;
+    size_t n;
+    size_t cap;
+    rb_gz_point_t *points;
+};
+
+typedef struct rb_gz_index rb_gz_index_t;
+
+// output of the span [points[k].out, points[k + 1].out)
+struct rb_gz_chunk {
+    char *data;
+    size_t len;
+    uint32_t crc;       // CRC-32 of data
+    int state;          // 0: pending, 1: ready, -1: failed
+};
+
+typedef struct rb_gz_chunk rb_gz_chunk_t;
+
+// with an index, the spans are inflated ahead of the parser by a pool of
+// threads into a ring of chunks and handed over in order; otherwise the
+// stream is inflated in the caller's thread, recording the index on the way.
+// Given a context, its buffers, inflate state and workers are used.
+struct rb_gz_file {
+    int fd;
+    int plain;          // bytes served as they are
+    char *idx_path;
+    rb_gz_index_t idx;
+    rb_source_t src;
+    rb_context_t *ctx;
+
+    // sequential
+    z_stream zs;
+    z_stream *strm;     // &zs or the context's
+    int has_strm;
+    int building;
+    unsigned char *ibuf;
+    uint64_t in_off;
+    uint64_t out_off;
+    int eof;
+
+    // parallel
+    int nthreads;
+    pthread_t *threads;
+    rb_pool_job_t job;
+    int started;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    size_t nslots;
+    rb_gz_chunk_t *slots;
+    size_t next;
+    size_t cur;
+    size_t pos;
+    int stop;
+    uint32_t crc;           // of the chunks handed over so far
+    uint32_t trailer[2];    // CRC-32 and ISIZE of the member, from the last span
+};
+
+typedef struct rb_gz_file rb_gz_file_t;
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+void *SRB_igzopen(const char *, const char *);
+void *SRB_igzopen_ctx(const char *, rb_context_t*, int);
+void SRB_igzclose(void*);
+char *SRB_igzgets(char *, int, void*);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,83 @@
+/*
+ * ===========================================================================
+ *
+ *       Filename:  kernels.h
+ *
+ *    Description:  integer card kernels, dispatched on the cpu at load time
+ *
+ *        Version:  1.0
+ *        Created:  10/20/2026 04:16:40 AM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Haoyang Liu (), liuhaoyang@pku.edu.cn
+ *   Organization:  BICMR, Peking University
+ *
+ * ===========================================================================
+ */
+
+#ifndef SRBIO_PRIVATE_KERNELS_H
+#define SRBIO_PRIVATE_KERNELS_H
+
+#include <stdlib.h>
+#include <string.h>
+#include "SRBio.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// numbers of a card of SRBIO_LINE_MAX chars
+#define SRBIO_CARD_NUMS (SRBIO_LINE_MAX / 2 + 1)
+// bytes a format kernel may write past the fields it returns
+#define SRBIO_FORMAT_SLACK 16
+// room for a card of n fields and its newline, numbers wider than the
+// format included
+#define SRBIO_FORMAT_MAX(n) (SRBIO_LINE_MAX + 20 * (n) + 2 + SRBIO_FORMAT_SLACK)
+
+struct rb_kernels {
+    int level;          // SRB_KERNEL_*
+
+    // the numbers of [s, end) that are runs of at most 16 digits between
+    // white space, at most n of them; *stop is left after the last one, or
+    // at the first token that is not such a run (sign, real, ...) or at end
+    int (*parse_ints)(const char *s, const char *end, int64_t *out, int n,
+            const char **stop);
+
+    // n fields of width w (wider if a number needs it) right aligned as by
+    // "%*ld", returns their length
+    int (*format_ints)(char *dst, const int64_t *v, int n, int w);
+};
+
+typedef struct rb_kernels rb_kernels_t;
+
+extern const rb_kernels_t *SRB_kernels;
+
+// as many integers of [*s, end) as strtol would take in turn, at most n,
+// *s is moved past them; the tokens a kernel leaves go to strtol one by one
+static inline int SRB_card_ints(const char **s, const char *end, int64_t *out, int n){
+    int m = 0;
+    while (m < n){
+        m += SRB_kernels->parse_ints(*s, end, out + m, n - m, s);
+        if (m == n || *s == end)
+            break;
+        char *e;
+        long v = strtol(*s, &e, 10);
+        if (e == *s)
+            break;
+        out[m++] = v;
+        *s = e;
+    }
+    return m;
+}
+
+// numbers to ask a card for when `left` remain in the block
+static inline int SRB_card_want(int64_t left){
+    return left < SRBIO_CARD_NUMS ? (int)left : SRBIO_CARD_NUMS;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,40 @@
+/*
+ * ===========================================================================
+ *
+ *       Filename:  numa.h
+ *
+ *    Description:  first-touch placement of a parallel load
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 07:02:51 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Haoyang Liu (), liuhaoyang@pku.edu.cn
+ *   Organization:  BICMR, Peking University
+ *
+ * ===========================================================================
+ */
+
+#ifndef SRBIO_PRIVATE_NUMA_H
+#define SRBIO_PRIVATE_NUMA_H
+
+#include "SRBio.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int SRB_numa_active(const rb_read_opts_t*);
+int SRB_numa_check(const rb_read_opts_t*, SRB_INT);
+
+// pages are placed by the first write, so the arrays must be fresh from
+// malloc; the entry ranges follow `ptr`, counted from `base`
+void SRB_numa_touch_colptr(const rb_read_opts_t*, rb_matrix_info_t*);
+void SRB_numa_touch_entries(const rb_read_opts_t*, rb_matrix_info_t*, const SRB_INT*, SRB_INT);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
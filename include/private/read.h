@@ -0,0 +1,52 @@
+/*
+ * ===========================================================================
+ *
+ *       Filename:  read.h
+ *
+ *    Description:  internal entry points of the RB parser
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 06:02:15 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Haoyang Liu (), liuhaoyang@pku.edu.cn
+ *   Organization:  BICMR, Peking University
+ *
+ * ===========================================================================
+ */
+
+#ifndef SRBIO_PRIVATE_READ_H
+#define SRBIO_PRIVATE_READ_H
+
+#include "SRBio.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// takes the value block in place of valptr_d/valptr_i: `begin` runs once
+// colptr and rowind are parsed (it may free rowind), `put` receives the
+// k-th value in file order; pattern matrices only see `begin`
+struct rb_value_sink {
+    int (*begin)(void *ctx, rb_matrix_info_t *mat);
+    void (*put)(void *ctx, SRB_INT k, SRB_Scalar v);
+    void *ctx;
+};
+
+typedef struct rb_value_sink rb_value_sink_t;
+
+int SRB_read_backend(rb_file_compress_t, SRB_open_f*, SRB_close_f*, SRB_gets_f*);
+int SRB_read_header(void*, rb_matrix_info_t*, SRB_gets_f, SRB_INT*, SRB_INT*, SRB_INT*);
+int SRB_read_header_mixed(void*, rb_matrix_mixed_t*, SRB_gets_f, int64_t*);
+int SRB_read_stream(void*, rb_matrix_info_t*, SRB_gets_f, const rb_read_opts_t*,
+        const rb_value_sink_t*);
+int SRB_read_into(const char *, rb_matrix_info_t*, rb_file_compress_t,
+        const rb_read_opts_t*, const rb_value_sink_t*);
+void SRB_read_rebase(rb_matrix_info_t*, const rb_read_opts_t*);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,81 @@
+/*
+ * ===========================================================================
+ *
+ *       Filename:  sink.h
+ *
+ *    Description:  buffered output sink with gzip/bzip2 encoders
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 02:40:12 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Haoyang Liu (), liuhaoyang@pku.edu.cn
+ *   Organization:  BICMR, Peking University
+ *
+ * ===========================================================================
+ */
+
+#ifndef SRBIO_PRIVATE_SINK_H
+#define SRBIO_PRIVATE_SINK_H
+
+#include "SRBio.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SRBIO_SINK_BUFF_SIZE (1 << 20)
+
+typedef int (*SRB_finish_f)(void*);
+
+// text is staged in `buffer`, handed to the encoder in large batches,
+// and the encoded bytes are passed to `out`
+struct rb_sink {
+    SRB_write_f out;
+    SRB_finish_f finish;
+    void *target;
+
+    char codec;         // 'n': none, 'g': gzip, 'b': bzip2
+    void *state;        // z_stream or bz_stream
+    char *obuf;         // encoder output
+    size_t osize;
+
+    char *buffer;
+    size_t size;
+    size_t len;
+
+    rb_context_t *ctx;  // lends the buffers and the deflate state, NULL: none
+    int err;
+};
+
+typedef struct rb_sink rb_sink_t;
+
+int SRB_sink_open(rb_sink_t*, const char *, const char *, rb_file_compress_t, const rb_write_opts_t*);
+int SRB_sink_open_ctx(rb_sink_t*, const char *, const char *, rb_file_compress_t,
+        const rb_write_opts_t*, rb_context_t*);
+int SRB_sink_init(rb_sink_t*, SRB_write_f, SRB_finish_f, void*, rb_file_compress_t, const rb_write_opts_t*);
+int SRB_sink_init_ctx(rb_sink_t*, SRB_write_f, SRB_finish_f, void*, rb_file_compress_t,
+        const rb_write_opts_t*, rb_context_t*);
+int SRB_sink_flush(rb_sink_t*);
+int SRB_sink_write(rb_sink_t*, const void*, size_t);
+int SRB_sink_puts(rb_sink_t*, const char*);
+int SRB_sink_close(rb_sink_t*);
+
+// pointer to at least n free bytes at the end of the staging buffer,
+// to be followed by SRB_sink_commit with the number of bytes used
+static inline char *SRB_sink_reserve(rb_sink_t *sink, size_t n){
+    if (sink->size - sink->len < n)
+        SRB_sink_flush(sink);
+    return sink->buffer + sink->len;
+}
+
+static inline void SRB_sink_commit(rb_sink_t *sink, size_t n){
+    sink->len += n;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
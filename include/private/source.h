@@ -0,0 +1,84 @@
+/*
+ * ===========================================================================
+ *
+ *       Filename:  source.h
+ *
+ *    Description:  buffered line source with gzip/bzip2 decoders
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 04:05:37 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Haoyang Liu (), liuhaoyang@pku.edu.cn
+ *   Organization:  BICMR, Peking University
+ *
+ * ===========================================================================
+ */
+
+#ifndef SRBIO_PRIVATE_SOURCE_H
+#define SRBIO_PRIVATE_SOURCE_H
+
+#include "SRBio.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SRBIO_SOURCE_BUFF_SIZE (1 << 18)
+
+// bytes of a memory block, read in order
+struct rb_memfile {
+    const char *data;
+    size_t len;
+    size_t pos;
+};
+
+typedef struct rb_memfile rb_memfile_t;
+
+// decompresses the bytes delivered by `in`
+struct rb_decoder {
+    SRB_read_f in;
+    void *in_ctx;
+    char codec;         // 'n': none, 'g': gzip, 'b': bzip2
+    void *state;        // z_stream or bz_stream
+    char *ibuf;
+    size_t isize;
+    int in_eof;
+    int eof;
+};
+
+typedef struct rb_decoder rb_decoder_t;
+
+// splits the bytes delivered by `read` into lines, see SRB_source_gets
+struct rb_source {
+    SRB_read_f read;
+    void *src;
+    char *buffer;
+    size_t size;
+    size_t pos;
+    size_t len;
+    int owned;
+    int eof;
+    int err;
+};
+
+typedef struct rb_source rb_source_t;
+
+long SRB_memread(void *, size_t, void *);
+
+int SRB_decoder_init(rb_decoder_t*, SRB_read_f, void*, rb_file_compress_t);
+long SRB_decoder_read(void *, size_t, void *);
+void SRB_decoder_free(rb_decoder_t*);
+
+int SRB_source_init(rb_source_t*, SRB_read_f, void*, size_t);
+void SRB_source_init_buffer(rb_source_t*, SRB_read_f, void*, char*, size_t);
+void SRB_source_init_mem(rb_source_t*, const char*, size_t);
+char *SRB_source_gets(char *, int, void *);
+void SRB_source_free(rb_source_t*);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,87 @@
+/*
+ * ===========================================================================
+ *
+ *       Filename:  stats.h
+ *
+ *    Description:  statistics collected by the parser
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 09:41:20 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Haoyang Liu (), liuhaoyang@pku.edu.cn
+ *   Organization:  BICMR, Peking University
+ *
+ * ===========================================================================
+ */
+
+#ifndef SRBIO_PRIVATE_STATS_H
+#define SRBIO_PRIVATE_STATS_H
+
+#include "SRBio.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// the rows arrive in file order, the column of entry k is followed with
+// a cursor over colptr
+struct rb_stats_state {
+    rb_stats_t *out;
+    const SRB_INT *colptr;
+    SRB_INT rows;
+    SRB_INT cols;
+    SRB_INT col;        // column of the entries before `end`, from 0
+    SRB_INT end;        // first entry past `col`, from 0
+    SRB_INT rmin;
+    SRB_INT rmax;
+    int seen_diag;
+    int lower_profile;
+};
+
+typedef struct rb_stats_state rb_stats_state_t;
+
+void SRB_stats_begin(rb_stats_state_t*, rb_stats_t*, const rb_matrix_info_t*);
+void SRB_stats_column(rb_stats_state_t*);
+void SRB_stats_finish(rb_stats_state_t*);
+
+static inline void SRB_stats_row(rb_stats_state_t *st, SRB_INT k, SRB_INT row){
+    rb_stats_t *out = st->out;
+    SRB_INT j;
+
+    while (k >= st->end && st->col < st->cols)
+        SRB_stats_column(st);
+    j = st->col + 1;
+
+    if (row > j){
+        ++out->lower;
+        if (row - j > out->bw_lower) out->bw_lower = row - j;
+    } else if (row < j){
+        ++out->upper;
+        if (j - row > out->bw_upper) out->bw_upper = j - row;
+    } else {
+        ++out->diag;
+        st->seen_diag = 1;
+    }
+    if (row < st->rmin) st->rmin = row;
+    if (row > st->rmax) st->rmax = row;
+}
+
+static inline void SRB_stats_value(rb_stats_state_t *st, double v){
+    rb_stats_t *out = st->out;
+    double a = v < 0 ? -v : v;
+
+    if (a == 0){
+        ++out->zeros;
+        return;
+    }
+    if (a < out->min_abs || out->min_abs == 0) out->min_abs = a;
+    if (a > out->max_abs) out->max_abs = a;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -33,11 +33,79 @@ struct rb_bzip2_file {
     char mode;
     char buffer[SRBIO_BZ2_BUFF_SIZE];
     int ipos;
+    int len;            // bytes of buffer
+    int eof;            // the last stream has ended
 };
 
 typedef struct rb_bzip2_file rb_bzip2_file_t;
 #endif
 
+#ifdef SRBIO_USE_IO_URING
+#include <sys/types.h>
+
+#define SRBIO_URING_DEPTH 4
+#define SRBIO_URING_BUFF_SIZE (1 << 20)
+#define SRBIO_URING_ALIGN 4096
+// files read below this size get one small buffer and plain pread(2)
+#define SRBIO_URING_MIN_SIZE (SRBIO_URING_DEPTH * SRBIO_URING_BUFF_SIZE)
+#define SRBIO_URING_SMALL_BUFF (1 << 16)
+
+struct io_uring_sqe;
+struct io_uring_cqe;
+
+struct rb_uring {
+    int fd;
+    void *sq_ptr;
+    void *cq_ptr;
+    size_t sq_len;
+    size_t cq_len;
+    size_t sqes_len;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_sqe *sqes;
+    struct io_uring_cqe *cqes;
+};
+
+typedef struct rb_uring rb_uring_t;
+
+// `depth` buffers of `bsize` bytes, used in round-robin order: reads are
+// kept in flight ahead of the parser, writes are handed to the kernel once
+// a buffer is full. Small files are read through one buffer without a ring,
+// writers set the ring up when the first buffer is full.
+struct rb_uring_file {
+    int fd;
+    char mode;
+    int direct;
+    int has_ring;
+    int ring_tried;
+    int registered;
+    int err;
+    int depth;
+    size_t bsize;
+    off_t size;                         // of the file read, at open
+    rb_uring_t ring;
+    char *buffers;
+    int state[SRBIO_URING_DEPTH];
+    long result[SRBIO_URING_DEPTH];
+    size_t request[SRBIO_URING_DEPTH];
+    size_t done[SRBIO_URING_DEPTH];     // bytes of request read so far
+    off_t offset[SRBIO_URING_DEPTH];
+    off_t next;
+    int cur;
+    size_t ipos;
+};
+
+typedef struct rb_uring_file rb_uring_file_t;
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 void *SRB_fopen(const char *, const char *);
 void *SRB_gzopen(const char *, const char *);
 void *SRB_bz2open(const char *, const char*);
@@ -50,6 +118,16 @@ char *SRB_bz2gets(char *, int, void*);
 int SRB_fputs(const char *, void*);
 int SRB_gzputs(const char *, void*);
 int SRB_bz2puts(const char *, void*);
+void *SRB_uringopen(const char *, const char *);
+void SRB_uringclose(void*);
+char *SRB_uringgets(char *, int, void*);
+int SRB_uringputs(const char *, void*);
+int SRB_uringwrite(const void *, size_t, void*);
+int SRB_uringfinish(void*);
+
+#ifdef __cplusplus
+}
+#endif
 
 
 #endif
@@ -0,0 +1,104 @@
+/*
+ * ===========================================================================
+ *
+ *       Filename:  write.h
+ *
+ *    Description:  internal entry points of the RB writer
+ *
+ *        Version:  1.0
+ *        Created:  10/20/2026 12:52:37 AM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Haoyang Liu (), liuhaoyang@pku.edu.cn
+ *   Organization:  BICMR, Peking University
+ *
+ * ===========================================================================
+ */
+
+#ifndef SRBIO_PRIVATE_WRITE_H
+#define SRBIO_PRIVATE_WRITE_H
+
+#include <stdio.h>
+#include "SRBio.h"
+#include "private/sink.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// cards and field widths of the three blocks
+struct rb_layout {
+    SRB_INT ptrcrd, indcrd, valcrd;
+    int ptr_w, ptr_n;
+    int ind_w, ind_n;
+    int val_w, val_n;
+    int precision;
+};
+
+typedef struct rb_layout rb_layout_t;
+
+// fills cards of n fields of width w, one number at a time
+struct rb_card_writer {
+    rb_sink_t *sink;
+    char *line;
+    int ipos;
+    int j;
+    int w;
+    int n;
+};
+
+typedef struct rb_card_writer rb_card_writer_t;
+
+int SRB_write_precision(int, rb_file_compress_t);
+int SRB_write_sink(rb_sink_t*, const rb_matrix_info_t*, int, rb_file_compress_t,
+        const rb_write_opts_t*);
+// lines 2-4 of the matrix as described by mat->rows/cols/nnz/mtype/stype
+int SRB_write_csc_header(rb_sink_t*, const rb_matrix_info_t*, int, rb_layout_t*);
+
+static inline void SRB_card_begin(rb_card_writer_t *c, rb_sink_t *sink, int w, int n){
+    c->sink = sink;
+    c->line = NULL;
+    c->ipos = 0;
+    c->j = 0;
+    c->w = w;
+    c->n = n;
+}
+
+static inline void SRB_card_end(rb_card_writer_t *c){
+    if (c->line == NULL)
+        return;
+    c->line[c->ipos++] = '\n';
+    SRB_sink_commit(c->sink, c->ipos);
+    c->line = NULL;
+    c->ipos = 0;
+    c->j = 0;
+}
+
+static inline char *SRB_card_field(rb_card_writer_t *c){
+    if (c->line == NULL)
+        c->line = SRB_sink_reserve(c->sink, SRBIO_LINE_MAX + 2);
+    return c->line + c->ipos;
+}
+
+static inline void SRB_card_next(rb_card_writer_t *c, int len){
+    c->ipos += len;
+    if (++c->j == c->n)
+        SRB_card_end(c);
+}
+
+static inline void SRB_card_int(rb_card_writer_t *c, long v){
+    char *s = SRB_card_field(c);
+    SRB_card_next(c, snprintf(s, SRBIO_LINE_MAX + 2 - c->ipos, "%*ld", c->w, v));
+}
+
+static inline void SRB_card_real(rb_card_writer_t *c, double v, int precision){
+    char *s = SRB_card_field(c);
+    SRB_card_next(c, snprintf(s, SRBIO_LINE_MAX + 2 - c->ipos, "%*.*e", c->w, precision, v));
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
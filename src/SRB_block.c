@@ -0,0 +1,699 @@
+/*
+ * ===========================================================================
+ *
+ *       Filename:  SRB_block.c
+ *
+ *    Description:  BSR and SELL-C-sigma layouts for SpMV
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 06:10:44 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Haoyang Liu (), liuhaoyang@pku.edu.cn
+ *   Organization:  BICMR, Peking University
+ *      Copyright:  Copyright (c) 2021, Haoyang Liu
+ *
+ * ===========================================================================
+ */
+
+#define _POSIX_C_SOURCE 200112L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "SRBio.h"
+#include "private/read.h"
+
+#define SRBIO_BLOCK_ALIGN 64
+
+// entries sampled by SRB_bsr_detect
+#define SRBIO_DETECT_SAMPLE (1 << 20)
+
+static const SRB_INT SRB_block_sizes[] = {1, 2, 3, 4, 6, 8};
+#define SRB_NUM_BLOCK_SIZES ((SRB_INT)(sizeof(SRB_block_sizes) / sizeof(SRB_INT)))
+
+// row-wise view of the full matrix; `src` is the CSC entry of each element,
+// -(k + 1) for the mirror of a stored triangle
+struct rb_rows {
+    SRB_INT rows;
+    SRB_INT nnz;
+    SRB_INT *ptr;
+    SRB_INT *col;       // column, replaced by the destination once placed
+    SRB_INT *src;
+};
+
+typedef struct rb_rows rb_rows_t;
+
+static int SRB_block_threads(void){
+#ifdef _OPENMP
+    return omp_get_max_threads();
+#else
+    return 1;
+#endif
+}
+
+static int SRB_block_tid(void){
+#ifdef _OPENMP
+    return omp_get_thread_num();
+#else
+    return 0;
+#endif
+}
+
+static SRB_Scalar *SRB_block_alloc(SRB_INT n){
+    void *p;
+    size_t bytes = (n > 0 ? n : 1) * sizeof(SRB_Scalar);
+    if (posix_memalign(&p, SRBIO_BLOCK_ALIGN, bytes) != 0)
+        return NULL;
+    return (SRB_Scalar*)p;
+}
+
+static int SRB_block_mirrored(const rb_matrix_info_t *mat){
+    return mat->stype == 's' || mat->stype == 'h' || mat->stype == 'z';
+}
+
+static SRB_Scalar SRB_block_value(const rb_matrix_info_t *mat, SRB_INT src){
+    SRB_INT k = src >= 0 ? src : -src - 1;
+    SRB_Scalar v = 1;
+    if (mat->valptr_d != NULL)
+        v = mat->valptr_d[k];
+    else if (mat->valptr_i != NULL)
+        v = (SRB_Scalar)mat->valptr_i[k];
+    return (src < 0 && mat->stype == 'z') ? -v : v;
+}
+
+static int SRB_block_cmp(const void *a, const void *b){
+    SRB_INT x = *(const SRB_INT*)a, y = *(const SRB_INT*)b;
+    return (x > y) - (x < y);
+}
+
+// the row table and the block layouts index by colptr and rowind, so both
+// are checked first: 1-based non-decreasing colptr ending at nnz + 1, rows
+// within 1..rows, and a square shape if a mirrored half is to be added
+static int SRB_block_check(const rb_matrix_info_t *mat){
+    SRB_INT bad = -1;
+
+    if (mat->colptr == NULL || mat->rowind == NULL)
+        return -1;
+    if (mat->rows < 0 || mat->cols < 0 || mat->nnz < 0 ||
+            (SRB_block_mirrored(mat) && mat->rows != mat->cols)){
+        fprintf(stderr, "SRB_block: illegal shape %ld x %ld.\n",
+                (long)mat->rows, (long)mat->cols);
+        return -1;
+    }
+    if (mat->colptr[0] != 1 || mat->colptr[mat->cols] != mat->nnz + 1){
+        fprintf(stderr, "SRB_block: colptr runs from %ld to %ld, not 1 to %ld.\n",
+                (long)mat->colptr[0], (long)mat->colptr[mat->cols], (long)mat->nnz + 1);
+        return -1;
+    }
+    for (SRB_INT j = 0; j < mat->cols; ++j){
+        if (mat->colptr[j + 1] < mat->colptr[j]){
+            fprintf(stderr, "SRB_block: colptr decreases at column %ld.\n", (long)j + 1);
+            return -1;
+        }
+    }
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static) reduction(max:bad)
+#endif
+    for (SRB_INT k = 0; k < mat->nnz; ++k){
+        SRB_INT i = mat->rowind[k];
+        if (i < 1 || i > mat->rows)
+            bad = k > bad ? k : bad;
+    }
+    if (bad >= 0){
+        fprintf(stderr, "SRB_block: row index %ld of entry %ld is out of 1..%ld.\n",
+                (long)mat->rowind[bad], (long)bad + 1, (long)mat->rows);
+        return -1;
+    }
+    return 0;
+}
+
+// counting transpose of the CSC structure, mirrors included; the structure
+// has passed SRB_block_check
+static int SRB_rows_init(rb_rows_t *t, const rb_matrix_info_t *mat){
+    int mirror = SRB_block_mirrored(mat);
+
+    memset(t, 0, sizeof(rb_rows_t));
+    t->rows = mat->rows;
+    t->ptr = (SRB_INT*)calloc(mat->rows + 1, sizeof(SRB_INT));
+    if (t->ptr == NULL)
+        return -1;
+
+    for (SRB_INT j = 0; j < mat->cols; ++j){
+        for (SRB_INT k = mat->colptr[j] - 1; k < mat->colptr[j + 1] - 1; ++k){
+            SRB_INT i = mat->rowind[k] - 1;
+            ++t->ptr[i + 1];
+            if (mirror && i != j) ++t->ptr[j + 1];
+        }
+    }
+    for (SRB_INT i = 0; i < mat->rows; ++i)
+        t->ptr[i + 1] += t->ptr[i];
+    t->nnz = t->ptr[mat->rows];
+
+    t->col = (SRB_INT*)malloc((t->nnz > 0 ? t->nnz : 1) * sizeof(SRB_INT));
+    t->src = (SRB_INT*)malloc((t->nnz > 0 ? t->nnz : 1) * sizeof(SRB_INT));
+    if (t->col == NULL || t->src == NULL){
+        free(t->ptr);
+        free(t->col);
+        free(t->src);
+        return -1;
+    }
+
+    // ptr[i] walks to the start of row i + 1, then shifts back
+    for (SRB_INT j = 0; j < mat->cols; ++j){
+        for (SRB_INT k = mat->colptr[j] - 1; k < mat->colptr[j + 1] - 1; ++k){
+            SRB_INT i = mat->rowind[k] - 1;
+            SRB_INT e = t->ptr[i]++;
+            t->col[e] = j;
+            t->src[e] = k;
+            if (mirror && i != j){
+                e = t->ptr[j]++;
+                t->col[e] = i;
+                t->src[e] = -k - 1;
+            }
+        }
+    }
+    for (SRB_INT i = mat->rows; i > 0; --i)
+        t->ptr[i] = t->ptr[i - 1];
+    t->ptr[0] = 0;
+    return 0;
+}
+
+static void SRB_rows_free(rb_rows_t *t){
+    free(t->ptr);
+    free(t->col);
+    free(t->src);
+    memset(t, 0, sizeof(rb_rows_t));
+}
+
+void SRB_bsr_free(rb_bsr_t *bsr){
+    free(bsr->rowptr);
+    free(bsr->colind);
+    free(bsr->values);
+    bsr->rowptr = NULL;
+    bsr->colind = NULL;
+    bsr->values = NULL;
+}
+
+void SRB_sell_free(rb_sell_t *sell){
+    free(sell->chunkptr);
+    free(sell->chunklen);
+    free(sell->perm);
+    free(sell->colind);
+    free(sell->values);
+    sell->chunkptr = NULL;
+    sell->chunklen = NULL;
+    sell->perm = NULL;
+    sell->colind = NULL;
+    sell->values = NULL;
+}
+
+// pick the block size with the least SpMV traffic, values plus block
+// indices, from the stored entries of a sample of block columns
+static int SRB_bsr_pick(const rb_matrix_info_t *mat, SRB_INT *r, SRB_INT *c, double *fill){
+    SRB_INT ncand = SRB_NUM_BLOCK_SIZES * SRB_NUM_BLOCK_SIZES;
+    double cost[SRB_NUM_BLOCK_SIZES * SRB_NUM_BLOCK_SIZES];
+    double ratio[SRB_NUM_BLOCK_SIZES * SRB_NUM_BLOCK_SIZES];
+    int square = SRB_block_mirrored(mat);
+    int err = 0;
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1)
+#endif
+    for (SRB_INT q = 0; q < ncand; ++q){
+        SRB_INT br = SRB_block_sizes[q / SRB_NUM_BLOCK_SIZES];
+        SRB_INT bc = SRB_block_sizes[q % SRB_NUM_BLOCK_SIZES];
+        SRB_INT mb = (mat->rows + br - 1) / br;
+        SRB_INT nb = (mat->cols + bc - 1) / bc;
+        SRB_INT stride = 1 + (SRB_INT)(mat->nnz / SRBIO_DETECT_SAMPLE);
+        double blocks = 0, entries = 0;
+
+        cost[q] = -1;
+        // the mirrored half only tiles like the stored one for square blocks
+        if (square && br != bc)
+            continue;
+
+        SRB_INT *mark = (SRB_INT*)malloc((mb > 0 ? mb : 1) * sizeof(SRB_INT));
+        if (mark == NULL){
+            err = -1;
+            continue;
+        }
+        for (SRB_INT i = 0; i < mb; ++i) mark[i] = -1;
+
+        for (SRB_INT J = 0; J < nb; J += stride){
+            SRB_INT end = (J + 1) * bc < mat->cols ? (J + 1) * bc : mat->cols;
+            for (SRB_INT j = J * bc; j < end; ++j){
+                for (SRB_INT k = mat->colptr[j] - 1; k < mat->colptr[j + 1] - 1; ++k){
+                    SRB_INT I = (mat->rowind[k] - 1) / br;
+                    if (mark[I] != J){
+                        mark[I] = J;
+                        ++blocks;
+                    }
+                    ++entries;
+                }
+            }
+        }
+        free(mark);
+
+        if (entries > 0){
+            ratio[q] = blocks * br * bc / entries;
+            cost[q] = blocks * (br * bc * sizeof(SRB_Scalar) + sizeof(SRB_INT)) / entries;
+        } else {
+            ratio[q] = 1;
+            cost[q] = sizeof(SRB_Scalar) + sizeof(SRB_INT);
+        }
+    }
+    if (err != 0)
+        return err;
+
+    // ties go to the smaller block
+    SRB_INT best = 0;
+    for (SRB_INT q = 1; q < ncand; ++q){
+        SRB_INT bsize = SRB_block_sizes[best / SRB_NUM_BLOCK_SIZES] *
+            SRB_block_sizes[best % SRB_NUM_BLOCK_SIZES];
+        SRB_INT qsize = SRB_block_sizes[q / SRB_NUM_BLOCK_SIZES] *
+            SRB_block_sizes[q % SRB_NUM_BLOCK_SIZES];
+        if (cost[q] < 0)
+            continue;
+        if (cost[q] < cost[best] || (cost[q] == cost[best] && qsize < bsize))
+            best = q;
+    }
+
+    *r = SRB_block_sizes[best / SRB_NUM_BLOCK_SIZES];
+    *c = SRB_block_sizes[best % SRB_NUM_BLOCK_SIZES];
+    if (fill != NULL) *fill = ratio[best];
+
+#ifndef NDEBUG
+    printf("SRB_bsr_detect: block %d x %d, fill %.3f\n", (int)*r, (int)*c, ratio[best]);
+#endif
+    return 0;
+}
+
+int SRB_bsr_detect(const rb_matrix_info_t *mat, SRB_INT *r, SRB_INT *c, double *fill){
+    int ret = SRB_block_check(mat);
+    if (ret != 0)
+        return ret;
+    return SRB_bsr_pick(mat, r, c, fill);
+}
+
+// BSR structure from the row view; t->col becomes the value offset
+static int SRB_bsr_build(rb_bsr_t *bsr, rb_rows_t *t, SRB_INT cols, SRB_INT r, SRB_INT c){
+    int nthreads = SRB_block_threads();
+    SRB_INT mb = (t->rows + r - 1) / r;
+    SRB_INT nb = (cols + c - 1) / c;
+    SRB_INT *mark;
+
+    memset(bsr, 0, sizeof(rb_bsr_t));
+    bsr->rows = t->rows;
+    bsr->cols = cols;
+    bsr->r = r;
+    bsr->c = c;
+    bsr->mb = mb;
+    bsr->nb = nb;
+    bsr->nnz = t->nnz;
+
+    bsr->rowptr = (SRB_INT*)malloc((mb + 1) * sizeof(SRB_INT));
+    // per thread: last block row seen in each block column, and its slot
+    mark = (SRB_INT*)malloc((size_t)nthreads * 2 * (nb > 0 ? nb : 1) * sizeof(SRB_INT));
+    if (bsr->rowptr == NULL || mark == NULL){
+        free(mark);
+        SRB_bsr_free(bsr);
+        return -1;
+    }
+
+    // count the blocks of each block row
+    bsr->rowptr[0] = 0;
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    {
+        SRB_INT *seen = mark + (size_t)SRB_block_tid() * 2 * nb;
+        for (SRB_INT J = 0; J < nb; ++J) seen[J] = -1;
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic, 64)
+#endif
+        for (SRB_INT I = 0; I < mb; ++I){
+            SRB_INT cnt = 0;
+            SRB_INT end = (I + 1) * r < t->rows ? (I + 1) * r : t->rows;
+            for (SRB_INT e = t->ptr[I * r]; e < t->ptr[end]; ++e){
+                SRB_INT J = t->col[e] / c;
+                if (seen[J] != I){
+                    seen[J] = I;
+                    ++cnt;
+                }
+            }
+            bsr->rowptr[I + 1] = cnt;
+        }
+    }
+    for (SRB_INT I = 0; I < mb; ++I)
+        bsr->rowptr[I + 1] += bsr->rowptr[I];
+    bsr->nnzb = bsr->rowptr[mb];
+
+    if ((double)bsr->nnzb * r * c > (double)((SRB_INT)1 << (sizeof(SRB_INT) * 8 - 2))){
+        fprintf(stderr, "SRB_to_bsr: %d x %d blocks overflow the index type.\n",
+                (int)r, (int)c);
+        free(mark);
+        SRB_bsr_free(bsr);
+        return -1;
+    }
+
+    bsr->colind = (SRB_INT*)malloc((bsr->nnzb > 0 ? bsr->nnzb : 1) * sizeof(SRB_INT));
+    bsr->values = SRB_block_alloc(bsr->nnzb * r * c);
+    if (bsr->colind == NULL || bsr->values == NULL){
+        free(mark);
+        SRB_bsr_free(bsr);
+        return -1;
+    }
+    bsr->fill = t->nnz > 0 ? (double)bsr->nnzb * r * c / t->nnz : 1;
+
+    // place the blocks, zero them from the thread that owns the block row
+#ifdef _OPENMP
+#pragma omp parallel
+#endif
+    {
+        SRB_INT *seen = mark + (size_t)SRB_block_tid() * 2 * nb;
+        SRB_INT *slot = seen + nb;
+        for (SRB_INT J = 0; J < nb; ++J) seen[J] = -1;
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic, 64)
+#endif
+        for (SRB_INT I = 0; I < mb; ++I){
+            SRB_INT pos = bsr->rowptr[I];
+            SRB_INT end = (I + 1) * r < t->rows ? (I + 1) * r : t->rows;
+            for (SRB_INT e = t->ptr[I * r]; e < t->ptr[end]; ++e){
+                SRB_INT J = t->col[e] / c;
+                if (seen[J] != I){
+                    seen[J] = I;
+                    bsr->colind[pos++] = J;
+                }
+            }
+            qsort(bsr->colind + bsr->rowptr[I], pos - bsr->rowptr[I], sizeof(SRB_INT),
+                    SRB_block_cmp);
+            for (SRB_INT b = bsr->rowptr[I]; b < pos; ++b)
+                slot[bsr->colind[b]] = b;
+            memset(bsr->values + bsr->rowptr[I] * r * c, 0,
+                    (pos - bsr->rowptr[I]) * r * c * sizeof(SRB_Scalar));
+
+            for (SRB_INT i = I * r; i < end; ++i){
+                for (SRB_INT e = t->ptr[i]; e < t->ptr[i + 1]; ++e){
+                    SRB_INT j = t->col[e], J = j / c;
+                    t->col[e] = slot[J] * r * c + (i - I * r) * c + (j - J * c);
+                }
+            }
+        }
+    }
+
+    free(mark);
+    return 0;
+}
+
+struct rb_sell_key {
+    SRB_INT len;
+    SRB_INT row;
+};
+
+// longest rows first, stable on the row number
+static int SRB_sell_cmp(const void *a, const void *b){
+    const struct rb_sell_key *x = (const struct rb_sell_key*)a;
+    const struct rb_sell_key *y = (const struct rb_sell_key*)b;
+    if (x->len != y->len)
+        return x->len > y->len ? -1 : 1;
+    return (x->row > y->row) - (x->row < y->row);
+}
+
+// SELL-C-sigma structure from the row view; t->col becomes the value offset
+static int SRB_sell_build(rb_sell_t *sell, rb_rows_t *t, SRB_INT cols, SRB_INT C,
+        SRB_INT sigma){
+    struct rb_sell_key *key;
+    SRB_INT rows = t->rows;
+
+    if (C <= 0) C = SRBIO_BLOCK_ALIGN / sizeof(SRB_Scalar);
+    if (sigma <= 0) sigma = 32 * C;
+
+    memset(sell, 0, sizeof(rb_sell_t));
+    sell->rows = rows;
+    sell->cols = cols;
+    sell->nnz = t->nnz;
+    sell->C = C;
+    sell->sigma = sigma;
+    sell->nchunks = (rows + C - 1) / C;
+
+    sell->chunkptr = (SRB_INT*)malloc((sell->nchunks + 1) * sizeof(SRB_INT));
+    sell->chunklen = (SRB_INT*)malloc((sell->nchunks > 0 ? sell->nchunks : 1) * sizeof(SRB_INT));
+    sell->perm = (SRB_INT*)malloc((rows > 0 ? rows : 1) * sizeof(SRB_INT));
+    key = (struct rb_sell_key*)malloc((rows > 0 ? rows : 1) * sizeof(struct rb_sell_key));
+    if (sell->chunkptr == NULL || sell->chunklen == NULL || sell->perm == NULL || key == NULL){
+        free(key);
+        SRB_sell_free(sell);
+        return -1;
+    }
+
+    // sort the rows of each sigma window by length
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 1)
+#endif
+    for (SRB_INT w = 0; w < rows; w += sigma){
+        SRB_INT end = w + sigma < rows ? w + sigma : rows;
+        for (SRB_INT i = w; i < end; ++i){
+            key[i].len = t->ptr[i + 1] - t->ptr[i];
+            key[i].row = i;
+        }
+        qsort(key + w, end - w, sizeof(struct rb_sell_key), SRB_sell_cmp);
+        for (SRB_INT i = w; i < end; ++i)
+            sell->perm[i] = key[i].row;
+    }
+
+    sell->chunkptr[0] = 0;
+    for (SRB_INT k = 0; k < sell->nchunks; ++k){
+        SRB_INT len = 0;
+        for (SRB_INT s = k * C; s < (k + 1) * C && s < rows; ++s)
+            if (key[s].len > len) len = key[s].len;
+        sell->chunklen[k] = len;
+        sell->chunkptr[k + 1] = sell->chunkptr[k] + len * C;
+    }
+    free(key);
+
+    SRB_INT total = sell->chunkptr[sell->nchunks];
+    sell->colind = (SRB_INT*)malloc((total > 0 ? total : 1) * sizeof(SRB_INT));
+    sell->values = SRB_block_alloc(total);
+    if (sell->colind == NULL || sell->values == NULL){
+        SRB_sell_free(sell);
+        return -1;
+    }
+    sell->fill = t->nnz > 0 ? (double)total / t->nnz : 1;
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 16)
+#endif
+    for (SRB_INT k = 0; k < sell->nchunks; ++k){
+        SRB_INT base = sell->chunkptr[k];
+        for (SRB_INT s = 0; s < C; ++s){
+            SRB_INT len = 0;
+            if (k * C + s < rows){
+                SRB_INT i = sell->perm[k * C + s];
+                len = t->ptr[i + 1] - t->ptr[i];
+                for (SRB_INT q = 0; q < len; ++q){
+                    SRB_INT e = t->ptr[i] + q;
+                    SRB_INT d = base + q * C + s;
+                    sell->colind[d] = t->col[e];
+                    sell->values[d] = 0;
+                    t->col[e] = d;
+                }
+            }
+            for (SRB_INT q = len; q < sell->chunklen[k]; ++q){
+                sell->colind[base + q * C + s] = 0;
+                sell->values[base + q * C + s] = 0;
+            }
+        }
+    }
+    return 0;
+}
+
+// copy the values of `mat` to the offsets left in t->col
+static void SRB_block_fill(SRB_Scalar *values, const rb_rows_t *t, const rb_matrix_info_t *mat){
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+    for (SRB_INT e = 0; e < t->nnz; ++e)
+        values[t->col[e]] = SRB_block_value(mat, t->src[e]);
+}
+
+int SRB_to_bsr(const rb_matrix_info_t *mat, SRB_INT r, SRB_INT c, rb_bsr_t *bsr){
+    rb_rows_t t;
+    int ret;
+
+    ret = SRB_block_check(mat);
+    if (ret != 0)
+        return ret;
+    if (r <= 0 || c <= 0){
+        ret = SRB_bsr_pick(mat, &r, &c, NULL);
+        if (ret != 0)
+            return ret;
+    }
+
+    ret = SRB_rows_init(&t, mat);
+    if (ret != 0)
+        return ret;
+    ret = SRB_bsr_build(bsr, &t, mat->cols, r, c);
+    if (ret == 0)
+        SRB_block_fill(bsr->values, &t, mat);
+    SRB_rows_free(&t);
+    return ret;
+}
+
+int SRB_to_sell(const rb_matrix_info_t *mat, SRB_INT C, SRB_INT sigma, rb_sell_t *sell){
+    rb_rows_t t;
+    int ret;
+
+    ret = SRB_block_check(mat);
+    if (ret != 0)
+        return ret;
+
+    ret = SRB_rows_init(&t, mat);
+    if (ret != 0)
+        return ret;
+    ret = SRB_sell_build(sell, &t, mat->cols, C, sigma);
+    if (ret == 0)
+        SRB_block_fill(sell->values, &t, mat);
+    SRB_rows_free(&t);
+    return ret;
+}
+
+// direct read: the layout is built as soon as the structure is parsed,
+// then every value is stored at its final offset, the CSC values are
+// never materialized
+struct rb_block_read {
+    char format;        // 'b': BSR, 's': SELL
+    SRB_INT p1, p2;     // r, c or C, sigma
+    rb_bsr_t *bsr;
+    rb_sell_t *sell;
+    SRB_Scalar *values;
+    SRB_INT *pos;       // offset of the k-th file entry
+    SRB_INT *mirror;    // offset of its mirror, -1 on the diagonal
+    int negate;
+};
+
+static int SRB_block_begin(void *p, rb_matrix_info_t *mat){
+    struct rb_block_read *ctx = (struct rb_block_read*)p;
+    rb_rows_t t;
+    int ret;
+
+    ret = SRB_block_check(mat);
+    if (ret != 0)
+        return ret;
+    if (ctx->format == 'b' && (ctx->p1 <= 0 || ctx->p2 <= 0)){
+        ret = SRB_bsr_pick(mat, &ctx->p1, &ctx->p2, NULL);
+        if (ret != 0)
+            return ret;
+    }
+
+    ret = SRB_rows_init(&t, mat);
+    if (ret != 0)
+        return ret;
+    if (ctx->format == 'b'){
+        ret = SRB_bsr_build(ctx->bsr, &t, mat->cols, ctx->p1, ctx->p2);
+        ctx->values = ctx->bsr->values;
+    } else {
+        ret = SRB_sell_build(ctx->sell, &t, mat->cols, ctx->p1, ctx->p2);
+        ctx->values = ctx->sell->values;
+    }
+    if (ret != 0){
+        SRB_rows_free(&t);
+        return ret;
+    }
+
+    ctx->pos = (SRB_INT*)malloc((mat->nnz > 0 ? mat->nnz : 1) * sizeof(SRB_INT));
+    if (ctx->pos != NULL && SRB_block_mirrored(mat)){
+        ctx->mirror = (SRB_INT*)malloc((mat->nnz > 0 ? mat->nnz : 1) * sizeof(SRB_INT));
+        if (ctx->mirror != NULL)
+            for (SRB_INT k = 0; k < mat->nnz; ++k) ctx->mirror[k] = -1;
+    }
+    if (ctx->pos == NULL || (SRB_block_mirrored(mat) && ctx->mirror == NULL)){
+        SRB_rows_free(&t);
+        return -1;
+    }
+    ctx->negate = mat->stype == 'z';
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static)
+#endif
+    for (SRB_INT e = 0; e < t.nnz; ++e){
+        if (t.src[e] >= 0)
+            ctx->pos[t.src[e]] = t.col[e];
+        else
+            ctx->mirror[-t.src[e] - 1] = t.col[e];
+    }
+    SRB_rows_free(&t);
+
+    // the parser is done with the row indices
+    free(mat->rowind);
+    mat->rowind = NULL;
+
+    if (mat->mtype == 'p'){
+        for (SRB_INT k = 0; k < mat->nnz; ++k){
+            ctx->values[ctx->pos[k]] = 1;
+            if (ctx->mirror != NULL && ctx->mirror[k] >= 0)
+                ctx->values[ctx->mirror[k]] = ctx->negate ? -1 : 1;
+        }
+    }
+    return 0;
+}
+
+static void SRB_block_put(void *p, SRB_INT k, SRB_Scalar v){
+    struct rb_block_read *ctx = (struct rb_block_read*)p;
+    ctx->values[ctx->pos[k]] = v;
+    if (ctx->mirror != NULL && ctx->mirror[k] >= 0)
+        ctx->values[ctx->mirror[k]] = ctx->negate ? -v : v;
+}
+
+static int SRB_read_block(const char *filename, rb_file_compress_t flag,
+        struct rb_block_read *ctx){
+    rb_matrix_info_t mat;
+    rb_value_sink_t sink;
+    int ret;
+
+    sink.begin = SRB_block_begin;
+    sink.put = SRB_block_put;
+    sink.ctx = ctx;
+
+    SRB_init(&mat);
+    ret = SRB_read_into(filename, &mat, flag, NULL, &sink);
+    SRB_destroy(&mat);
+
+    free(ctx->pos);
+    free(ctx->mirror);
+    if (ret != 0 && ctx->values != NULL){
+        if (ctx->format == 'b') SRB_bsr_free(ctx->bsr);
+        else SRB_sell_free(ctx->sell);
+    }
+    return ret;
+}
+
+int SRB_read_bsr(const char *filename, rb_file_compress_t flag, SRB_INT r, SRB_INT c,
+        rb_bsr_t *bsr){
+    struct rb_block_read ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.format = 'b';
+    ctx.p1 = r;
+    ctx.p2 = c;
+    ctx.bsr = bsr;
+    return SRB_read_block(filename, flag, &ctx);
+}
+
+int SRB_read_sell(const char *filename, rb_file_compress_t flag, SRB_INT C, SRB_INT sigma,
+        rb_sell_t *sell){
+    struct rb_block_read ctx;
+    memset(&ctx, 0, sizeof(ctx));
+    ctx.format = 's';
+    ctx.p1 = C;
+    ctx.p2 = sigma;
+    ctx.sell = sell;
+    return SRB_read_block(filename, flag, &ctx);
+}
@@ -0,0 +1,263 @@
+/*
+ * ===========================================================================
+ *
+ *       Filename:  SRB_cache.c
+ *
+ *    Description:  thread-safe LRU cache of loaded matrices
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 05:21:40 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Haoyang Liu (), liuhaoyang@pku.edu.cn
+ *   Organization:  BICMR, Peking University
+ *      Copyright:  Copyright (c) 2021, Haoyang Liu
+ *
+ * ===========================================================================
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "SRBio.h"
+
+#define RB_CACHE_LOADING 0
+#define RB_CACHE_READY   1
+#define RB_CACHE_FAILED  2
+
+// `mat` must stay the first member: handles point to it
+struct rb_cache_entry {
+    rb_matrix_info_t mat;
+    char *path;
+    int flag;
+
+    // file identity at load time
+    dev_t dev;
+    ino_t ino;
+    off_t size;
+    struct timespec mtime;
+
+    size_t bytes;
+    int refs;
+    int state;
+    int info;
+    int listed;
+
+    struct rb_cache_entry *prev;
+    struct rb_cache_entry *next;
+};
+
+typedef struct rb_cache_entry rb_cache_entry_t;
+
+// entries are kept in a list ordered from most to least recently used,
+// the working set is expected to be small
+struct rb_cache {
+    pthread_mutex_t lock;
+    pthread_cond_t loaded;
+    size_t budget;
+    size_t bytes;
+    rb_cache_entry_t *head;
+    rb_cache_entry_t *tail;
+};
+
+static size_t SRB_cache_footprint(const rb_matrix_info_t *mat){
+    size_t bytes = (mat->cols + 1) * sizeof(SRB_INT) + mat->nnz * sizeof(SRB_INT);
+    if (mat->valptr_d != NULL)
+        bytes += mat->nnz * sizeof(SRB_Scalar);
+    if (mat->valptr_i != NULL)
+        bytes += mat->nnz * sizeof(SRB_INT);
+    return bytes;
+}
+
+static void SRB_cache_unlink(rb_cache_t *cache, rb_cache_entry_t *e){
+    if (!e->listed)
+        return;
+    if (e->prev != NULL) e->prev->next = e->next;
+    else cache->head = e->next;
+    if (e->next != NULL) e->next->prev = e->prev;
+    else cache->tail = e->prev;
+    e->prev = e->next = NULL;
+    e->listed = 0;
+    cache->bytes -= e->bytes;
+}
+
+static void SRB_cache_push_front(rb_cache_t *cache, rb_cache_entry_t *e){
+    e->prev = NULL;
+    e->next = cache->head;
+    if (cache->head != NULL) cache->head->prev = e;
+    cache->head = e;
+    if (cache->tail == NULL) cache->tail = e;
+    e->listed = 1;
+    cache->bytes += e->bytes;
+}
+
+static void SRB_cache_free_entry(rb_cache_entry_t *e){
+    SRB_destroy(&e->mat);
+    free(e->path);
+    free(e);
+}
+
+// drop unused entries from the cold end until the budget is met
+static void SRB_cache_evict(rb_cache_t *cache){
+    rb_cache_entry_t *e = cache->tail;
+    while (e != NULL && cache->bytes > cache->budget){
+        rb_cache_entry_t *prev = e->prev;
+        if (e->refs == 0 && e->state != RB_CACHE_LOADING){
+            SRB_cache_unlink(cache, e);
+            SRB_cache_free_entry(e);
+        }
+        e = prev;
+    }
+}
+
+rb_cache_t *SRB_cache_create(size_t budget){
+    rb_cache_t *cache = (rb_cache_t*)calloc(1, sizeof(rb_cache_t));
+    if (cache == NULL)
+        return NULL;
+    pthread_mutex_init(&cache->lock, NULL);
+    pthread_cond_init(&cache->loaded, NULL);
+    cache->budget = budget;
+    return cache;
+}
+
+// all handles must have been released
+void SRB_cache_destroy(rb_cache_t *cache){
+    rb_cache_entry_t *e = cache->head;
+    while (e != NULL){
+        rb_cache_entry_t *next = e->next;
+        SRB_cache_free_entry(e);
+        e = next;
+    }
+    pthread_cond_destroy(&cache->loaded);
+    pthread_mutex_destroy(&cache->lock);
+    free(cache);
+}
+
+void SRB_cache_set_budget(rb_cache_t *cache, size_t budget){
+    pthread_mutex_lock(&cache->lock);
+    cache->budget = budget;
+    SRB_cache_evict(cache);
+    pthread_mutex_unlock(&cache->lock);
+}
+
+size_t SRB_cache_usage(rb_cache_t *cache){
+    pthread_mutex_lock(&cache->lock);
+    size_t bytes = cache->bytes;
+    pthread_mutex_unlock(&cache->lock);
+    return bytes;
+}
+
+// returns a read-only matrix shared with other callers, to be given back
+// with SRB_cache_release, or NULL with the error code of SRB_read in info
+const rb_matrix_info_t *SRB_cache_get(rb_cache_t *cache, const char *filename,
+        rb_file_compress_t flag, int *info){
+    struct stat st;
+    rb_cache_entry_t *e;
+    int ret;
+
+    if (stat(filename, &st) != 0){
+        if (info != NULL) *info = -100;
+        return NULL;
+    }
+
+    pthread_mutex_lock(&cache->lock);
+    e = cache->head;
+    while (e != NULL){
+        rb_cache_entry_t *next = e->next;
+        if (e->flag == (int)flag && strcmp(e->path, filename) == 0){
+            if (e->dev == st.st_dev && e->ino == st.st_ino && e->size == st.st_size &&
+                    e->mtime.tv_sec == st.st_mtim.tv_sec &&
+                    e->mtime.tv_nsec == st.st_mtim.tv_nsec)
+                break;
+
+            // file changed on disk, current holders keep the old copy
+            SRB_cache_unlink(cache, e);
+            if (e->refs == 0 && e->state != RB_CACHE_LOADING)
+                SRB_cache_free_entry(e);
+        }
+        e = next;
+    }
+
+    if (e != NULL){
+        // hit, or wait for the thread which is loading the same file
+        ++e->refs;
+        while (e->state == RB_CACHE_LOADING)
+            pthread_cond_wait(&cache->loaded, &cache->lock);
+        if (e->state == RB_CACHE_FAILED){
+            ret = e->info;
+            if (--e->refs == 0 && !e->listed)
+                SRB_cache_free_entry(e);
+            pthread_mutex_unlock(&cache->lock);
+            if (info != NULL) *info = ret;
+            return NULL;
+        }
+        SRB_cache_unlink(cache, e);
+        SRB_cache_push_front(cache, e);
+        pthread_mutex_unlock(&cache->lock);
+        if (info != NULL) *info = 0;
+        return &e->mat;
+    }
+
+    // miss: publish a loading entry, then parse without holding the lock
+    e = (rb_cache_entry_t*)calloc(1, sizeof(rb_cache_entry_t));
+    if (e == NULL || (e->path = strdup(filename)) == NULL){
+        free(e);
+        pthread_mutex_unlock(&cache->lock);
+        if (info != NULL) *info = -1;
+        return NULL;
+    }
+    SRB_init(&e->mat);
+    e->flag = (int)flag;
+    e->dev = st.st_dev;
+    e->ino = st.st_ino;
+    e->size = st.st_size;
+    e->mtime = st.st_mtim;
+    e->refs = 1;
+    e->state = RB_CACHE_LOADING;
+    SRB_cache_push_front(cache, e);
+    pthread_mutex_unlock(&cache->lock);
+
+    ret = SRB_read(filename, &e->mat, flag);
+
+    pthread_mutex_lock(&cache->lock);
+    if (ret == 0){
+        e->state = RB_CACHE_READY;
+        if (e->listed){
+            SRB_cache_unlink(cache, e);
+            e->bytes = SRB_cache_footprint(&e->mat);
+            SRB_cache_push_front(cache, e);
+        } else {
+            e->bytes = SRB_cache_footprint(&e->mat);
+        }
+        SRB_cache_evict(cache);
+    } else {
+        e->state = RB_CACHE_FAILED;
+        e->info = ret;
+        SRB_cache_unlink(cache, e);
+        --e->refs;
+    }
+    pthread_cond_broadcast(&cache->loaded);
+    if (ret != 0 && e->refs == 0)
+        SRB_cache_free_entry(e);
+    pthread_mutex_unlock(&cache->lock);
+
+    if (info != NULL) *info = ret;
+    return ret == 0 ? &e->mat : NULL;
+}
+
+void SRB_cache_release(rb_cache_t *cache, const rb_matrix_info_t *mat){
+    rb_cache_entry_t *e = (rb_cache_entry_t*)mat;
+
+    pthread_mutex_lock(&cache->lock);
+    if (--e->refs == 0 && !e->listed)
+        SRB_cache_free_entry(e);
+    else
+        SRB_cache_evict(cache);
+    pthread_mutex_unlock(&cache->lock);
+}
@@ -0,0 +1,101 @@
+/*
+ * ===========================================================================
+ *
+ *       Filename:  SRB_cards.c
+ *
+ *    Description:  an RB file opened at its rowind and value blocks
+ *
+ *        Version:  1.0
+ *        Created:  10/20/2026 12:35:10 AM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Haoyang Liu (), liuhaoyang@pku.edu.cn
+ *   Organization:  BICMR, Peking University
+ *      Copyright:  Copyright (c) 2021, Haoyang Liu
+ *
+ * ===========================================================================
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SRBio.h"
+#include "private/read.h"
+#include "private/cards.h"
+
+void SRB_stream_close(rb_stream_t *s){
+    if (s->ind.fp != NULL) s->rb_close(s->ind.fp);
+    if (s->val.fp != NULL) s->rb_close(s->val.fp);
+    s->ind.fp = s->val.fp = NULL;
+    free(s->hdr.colptr);
+    s->hdr.colptr = NULL;
+}
+
+// colptr is parsed and checked, both streams are left at their blocks
+int SRB_stream_open(rb_stream_t *s, const char *filename, rb_file_compress_t flag,
+        int values){
+    SRB_open_f rb_open;
+    SRB_gets_f rb_gets;
+    SRB_INT ptrcrd, indcrd, valcrd;
+    rb_matrix_info_t tmp;
+    int ret;
+
+    memset(s, 0, sizeof(rb_stream_t));
+    SRB_init(&s->hdr);
+    if (SRB_read_backend(flag, &rb_open, &s->rb_close, &rb_gets) != 0)
+        return -999;
+
+    s->ind.fp = rb_open(filename, (flag & SRB_IO_DIRECT) ? "rd" : "r");
+    if (s->ind.fp == NULL){
+        fprintf(stderr, "Failed to open file: %s.\n", filename);
+        return -100;
+    }
+    s->ind.gets = s->val.gets = rb_gets;
+    s->ind.pos = s->val.pos = "";
+
+    ret = SRB_read_header(s->ind.fp, &s->hdr, rb_gets, &ptrcrd, &indcrd, &valcrd);
+    if (ret != 0)
+        return ret;
+    if (s->hdr.mtype == 'c' || s->hdr.mtype == 'q'){
+        fprintf(stderr, "SRB_stream: matrix type %c is not supported.\n", s->hdr.mtype);
+        return -999;
+    }
+
+    s->hdr.colptr = (SRB_INT*)malloc((s->hdr.cols + 1) * sizeof(SRB_INT));
+    if (s->hdr.colptr == NULL)
+        return -1;
+    for (SRB_INT j = 0; j <= s->hdr.cols; ++j){
+        if (SRB_cards_int(&s->ind, &s->hdr.colptr[j]) != 0 ||
+                (j > 0 && s->hdr.colptr[j] < s->hdr.colptr[j - 1])){
+            fprintf(stderr, "SRB_stream: colptr of %s is corrupted.\n", filename);
+            return -1;
+        }
+    }
+    if (s->hdr.colptr[0] != 1 || s->hdr.colptr[s->hdr.cols] != s->hdr.nnz + 1){
+        fprintf(stderr, "SRB_stream: colptr of %s does not match nnz.\n", filename);
+        return -1;
+    }
+
+    if (s->hdr.mtype == 'p' || !values)
+        return 0;
+
+    // the second stream skips the index cards unparsed
+    s->val.fp = rb_open(filename, "r");
+    if (s->val.fp == NULL){
+        fprintf(stderr, "Failed to open file: %s.\n", filename);
+        return -100;
+    }
+    SRB_init(&tmp);
+    ret = SRB_read_header(s->val.fp, &tmp, rb_gets, &ptrcrd, &indcrd, &valcrd);
+    if (ret != 0)
+        return ret;
+    for (SRB_INT i = 0; i < ptrcrd + indcrd; ++i){
+        if (rb_gets(s->val.buffer, SRBIO_LINE_MAX + 2, s->val.fp) == NULL){
+            fprintf(stderr, "SRB_stream: %s is truncated.\n", filename);
+            return -3;
+        }
+    }
+    return 0;
+}
@@ -0,0 +1,630 @@
+/*
+ * ===========================================================================
+ *
+ *       Filename:  SRB_convert.c
+ *
+ *    Description:  out-of-core transpose and symmetric expansion
+ *
+ *        Version:  1.0
+ *        Created:  10/20/2026 01:14:52 AM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Haoyang Liu (), liuhaoyang@pku.edu.cn
+ *   Organization:  BICMR, Peking University
+ *      Copyright:  Copyright (c) 2021, Haoyang Liu
+ *
+ * ===========================================================================
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "SRBio.h"
+#include "private/cards.h"
+#include "private/sink.h"
+#include "private/write.h"
+
+// memory for the entries when no budget is given
+#define SRBIO_CONVERT_BUDGET ((size_t)256 << 20)
+
+union rb_convert_value {
+    double d;
+    SRB_INT i;
+};
+
+// an entry at its place in the result, from 0
+struct rb_convert_entry {
+    SRB_INT col;
+    SRB_INT row;
+    union rb_convert_value v;
+};
+
+// entries of the result columns [col0, col1); they are staged in `buf`
+// and spilled to their region of the spill file when it is full, a bucket
+// that never spilled is sorted in place
+struct rb_bucket {
+    SRB_INT col0, col1;
+    long long count;            // entries of the bucket
+    long long spilled;          // entries already in the spill file
+    struct rb_convert_entry *buf;
+    size_t len;
+    size_t cap;
+};
+
+struct rb_convert {
+    rb_stream_t in;
+    int transpose;
+    int expand;
+    char skew;                  // the mirrored entry is negated for 'z'
+    int negate;                 // every entry is negated, A^T of a stored 'z'
+    int values;                 // 'r' or 'i', 0 for patterns
+    SRB_INT rows, cols;         // of the result
+    long long nnz;
+    long long *ptr;             // cols + 1 offsets of the result from 0
+    struct rb_bucket *bucket;
+    int nbucket;
+    int fd;                     // spill file, -1 until needed
+    char *spill;
+};
+
+typedef struct rb_convert rb_convert_t;
+typedef struct rb_convert_entry rb_convert_entry_t;
+
+static void SRB_convert_free(rb_convert_t *cv){
+    SRB_stream_close(&cv->in);
+    free(cv->ptr);
+    if (cv->bucket != NULL){
+        for (int b = 0; b < cv->nbucket; ++b)
+            free(cv->bucket[b].buf);
+        free(cv->bucket);
+    }
+    if (cv->fd >= 0)
+        close(cv->fd);
+    free(cv->spill);
+}
+
+// the entry (i, j) of the file, from 0, in place in the result
+static inline void SRB_convert_place(const rb_convert_t *cv, SRB_INT i, SRB_INT j,
+        SRB_INT *row, SRB_INT *col){
+    *row = cv->transpose ? j : i;
+    *col = cv->transpose ? i : j;
+}
+
+static int SRB_convert_bucket_of(const rb_convert_t *cv, SRB_INT col){
+    int lo = 0, hi = cv->nbucket - 1;
+    while (lo < hi){
+        int mid = lo + (hi - lo + 1) / 2;
+        if (cv->bucket[mid].col0 <= col) lo = mid;
+        else hi = mid - 1;
+    }
+    return lo;
+}
+
+static int SRB_convert_spill_open(rb_convert_t *cv){
+    if (cv->fd >= 0)
+        return 0;
+    // a unique name next to the output, an existing file is never touched
+    cv->fd = mkstemp(cv->spill);
+    if (cv->fd < 0){
+        fprintf(stderr, "SRB_convert: failed to create %s.\n", cv->spill);
+        return -101;
+    }
+    // the name is not needed any more, the file goes with the descriptor
+    unlink(cv->spill);
+    return 0;
+}
+
+static int SRB_convert_pwrite(int fd, const void *data, size_t len, off_t off){
+    const char *p = (const char*)data;
+    while (len > 0){
+        ssize_t n = pwrite(fd, p, len, off);
+        if (n <= 0)
+            return -101;
+        p += n;
+        len -= (size_t)n;
+        off += n;
+    }
+    return 0;
+}
+
+static int SRB_convert_pread(int fd, void *data, size_t len, off_t off){
+    char *p = (char*)data;
+    while (len > 0){
+        ssize_t n = pread(fd, p, len, off);
+        if (n <= 0)
+            return -101;
+        p += n;
+        len -= (size_t)n;
+        off += n;
+    }
+    return 0;
+}
+
+static int SRB_convert_flush(rb_convert_t *cv, struct rb_bucket *bk){
+    off_t off = (off_t)(cv->ptr[bk->col0] + bk->spilled) * sizeof(rb_convert_entry_t);
+    int ret;
+
+    if (bk->len == 0)
+        return 0;
+    ret = SRB_convert_spill_open(cv);
+    if (ret == 0)
+        ret = SRB_convert_pwrite(cv->fd, bk->buf, bk->len * sizeof(rb_convert_entry_t), off);
+    if (ret != 0){
+        fprintf(stderr, "SRB_convert: failed to write %s.\n", cv->spill);
+        return ret;
+    }
+    bk->spilled += bk->len;
+    bk->len = 0;
+    return 0;
+}
+
+static inline int SRB_convert_push(rb_convert_t *cv, SRB_INT i, SRB_INT j,
+        union rb_convert_value v){
+    rb_convert_entry_t *e;
+    struct rb_bucket *bk;
+
+    SRB_INT row, col;
+    SRB_convert_place(cv, i, j, &row, &col);
+    bk = cv->bucket + (cv->nbucket == 1 ? 0 : SRB_convert_bucket_of(cv, col));
+    if (bk->len == bk->cap){
+        int ret = SRB_convert_flush(cv, bk);
+        if (ret != 0)
+            return ret;
+    }
+    e = bk->buf + bk->len++;
+    e->col = col;
+    e->row = row;
+    e->v = v;
+    return 0;
+}
+
+// pass 1: the rowind block gives the size of every result column
+static int SRB_convert_count(rb_convert_t *cv, const char *filename, rb_file_compress_t flag){
+    rb_matrix_info_t *hdr;
+    long long *cnt;
+    int ret;
+
+    ret = SRB_stream_open(&cv->in, filename, flag, 0);
+    if (ret != 0)
+        return ret;
+    hdr = &cv->in.hdr;
+
+    cv->expand = cv->expand && (hdr->stype == 's' || hdr->stype == 'z' || hdr->stype == 'h');
+    cv->skew = hdr->stype == 'z';
+    if (cv->expand && hdr->rows != hdr->cols){
+        fprintf(stderr, "SRB_convert: a %c matrix must be square.\n", hdr->stype);
+        return -51;
+    }
+    // the stored triangle of A^T = A (or -A for 'z') is the same, so it
+    // stays lower as the format expects
+    if (!cv->expand && cv->transpose && (hdr->stype == 's' || hdr->stype == 'z' ||
+                hdr->stype == 'h') && hdr->rows == hdr->cols){
+        cv->transpose = 0;
+        cv->negate = cv->skew;
+    }
+    cv->rows = cv->transpose ? hdr->cols : hdr->rows;
+    cv->cols = cv->transpose ? hdr->rows : hdr->cols;
+
+    cnt = cv->ptr = (long long*)calloc((size_t)cv->cols + 1, sizeof(long long));
+    if (cnt == NULL)
+        return -1;
+
+    for (SRB_INT j = 0; j < hdr->cols; ++j){
+        for (SRB_INT k = hdr->colptr[j]; k < hdr->colptr[j + 1]; ++k){
+            SRB_INT i, row, col;
+            if (SRB_cards_int(&cv->in.ind, &i) != 0 || i < 1 || i > hdr->rows){
+                fprintf(stderr, "SRB_convert: rowind of %s is corrupted.\n", filename);
+                return -2;
+            }
+            --i;
+            SRB_convert_place(cv, i, j, &row, &col);
+            ++cnt[col];
+            if (cv->expand && i != j){
+                SRB_convert_place(cv, j, i, &row, &col);
+                ++cnt[col];
+            }
+        }
+    }
+
+    // counts to offsets
+    long long sum = 0;
+    for (SRB_INT c = 0; c <= cv->cols; ++c){
+        long long tmp = cnt[c];
+        cnt[c] = sum;
+        sum += tmp;
+    }
+    cv->nnz = sum;
+#ifndef SRBIO_ILP64
+    if (cv->nnz >= INT_MAX){
+        fprintf(stderr, "SRB_convert: %lld entries overflow 32-bit indices.\n", cv->nnz);
+        return -999;
+    }
+#endif
+
+    SRB_stream_close(&cv->in);
+    return 0;
+}
+
+// buckets of whole columns, each sorted within the budget
+static int SRB_convert_plan(rb_convert_t *cv, size_t budget){
+    // the entries and their sorted copy
+    long long cap = (long long)(budget / (2 * sizeof(rb_convert_entry_t)));
+    int nb = 0;
+
+    if (cap < 1) cap = 1;
+    for (SRB_INT c = 0; c < cv->cols || nb == 0; ++nb){
+        SRB_INT c1 = c + 1;
+        while (c1 < cv->cols && cv->ptr[c1 + 1] - cv->ptr[c] <= cap) ++c1;
+        c = c1;
+    }
+
+    cv->bucket = (struct rb_bucket*)calloc(nb, sizeof(struct rb_bucket));
+    if (cv->bucket == NULL)
+        return -1;
+    cv->nbucket = nb;
+
+    SRB_INT c = 0;
+    for (int b = 0; b < nb; ++b){
+        SRB_INT c1 = c + 1;
+        while (c1 < cv->cols && cv->ptr[c1 + 1] - cv->ptr[c] <= cap) ++c1;
+        if (c1 > cv->cols) c1 = cv->cols;
+        cv->bucket[b].col0 = c;
+        cv->bucket[b].col1 = c1;
+        cv->bucket[b].count = cv->ptr[c1] - cv->ptr[c];
+        c = c1;
+    }
+
+    // staging buffers share half of the budget, a single bucket is held whole
+    size_t each = nb == 1 ? (size_t)cv->bucket[0].count :
+        budget / 2 / sizeof(rb_convert_entry_t) / nb;
+    if (each < 256) each = 256;
+    for (int b = 0; b < nb; ++b){
+        struct rb_bucket *bk = cv->bucket + b;
+        bk->cap = (size_t)bk->count < each ? (size_t)bk->count : each;
+        bk->buf = (rb_convert_entry_t*)malloc((bk->cap > 0 ? bk->cap : 1) * sizeof(rb_convert_entry_t));
+        if (bk->buf == NULL)
+            return -1;
+    }
+
+#ifndef NDEBUG
+    printf("SRB_convert: %lld entries in %d buckets\n", cv->nnz, nb);
+#endif
+    return 0;
+}
+
+// pass 2: every entry goes to the bucket of its result column
+static int SRB_convert_distribute(rb_convert_t *cv, const char *filename, rb_file_compress_t flag){
+    rb_matrix_info_t *hdr;
+    int ret;
+
+    ret = SRB_stream_open(&cv->in, filename, flag, 1);
+    if (ret != 0)
+        return ret;
+    hdr = &cv->in.hdr;
+    cv->values = hdr->mtype == 'r' || hdr->mtype == 'i' ? hdr->mtype : 0;
+
+    for (SRB_INT j = 0; j < hdr->cols; ++j){
+        for (SRB_INT k = hdr->colptr[j]; k < hdr->colptr[j + 1]; ++k){
+            union rb_convert_value v;
+            SRB_INT i;
+            v.i = 0;
+            if (SRB_cards_int(&cv->in.ind, &i) != 0 || i < 1 || i > hdr->rows){
+                fprintf(stderr, "SRB_convert: rowind of %s is corrupted.\n", filename);
+                return -2;
+            }
+            if ((cv->values == 'r' && SRB_cards_real(&cv->in.val, &v.d) != 0) ||
+                    (cv->values == 'i' && SRB_cards_int(&cv->in.val, &v.i) != 0)){
+                fprintf(stderr, "SRB_convert: values of %s are corrupted.\n", filename);
+                return -3;
+            }
+            --i;
+            if (cv->negate){
+                if (cv->values == 'r') v.d = -v.d;
+                else v.i = -v.i;
+            }
+
+            ret = SRB_convert_push(cv, i, j, v);
+            if (ret == 0 && cv->expand && i != j){
+                if (cv->skew){
+                    if (cv->values == 'r') v.d = -v.d;
+                    else v.i = -v.i;
+                }
+                ret = SRB_convert_push(cv, j, i, v);
+            }
+            if (ret != 0)
+                return ret;
+        }
+    }
+
+    // the tails of spilled buckets, the others stay in memory
+    for (int b = 0; b < cv->nbucket; ++b){
+        struct rb_bucket *bk = cv->bucket + b;
+        if (bk->spilled == 0)
+            continue;
+        ret = SRB_convert_flush(cv, bk);
+        if (ret != 0)
+            return ret;
+        free(bk->buf);
+        bk->buf = NULL;
+    }
+    SRB_stream_close(&cv->in);
+    return 0;
+}
+
+static int SRB_convert_row_cmp(const void *x, const void *y){
+    SRB_INT a = ((const rb_convert_entry_t*)x)->row, b = ((const rb_convert_entry_t*)y)->row;
+    return (a > b) - (a < b);
+}
+
+// stable counting sort of n entries by column into `out`, the threads
+// take contiguous ranges of the input; then rows are sorted per column
+static int SRB_convert_sort(const rb_convert_t *cv, const struct rb_bucket *bk,
+        const rb_convert_entry_t *in, rb_convert_entry_t *out){
+    SRB_INT ncol = bk->col1 - bk->col0;
+    size_t n = (size_t)bk->count;
+    long long base = cv->ptr[bk->col0];
+    int nthreads = 1;
+    size_t *cnt;
+
+#ifdef _OPENMP
+    // keep the count arrays within a fraction of the bucket
+    nthreads = omp_get_max_threads();
+    if ((double)nthreads * ncol > n / 4.0 + ncol){
+        int cap = 1 + (int)(n / (4.0 * ncol + 1));
+        if (cap < nthreads) nthreads = cap;
+    }
+#endif
+
+    cnt = (size_t*)calloc((size_t)nthreads * ncol + 1, sizeof(size_t));
+    if (cnt == NULL)
+        return -1;
+
+#ifdef _OPENMP
+#pragma omp parallel num_threads(nthreads)
+#endif
+    {
+        int tid = 0, nt = 1;
+#ifdef _OPENMP
+        tid = omp_get_thread_num();
+        nt = omp_get_num_threads();
+#endif
+        size_t *c = cnt + (size_t)tid * ncol;
+        size_t k0 = n * tid / nt, k1 = n * (tid + 1) / nt;
+
+        for (size_t k = k0; k < k1; ++k)
+            ++c[in[k].col - bk->col0];
+
+#ifdef _OPENMP
+#pragma omp barrier
+#pragma omp single
+#endif
+        {
+            for (SRB_INT q = 0; q < ncol; ++q){
+                size_t pos = (size_t)(cv->ptr[bk->col0 + q] - base);
+                for (int t = 0; t < nt; ++t){
+                    size_t tmp = cnt[(size_t)t * ncol + q];
+                    cnt[(size_t)t * ncol + q] = pos;
+                    pos += tmp;
+                }
+            }
+        }
+
+        for (size_t k = k0; k < k1; ++k)
+            out[c[in[k].col - bk->col0]++] = in[k];
+    }
+    free(cnt);
+
+    // mirrored entries come first in their column, the file order usually
+    // leaves the rows sorted already
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 256)
+#endif
+    for (SRB_INT q = 0; q < ncol; ++q){
+        rb_convert_entry_t *e = out + (cv->ptr[bk->col0 + q] - base);
+        size_t len = (size_t)(cv->ptr[bk->col0 + q + 1] - cv->ptr[bk->col0 + q]);
+        for (size_t k = 1; k < len; ++k){
+            if (e[k].row < e[k - 1].row){
+                qsort(e, len, sizeof(rb_convert_entry_t), SRB_convert_row_cmp);
+                break;
+            }
+        }
+    }
+    return 0;
+}
+
+// pass 3: the buckets are sorted one at a time, the rows go to the file
+// and the sorted values back to the bucket, in memory or in the spill file
+static int SRB_convert_rows(rb_convert_t *cv, rb_card_writer_t *cw){
+    rb_convert_entry_t *in = NULL, *out = NULL;
+    size_t cap = 0;
+    int ret = 0;
+
+    for (int b = 0; b < cv->nbucket && ret == 0; ++b){
+        struct rb_bucket *bk = cv->bucket + b;
+        size_t n = (size_t)bk->count;
+        off_t off = (off_t)cv->ptr[bk->col0] * sizeof(rb_convert_entry_t);
+        rb_convert_entry_t *src = bk->buf;
+
+        if (n == 0)
+            continue;
+        if (n > cap){
+            free(in);
+            free(out);
+            in = NULL;
+            out = (rb_convert_entry_t*)malloc(n * sizeof(rb_convert_entry_t));
+            cap = n;
+            if (out == NULL){
+                ret = -1;
+                break;
+            }
+        }
+        if (bk->spilled > 0){
+            if (in == NULL)
+                in = (rb_convert_entry_t*)malloc(cap * sizeof(rb_convert_entry_t));
+            if (in == NULL){
+                ret = -1;
+                break;
+            }
+            ret = SRB_convert_pread(cv->fd, in, n * sizeof(rb_convert_entry_t), off);
+            if (ret != 0){
+                fprintf(stderr, "SRB_convert: failed to read %s.\n", cv->spill);
+                break;
+            }
+            src = in;
+        }
+        ret = SRB_convert_sort(cv, bk, src, out);
+        if (ret != 0)
+            break;
+
+        for (size_t k = 0; k < n; ++k)
+            SRB_card_int(cw, (long)out[k].row + 1);
+
+        if (!cv->values)
+            continue;
+        // the values take the front of the bucket's own space
+        union rb_convert_value *v = (union rb_convert_value*)src;
+        for (size_t k = 0; k < n; ++k)
+            v[k] = out[k].v;
+        if (bk->spilled > 0)
+            ret = SRB_convert_pwrite(cv->fd, v, n * sizeof(union rb_convert_value), off);
+        if (ret != 0)
+            fprintf(stderr, "SRB_convert: failed to write %s.\n", cv->spill);
+    }
+
+    free(in);
+    free(out);
+    return ret;
+}
+
+static int SRB_convert_values(rb_convert_t *cv, rb_card_writer_t *cw, int precision){
+    union rb_convert_value *v = NULL;
+    size_t cap = 0;
+    int ret = 0;
+
+    for (int b = 0; b < cv->nbucket && ret == 0; ++b){
+        struct rb_bucket *bk = cv->bucket + b;
+        size_t n = (size_t)bk->count;
+        off_t off = (off_t)cv->ptr[bk->col0] * sizeof(rb_convert_entry_t);
+        const union rb_convert_value *src = (const union rb_convert_value*)bk->buf;
+
+        if (n == 0)
+            continue;
+        if (bk->spilled > 0){
+            if (n > cap){
+                free(v);
+                v = (union rb_convert_value*)malloc(n * sizeof(union rb_convert_value));
+                cap = n;
+                if (v == NULL){
+                    ret = -1;
+                    break;
+                }
+            }
+            ret = SRB_convert_pread(cv->fd, v, n * sizeof(union rb_convert_value), off);
+            if (ret != 0){
+                fprintf(stderr, "SRB_convert: failed to read %s.\n", cv->spill);
+                break;
+            }
+            src = v;
+        }
+        for (size_t k = 0; k < n; ++k){
+            if (cv->values == 'r')
+                SRB_card_real(cw, src[k].d, precision);
+            else
+                SRB_card_int(cw, (long)src[k].i);
+        }
+    }
+
+    free(v);
+    return ret;
+}
+
+static int SRB_convert_write(rb_convert_t *cv, const char *filename, int precision,
+        rb_file_compress_t flag){
+    char buffer[SRBIO_LINE_MAX + 2];
+    rb_matrix_info_t view = cv->in.hdr;
+    rb_card_writer_t cw;
+    rb_layout_t l;
+    rb_sink_t sink;
+    int ret;
+
+    view.rows = cv->rows;
+    view.cols = cv->cols;
+    view.nnz = (SRB_INT)cv->nnz;
+    view.mtype = cv->values ? (char)cv->values : 'p';
+    if (cv->expand) view.stype = 'u';
+    view.colptr = NULL;
+
+    ret = SRB_sink_open(&sink, filename, (flag & SRB_IO_DIRECT) ? "wd" : "w", flag, NULL);
+    if (ret != 0){
+        fprintf(stderr, "Failed to open file: %s.\n", filename);
+        return ret;
+    }
+
+    snprintf(buffer, SRBIO_LINE_MAX + 2, "%-72s%-8s\n", view.descr, view.key);
+    SRB_sink_puts(&sink, buffer);
+    ret = SRB_write_csc_header(&sink, &view, precision, &l);
+
+    if (ret == 0){
+        SRB_card_begin(&cw, &sink, l.ptr_w, l.ptr_n);
+        for (SRB_INT c = 0; c <= cv->cols; ++c)
+            SRB_card_int(&cw, (long)cv->ptr[c] + 1);
+        SRB_card_end(&cw);
+
+        SRB_card_begin(&cw, &sink, l.ind_w, l.ind_n);
+        ret = SRB_convert_rows(cv, &cw);
+        SRB_card_end(&cw);
+    }
+    if (ret == 0 && cv->values){
+        SRB_card_begin(&cw, &sink, l.val_w, l.val_n);
+        ret = SRB_convert_values(cv, &cw, precision);
+        SRB_card_end(&cw);
+    }
+
+    if (SRB_sink_close(&sink) != 0 && ret == 0){
+        fprintf(stderr, "SRB_convert: failed to write file: %s.\n", filename);
+        ret = -101;
+    }
+    return ret;
+}
+
+int SRB_convert(const char *in, rb_file_compress_t in_flag, const char *out, int precision,
+        rb_file_compress_t out_flag, int how, size_t budget){
+    rb_convert_t cv;
+    size_t len = strlen(out);
+    int ret;
+
+    precision = SRB_write_precision(precision, out_flag);
+    if (precision < 0)
+        return -999;
+
+    memset(&cv, 0, sizeof(rb_convert_t));
+    cv.transpose = (how & SRB_CONVERT_TRANSPOSE) != 0;
+    cv.expand = (how & SRB_CONVERT_EXPAND) != 0;
+    cv.fd = -1;
+    cv.spill = (char*)malloc(len + 16);
+    if (cv.spill == NULL)
+        return -1;
+    snprintf(cv.spill, len + 16, "%s.spill.XXXXXX", out);
+
+    ret = SRB_convert_count(&cv, in, in_flag);
+    if (ret == 0)
+        ret = SRB_convert_plan(&cv, budget > 0 ? budget : SRBIO_CONVERT_BUDGET);
+    if (ret == 0)
+        ret = SRB_convert_distribute(&cv, in, in_flag);
+    if (ret == 0)
+        ret = SRB_convert_write(&cv, out, precision, out_flag);
+
+    SRB_convert_free(&cv);
+    return ret;
+}
@@ -0,0 +1,265 @@
+/*
+ * ===========================================================================
+ *
+ *       Filename:  SRB_coo.c
+ *
+ *    Description:  CSC assembly of unsorted triplets
+ *
+ *        Version:  1.0
+ *        Created:  10/20/2026 05:47:33 AM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Haoyang Liu (), liuhaoyang@pku.edu.cn
+ *   Organization:  BICMR, Peking University
+ *      Copyright:  Copyright (c) 2021, Haoyang Liu
+ *
+ * ===========================================================================
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "SRBio.h"
+
+// stable sort of a column by row, the values (if any) move along; `tr`
+// and `tv` hold n / 2 entries. Duplicates stay in the order of the triplets
+// so their sum does not depend on the number of threads
+static void SRB_coo_sort(SRB_INT *r, SRB_Scalar *v, SRB_INT n, SRB_INT *tr, SRB_Scalar *tv){
+    if (n <= 32){
+        for (SRB_INT k = 1; k < n; ++k){
+            SRB_INT x = r[k];
+            SRB_Scalar y = v != NULL ? v[k] : 0;
+            SRB_INT q = k;
+            for (; q > 0 && r[q - 1] > x; --q){
+                r[q] = r[q - 1];
+                if (v != NULL) v[q] = v[q - 1];
+            }
+            r[q] = x;
+            if (v != NULL) v[q] = y;
+        }
+        return;
+    }
+
+    SRB_INT h = n / 2;
+    SRB_coo_sort(r, v, h, tr, tv);
+    SRB_coo_sort(r + h, v != NULL ? v + h : NULL, n - h, tr, tv);
+    if (r[h - 1] <= r[h])
+        return;
+
+    memcpy(tr, r, h * sizeof(SRB_INT));
+    if (v != NULL) memcpy(tv, v, h * sizeof(SRB_Scalar));
+    SRB_INT a = 0, b = h, d = 0;
+    while (a < h && b < n){
+        if (tr[a] <= r[b]){
+            if (v != NULL) v[d] = tv[a];
+            r[d++] = tr[a++];
+        } else {
+            if (v != NULL) v[d] = v[b];
+            r[d++] = r[b++];
+        }
+    }
+    for (; a < h; ++a, ++d){
+        r[d] = tr[a];
+        if (v != NULL) v[d] = tv[a];
+    }
+}
+
+// sums the duplicates of a sorted column into their first entry, in place,
+// and returns the entries left
+static SRB_INT SRB_coo_unique(SRB_INT *r, SRB_Scalar *v, SRB_INT n){
+    SRB_INT d = 0;
+    for (SRB_INT k = 1; k < n; ++k){
+        if (r[k] != r[d]){
+            r[++d] = r[k];
+            if (v != NULL) v[d] = v[k];
+        } else if (v != NULL){
+            v[d] += v[k];
+        }
+    }
+    return n > 0 ? d + 1 : 0;
+}
+
+int SRB_from_coo(rb_matrix_info_t *mat, SRB_INT rows, SRB_INT cols, SRB_INT nnz,
+        const SRB_INT *rowind, const SRB_INT *colind, const SRB_Scalar *val, int flags){
+    SRB_INT base = (flags & SRB_COO_ZERO_BASED) ? 0 : 1;
+    int lower = (flags & SRB_COO_LOWER) != 0;
+    int nthreads = 1;
+    SRB_INT bad = -1;
+
+    if (rows < 0 || cols < 0 || nnz < 0 || (lower && rows != cols)){
+        fprintf(stderr, "SRB_from_coo: illegal shape %ld x %ld (%ld entries).\n",
+                (long)rows, (long)cols, (long)nnz);
+        return -1;
+    }
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(static) reduction(max:bad)
+#endif
+    for (SRB_INT k = 0; k < nnz; ++k){
+        if (rowind[k] < base || rowind[k] >= rows + base ||
+                colind[k] < base || colind[k] >= cols + base)
+            bad = k > bad ? k : bad;
+    }
+    if (bad >= 0){
+        fprintf(stderr, "SRB_from_coo: entry %ld (%ld, %ld) is out of range.\n",
+                (long)bad, (long)rowind[bad], (long)colind[bad]);
+        return -1;
+    }
+
+#ifdef _OPENMP
+    // keep the count arrays within a fraction of the triplets
+    nthreads = omp_get_max_threads();
+    if ((double)nthreads * cols > nnz / 4.0 + cols){
+        int cap = 1 + (int)(nnz / (4.0 * cols + 1));
+        if (cap < nthreads) nthreads = cap;
+    }
+#endif
+
+    SRB_INT *ptr = (SRB_INT*)malloc((cols + 1) * sizeof(SRB_INT));
+    SRB_INT *cnt = (SRB_INT*)calloc((size_t)nthreads * cols + 1, sizeof(SRB_INT));
+    if (ptr == NULL || cnt == NULL){
+        free(ptr);
+        free(cnt);
+        return -1;
+    }
+
+    // counting sort by column: each thread counts its range of triplets,
+    // the counts become per-thread offsets so the scatter keeps their order
+#ifdef _OPENMP
+#pragma omp parallel num_threads(nthreads)
+#endif
+    {
+        int tid = 0, nt = 1;
+#ifdef _OPENMP
+        tid = omp_get_thread_num();
+        nt = omp_get_num_threads();
+#endif
+        SRB_INT *c = cnt + (size_t)tid * cols;
+        SRB_INT k0 = (SRB_INT)((long long)nnz * tid / nt);
+        SRB_INT k1 = (SRB_INT)((long long)nnz * (tid + 1) / nt);
+
+        for (SRB_INT k = k0; k < k1; ++k){
+            if (!lower || rowind[k] >= colind[k])
+                ++c[colind[k] - base];
+        }
+
+#ifdef _OPENMP
+#pragma omp barrier
+#pragma omp single
+#endif
+        {
+            SRB_INT pos = 0;
+            for (SRB_INT j = 0; j < cols; ++j){
+                ptr[j] = pos;
+                for (int q = 0; q < nt; ++q){
+                    SRB_INT tmp = cnt[(size_t)q * cols + j];
+                    cnt[(size_t)q * cols + j] = pos;
+                    pos += tmp;
+                }
+            }
+            ptr[cols] = pos;
+
+            // the triplets go straight to their column in the result,
+            // which is cut down once the duplicates are merged
+            mat->rows = rows;
+            mat->cols = cols;
+            mat->nnz = pos;
+            mat->mtype = val != NULL ? 'r' : 'p';
+            mat->stype = lower ? 's' : 'u';
+            mat->ftype = 'a';
+            mat->colptr = (SRB_INT*)malloc((cols + 1) * sizeof(SRB_INT));
+            mat->rowind = (SRB_INT*)malloc((pos > 0 ? pos : 1) * sizeof(SRB_INT));
+            mat->valptr_i = NULL;
+            mat->valptr_d = NULL;
+            if (val != NULL)
+                mat->valptr_d = (SRB_Scalar*)malloc((pos > 0 ? pos : 1) * sizeof(SRB_Scalar));
+        }
+
+        if (mat->colptr != NULL && mat->rowind != NULL && (val == NULL || mat->valptr_d != NULL)){
+            for (SRB_INT k = k0; k < k1; ++k){
+                if (lower && rowind[k] < colind[k])
+                    continue;
+                SRB_INT d = c[colind[k] - base]++;
+                mat->rowind[d] = rowind[k] - base + 1;
+                if (val != NULL) mat->valptr_d[d] = val[k];
+            }
+        }
+    }
+    if (mat->colptr == NULL || mat->rowind == NULL || (val != NULL && mat->valptr_d == NULL)){
+        SRB_destroy(mat);
+        free(ptr);
+        free(cnt);
+        return -1;
+    }
+
+    // per-column row sort and merge in place; cnt is reused for the merged
+    // column lengths
+    SRB_INT longest = 0;
+    for (SRB_INT j = 0; j < cols; ++j){
+        if (ptr[j + 1] - ptr[j] > longest)
+            longest = ptr[j + 1] - ptr[j];
+    }
+    int fail = 0;
+#ifdef _OPENMP
+#pragma omp parallel num_threads(nthreads) reduction(||:fail)
+#endif
+    {
+        SRB_INT *tr = (SRB_INT*)malloc((longest / 2 + 1) * sizeof(SRB_INT));
+        SRB_Scalar *tv = NULL;
+        if (val != NULL)
+            tv = (SRB_Scalar*)malloc((longest / 2 + 1) * sizeof(SRB_Scalar));
+        fail = tr == NULL || (val != NULL && tv == NULL);
+#ifdef _OPENMP
+#pragma omp for schedule(dynamic, 256)
+#endif
+        for (SRB_INT j = 0; j < cols; ++j){
+            if (fail)
+                continue;
+            SRB_INT *r = mat->rowind + ptr[j];
+            SRB_Scalar *v = val != NULL ? mat->valptr_d + ptr[j] : NULL;
+            SRB_coo_sort(r, v, ptr[j + 1] - ptr[j], tr, tv);
+            cnt[j] = SRB_coo_unique(r, v, ptr[j + 1] - ptr[j]);
+        }
+        free(tr);
+        free(tv);
+    }
+    if (fail){
+        SRB_destroy(mat);
+        free(ptr);
+        free(cnt);
+        return -1;
+    }
+
+    // the merged columns move left in order, a column never lands past the
+    // start of its own entries
+    mat->colptr[0] = 1;
+    for (SRB_INT j = 0; j < cols; ++j){
+        SRB_INT d = mat->colptr[j] - 1;
+        if (d != ptr[j]){
+            memmove(mat->rowind + d, mat->rowind + ptr[j], cnt[j] * sizeof(SRB_INT));
+            if (val != NULL)
+                memmove(mat->valptr_d + d, mat->valptr_d + ptr[j], cnt[j] * sizeof(SRB_Scalar));
+        }
+        mat->colptr[j + 1] = mat->colptr[j] + cnt[j];
+    }
+    if (mat->colptr[cols] - 1 < mat->nnz && mat->colptr[cols] > 1){
+        SRB_INT n = mat->colptr[cols] - 1;
+        SRB_INT *r = (SRB_INT*)realloc(mat->rowind, n * sizeof(SRB_INT));
+        if (r != NULL) mat->rowind = r;
+        if (val != NULL){
+            SRB_Scalar *v = (SRB_Scalar*)realloc(mat->valptr_d, n * sizeof(SRB_Scalar));
+            if (v != NULL) mat->valptr_d = v;
+        }
+    }
+    mat->nnz = mat->colptr[cols] - 1;
+
+    free(ptr);
+    free(cnt);
+    return 0;
+}
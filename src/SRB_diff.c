@@ -0,0 +1,235 @@
+/*
+ * ===========================================================================
+ *
+ *       Filename:  SRB_diff.c
+ *
+ *    Description:  streaming comparison of two RB files
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 09:14:48 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Haoyang Liu (), liuhaoyang@pku.edu.cn
+ *   Organization:  BICMR, Peking University
+ *      Copyright:  Copyright (c) 2021, Haoyang Liu
+ *
+ * ===========================================================================
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <pthread.h>
+
+#include "SRBio.h"
+#include "private/read.h"
+#include "private/cards.h"
+
+// entries of one file held at a time
+#define SRBIO_DIFF_BATCH (1 << 20)
+
+struct rb_entry {
+    SRB_INT row;
+    double val;
+};
+
+// only colptr and the current batch of a file stay in memory
+struct rb_diff_file {
+    rb_stream_t s;
+    struct rb_entry *e;
+    size_t cap;
+    SRB_INT j0, j1;             // columns of the batch
+    int err;
+};
+
+static void SRB_diff_close(struct rb_diff_file *f){
+    SRB_stream_close(&f->s);
+    free(f->e);
+}
+
+static int SRB_diff_open(struct rb_diff_file *f, const char *filename, rb_file_compress_t flag){
+    memset(f, 0, sizeof(struct rb_diff_file));
+    return SRB_stream_open(&f->s, filename, flag, 1);
+}
+
+static int SRB_entry_cmp(const void *x, const void *y){
+    SRB_INT a = ((const struct rb_entry*)x)->row, b = ((const struct rb_entry*)y)->row;
+    return (a > b) - (a < b);
+}
+
+// entries of columns [j0, j1), sorted by row in each column
+static void *SRB_diff_fill(void *p){
+    struct rb_diff_file *f = (struct rb_diff_file*)p;
+    SRB_INT base = f->s.hdr.colptr[f->j0];
+    size_t n = f->s.hdr.colptr[f->j1] - base;
+
+    if (n > f->cap){
+        free(f->e);
+        f->e = (struct rb_entry*)malloc(n * sizeof(struct rb_entry));
+        f->cap = f->e != NULL ? n : 0;
+        if (f->e == NULL){
+            f->err = -1;
+            return NULL;
+        }
+    }
+    for (size_t k = 0; k < n; ++k){
+        if (SRB_cards_int(&f->s.ind, &f->e[k].row) != 0){
+            f->err = -2;
+            return NULL;
+        }
+    }
+    for (size_t k = 0; k < n; ++k){
+        f->e[k].val = 0.0;
+        if (f->s.val.fp != NULL && SRB_cards_real(&f->s.val, &f->e[k].val) != 0){
+            f->err = -3;
+            return NULL;
+        }
+    }
+
+    // columns are usually sorted already, only the others are sorted here
+    for (SRB_INT j = f->j0; j < f->j1; ++j){
+        struct rb_entry *e = f->e + (f->s.hdr.colptr[j] - base);
+        SRB_INT len = f->s.hdr.colptr[j + 1] - f->s.hdr.colptr[j];
+        for (SRB_INT k = 1; k < len; ++k){
+            if (e[k].row < e[k - 1].row){
+                qsort(e, len, sizeof(struct rb_entry), SRB_entry_cmp);
+                break;
+            }
+        }
+    }
+    return NULL;
+}
+
+static void SRB_diff_record(rb_diff_t *diff, SRB_INT row, SRB_INT col, double a, double b,
+        char kind){
+    if (diff->nreport < SRB_DIFF_REPORT){
+        struct rb_diff_entry *r = diff->report + diff->nreport++;
+        r->row = row;
+        r->col = col;
+        r->a = a;
+        r->b = b;
+        r->kind = kind;
+    }
+}
+
+// merge column j of both files
+static void SRB_diff_column(rb_diff_t *diff, SRB_INT j, const struct rb_entry *ea, SRB_INT na,
+        const struct rb_entry *eb, SRB_INT nb, double atol, double rtol){
+    SRB_INT p = 0, q = 0;
+
+    while (p < na || q < nb){
+        double a = 0.0, b = 0.0, d;
+        SRB_INT row;
+        char kind = 0;
+
+        if (q == nb || (p < na && ea[p].row < eb[q].row)){
+            row = ea[p].row;
+            a = ea[p++].val;
+            kind = 'a';
+            ++diff->only_a;
+        } else if (p == na || eb[q].row < ea[p].row){
+            row = eb[q].row;
+            b = eb[q++].val;
+            kind = 'b';
+            ++diff->only_b;
+        } else {
+            row = ea[p].row;
+            a = ea[p++].val;
+            b = eb[q++].val;
+            ++diff->common;
+        }
+
+        d = fabs(a - b);
+        diff->norm_a += a * a;
+        diff->norm_b += b * b;
+        diff->norm_diff += d * d;
+        if (d > diff->max_abs)
+            diff->max_abs = d;
+        if (d > 0){
+            double rel = d / fmax(fabs(a), fabs(b));
+            if (rel > diff->max_rel)
+                diff->max_rel = rel;
+        }
+
+        if (kind == 0 && d > atol + rtol * fmax(fabs(a), fabs(b))){
+            kind = 'v';
+            ++diff->mismatched;
+        }
+        if (kind != 0)
+            SRB_diff_record(diff, row, j + 1, a, b, kind);
+    }
+}
+
+int SRB_diff(const char *file_a, rb_file_compress_t flag_a, const char *file_b,
+        rb_file_compress_t flag_b, double atol, double rtol, rb_diff_t *diff){
+    struct rb_diff_file fa, fb;
+    pthread_t thread;
+    int ret;
+
+    memset(diff, 0, sizeof(rb_diff_t));
+
+    ret = SRB_diff_open(&fa, file_a, flag_a);
+    if (ret == 0)
+        ret = SRB_diff_open(&fb, file_b, flag_b);
+    else
+        memset(&fb, 0, sizeof(struct rb_diff_file));
+    if (ret != 0){
+        SRB_diff_close(&fa);
+        SRB_diff_close(&fb);
+        return ret;
+    }
+
+    diff->header = fa.s.hdr.rows == fb.s.hdr.rows && fa.s.hdr.cols == fb.s.hdr.cols &&
+        fa.s.hdr.stype == fb.s.hdr.stype;
+    diff->values = fa.s.hdr.mtype != 'p' && fb.s.hdr.mtype != 'p';
+    if (!diff->values){
+        // compare the patterns only
+        if (fa.s.val.fp != NULL) fa.s.rb_close(fa.s.val.fp);
+        if (fb.s.val.fp != NULL) fb.s.rb_close(fb.s.val.fp);
+        fa.s.val.fp = fb.s.val.fp = NULL;
+    }
+
+    // batches of whole columns, the second file is parsed by a helper
+    // thread while this one parses the first
+    for (SRB_INT j0 = 0; diff->header && j0 < fa.s.hdr.cols; j0 = fa.j1){
+        SRB_INT j1 = j0 + 1;
+        while (j1 < fa.s.hdr.cols &&
+                fa.s.hdr.colptr[j1 + 1] - fa.s.hdr.colptr[j0] <= SRBIO_DIFF_BATCH &&
+                fb.s.hdr.colptr[j1 + 1] - fb.s.hdr.colptr[j0] <= SRBIO_DIFF_BATCH)
+            ++j1;
+        fa.j0 = fb.j0 = j0;
+        fa.j1 = fb.j1 = j1;
+
+        int threaded = pthread_create(&thread, NULL, SRB_diff_fill, &fb) == 0;
+        SRB_diff_fill(&fa);
+        if (threaded)
+            pthread_join(thread, NULL);
+        else
+            SRB_diff_fill(&fb);
+        if (fa.err != 0 || fb.err != 0){
+            fprintf(stderr, "SRB_diff: %s is corrupted.\n", fa.err != 0 ? file_a : file_b);
+            ret = fa.err != 0 ? fa.err : fb.err;
+            break;
+        }
+
+        for (SRB_INT j = j0; j < j1; ++j){
+            SRB_diff_column(diff, j,
+                    fa.e + (fa.s.hdr.colptr[j] - fa.s.hdr.colptr[j0]),
+                    fa.s.hdr.colptr[j + 1] - fa.s.hdr.colptr[j],
+                    fb.e + (fb.s.hdr.colptr[j] - fb.s.hdr.colptr[j0]),
+                    fb.s.hdr.colptr[j + 1] - fb.s.hdr.colptr[j], atol, rtol);
+        }
+    }
+
+    diff->norm_a = sqrt(diff->norm_a);
+    diff->norm_b = sqrt(diff->norm_b);
+    diff->norm_diff = sqrt(diff->norm_diff);
+    diff->equal = diff->header && diff->only_a == 0 && diff->only_b == 0 &&
+        diff->mismatched == 0;
+
+    SRB_diff_close(&fa);
+    SRB_diff_close(&fb);
+    return ret;
+}
@@ -0,0 +1,95 @@
+/*
+ * ===========================================================================
+ *
+ *       Filename:  SRB_lines.c
+ *
+ *    Description:  line streams of the backends for external card kernels
+ *
+ *        Version:  1.0
+ *        Created:  10/20/2026 09:48:05 AM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Haoyang Liu (), liuhaoyang@pku.edu.cn
+ *   Organization:  BICMR, Peking University
+ *      Copyright:  Copyright (c) 2021, Haoyang Liu
+ *
+ * ===========================================================================
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SRBio.h"
+#include "private/read.h"
+#include "private/sink.h"
+#include "private/write.h"
+
+struct rb_lines {
+    char mode;          // 'r' or 'w'
+    void *fp;
+    SRB_close_f close;
+    SRB_gets_f gets;
+    rb_sink_t sink;
+};
+
+// mode "r" reads through the backend of SRB_read, "w" writes through the
+// encoder of SRB_write_ex; -100 in info if the file cannot be opened, -999
+// if the compress flag is not built in
+rb_lines_t *SRB_lines_open(const char *filename, const char *mode, rb_file_compress_t flag,
+        const rb_write_opts_t *opts, int *info){
+    int ret = 0;
+    SRB_open_f rb_open;
+    rb_lines_t *l;
+
+    if (info == NULL) info = &ret;
+    l = (rb_lines_t*)calloc(1, sizeof(rb_lines_t));
+    if (l == NULL){
+        *info = -1;
+        return NULL;
+    }
+    l->mode = mode[0];
+
+    if (l->mode == 'r'){
+        if (SRB_read_backend(flag, &rb_open, &l->close, &l->gets) != 0){
+            free(l);
+            *info = -999;
+            return NULL;
+        }
+        l->fp = rb_open(filename, (flag & SRB_IO_DIRECT) ? "rd" : "r");
+        *info = l->fp != NULL ? 0 : -100;
+    } else {
+        *info = SRB_write_precision(0, flag) < 0 ? -999 :
+            SRB_sink_open(&l->sink, filename, (flag & SRB_IO_DIRECT) ? "wd" : "w", flag, opts);
+    }
+    if (*info != 0){
+        fprintf(stderr, "Failed to open file: %s.\n", filename);
+        free(l);
+        return NULL;
+    }
+    return l;
+}
+
+// the next line with its newline, NULL at the end of the file
+char *SRB_lines_gets(rb_lines_t *l, char *buff, int size){
+    return l->gets(buff, size, l->fp);
+}
+
+int SRB_lines_write(rb_lines_t *l, const char *text, size_t len){
+    return SRB_sink_write(&l->sink, text, len);
+}
+
+// -101 if a write failed at any point
+int SRB_lines_close(rb_lines_t *l){
+    int ret = 0;
+
+    if (l == NULL)
+        return 0;
+    if (l->mode == 'r')
+        l->close(l->fp);
+    else if (SRB_sink_close(&l->sink) != 0)
+        ret = -101;
+    free(l);
+    return ret;
+}
@@ -0,0 +1,214 @@
+/*
+ * ===========================================================================
+ *
+ *       Filename:  SRB_mixed.c
+ *
+ *    Description:  CSC with 64-bit colptr and 32-bit row indices
+ *
+ *        Version:  1.0
+ *        Created:  10/20/2026 09:12:40 AM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Haoyang Liu (), liuhaoyang@pku.edu.cn
+ *   Organization:  BICMR, Peking University
+ *      Copyright:  Copyright (c) 2021, Haoyang Liu
+ *
+ * ===========================================================================
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SRBio.h"
+#include "private/read.h"
+#include "private/kernels.h"
+
+void SRB_mixed_init(rb_matrix_mixed_t *mat){
+    memset(mat, 0, sizeof(rb_matrix_mixed_t));
+}
+
+void SRB_mixed_destroy(rb_matrix_mixed_t *mat){
+    free(mat->colptr);
+    free(mat->rowind);
+    free(mat->rowind64);
+    free(mat->valptr_d);
+    free(mat->valptr_i);
+    mat->colptr = NULL;
+    mat->rowind = NULL;
+    mat->rowind64 = NULL;
+    mat->valptr_d = NULL;
+    mat->valptr_i = NULL;
+}
+
+// n integers of an integer block of nl cards into out64 or out32; with
+// hi > 0 each must lie in 1..hi. Returns the count parsed, -1 if a card is
+// missing, -2 on a number out of range
+static int64_t SRB_mixed_ints(void *fp, SRB_gets_f rb_gets, int64_t nl, int64_t n,
+        int64_t *out64, int32_t *out32, int64_t hi){
+    char buffer[SRBIO_LINE_MAX + 2], *chret;
+    int64_t card[SRBIO_CARD_NUMS];
+    int64_t k = 0;
+
+    for (int64_t i = 0; i < nl; ++i){
+        chret = rb_gets(buffer, SRBIO_LINE_MAX + 2, fp);
+        if (chret == NULL)
+            return -1;
+        const char *s = chret, *end = chret + strlen(chret);
+        int m;
+        do {
+            m = SRB_card_ints(&s, end, card, SRB_card_want(n - k));
+            for (int j = 0; j < m; ++j, ++k){
+                if (hi > 0 && (card[j] < 1 || card[j] > hi))
+                    return -2;
+                if (out32 != NULL)
+                    out32[k] = (int32_t)card[j];
+                else
+                    out64[k] = card[j];
+            }
+        } while (m == SRBIO_CARD_NUMS);
+    }
+    return k;
+}
+
+static int SRB_mixed_csc(void *fp, rb_matrix_mixed_t *mat, SRB_gets_f rb_gets,
+        const int64_t *crd, int flags){
+    size_t nnz = mat->nnz > 0 ? (size_t)mat->nnz : 1;
+    int64_t n;
+
+    // colptr block
+    mat->colptr = (int64_t*)malloc((mat->cols + 1) * sizeof(int64_t));
+    if (mat->colptr == NULL)
+        return -1;
+    n = SRB_mixed_ints(fp, rb_gets, crd[0], mat->cols + 1, mat->colptr, NULL, 0);
+    if (n < mat->cols + 1){
+        fprintf(stderr, "SRB_read_mixed: colptr block is short (%ld)\n", (long)n);
+        return -1;
+    }
+
+    // rowind block, 32-bit as long as the rows fit
+    if (mat->rows <= INT32_MAX)
+        mat->rowind = (int32_t*)malloc(nnz * sizeof(int32_t));
+    else
+        mat->rowind64 = (int64_t*)malloc(nnz * sizeof(int64_t));
+    if (mat->rowind == NULL && mat->rowind64 == NULL)
+        return -2;
+    n = SRB_mixed_ints(fp, rb_gets, crd[1], mat->nnz, mat->rowind64, mat->rowind, mat->rows);
+    if (n == -2){
+        fprintf(stderr, "SRB_read_mixed: row index is out of range\n");
+        return -2;
+    }
+    if (n < mat->nnz){
+        fprintf(stderr, "SRB_read_mixed: rowind block is short (%ld)\n", (long)n);
+        return -2;
+    }
+
+    // the value cards are the last block, SRB_READ_PATTERN leaves them
+    if (flags & SRB_READ_PATTERN){
+        mat->mtype = 'p';
+        return 0;
+    }
+
+    // value block
+    switch (mat->mtype){
+        case 'r': // real
+            mat->valptr_d = (SRB_Scalar*)malloc(nnz * sizeof(SRB_Scalar));
+            if (mat->valptr_d == NULL)
+                return -3;
+            n = 0;
+            for (int64_t i = 0; i < crd[2]; ++i){
+                char buffer[SRBIO_LINE_MAX + 2], *chret;
+                chret = rb_gets(buffer, SRBIO_LINE_MAX + 2, fp);
+                if (chret == NULL)
+                    break;
+                for (char *end; n < mat->nnz; ++n, chret = end){
+                    double v = strtod(chret, &end);
+                    if (end == chret) break;
+                    mat->valptr_d[n] = v;
+                }
+            }
+            break;
+        case 'i': // integer
+            mat->valptr_i = (int64_t*)malloc(nnz * sizeof(int64_t));
+            if (mat->valptr_i == NULL)
+                return -3;
+            n = SRB_mixed_ints(fp, rb_gets, crd[2], mat->nnz, mat->valptr_i, NULL, 0);
+            break;
+        case 'p': // pattern
+            return 0;
+        case 'c': // complex
+            fprintf(stderr, "SRB_read_mixed: complex is not supported.\n");
+            return -999;
+        case 'q': // pattern & aux file
+            fprintf(stderr, "SRB_read_mixed: pattern + aux file is not supported.\n");
+            return -999;
+        default:  // error
+            fprintf(stderr, "SRB_read_mixed: illegal type (%c)\n", mat->mtype);
+            return -41;
+    }
+    if (n < mat->nnz){
+        fprintf(stderr, "SRB_read_mixed: value block is short (%ld)\n", (long)n);
+        return -3;
+    }
+    return 0;
+}
+
+// the blocks go straight into the fixed-width arrays, there is no
+// SRB_INT-sized copy in between
+int SRB_read_mixed(const char *filename, rb_matrix_mixed_t *mat, rb_file_compress_t flag,
+        const rb_read_opts_t *opts){
+    SRB_gets_f rb_gets;
+    SRB_close_f rb_close;
+    SRB_open_f rb_open;
+    int flags = opts != NULL ? opts->flags : 0;
+    int64_t crd[3];
+    void *fp;
+    int ret;
+
+    if (opts != NULL && ((flags & ~(SRB_READ_PATTERN | SRB_READ_ZERO_BASED)) ||
+                opts->row_perm != NULL || opts->col_perm != NULL ||
+                opts->row_scale != NULL || opts->col_scale != NULL || opts->drop_tol > 0 ||
+                opts->nthreads > 0 || opts->stats != NULL || opts->fingerprint != NULL)){
+        fprintf(stderr, "SRB_read_mixed: only SRB_READ_PATTERN and SRB_READ_ZERO_BASED "
+                "are supported.\n");
+        return -999;
+    }
+    if (SRB_read_backend(flag, &rb_open, &rb_close, &rb_gets) != 0)
+        return -999;
+
+    mat->colptr = NULL;
+    mat->rowind = NULL;
+    mat->rowind64 = NULL;
+    mat->valptr_d = NULL;
+    mat->valptr_i = NULL;
+
+    fp = rb_open(filename, (flag & SRB_IO_DIRECT) ? "rd" : "r");
+    if (fp == NULL){
+        fprintf(stderr, "Failed to open file: %s.\n", filename);
+        return -100;
+    }
+
+    ret = SRB_read_header_mixed(fp, mat, rb_gets, crd);
+    if (ret == 0 && (mat->rows < 0 || mat->cols < 0 || mat->nnz < 0)){
+        fprintf(stderr, "SRB_read_mixed: line 3 is illegal.\n");
+        ret = -3;
+    }
+    if (ret == 0)
+        ret = SRB_mixed_csc(fp, mat, rb_gets, crd, flags);
+    rb_close(fp);
+    if (ret != 0){
+        SRB_mixed_destroy(mat);
+        return ret;
+    }
+
+    if (flags & SRB_READ_ZERO_BASED){
+        for (int64_t j = 0; j <= mat->cols; ++j)
+            --mat->colptr[j];
+        for (int64_t k = 0; k < mat->nnz; ++k){
+            if (mat->rowind != NULL) --mat->rowind[k];
+            else --mat->rowind64[k];
+        }
+    }
+    return 0;
+}
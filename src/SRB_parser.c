@@ -0,0 +1,385 @@
+/*
+ * ===========================================================================
+ *
+ *       Filename:  SRB_parser.c
+ *
+ *    Description:  push parser, the text is fed in chunks of any size
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 11:58:06 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Haoyang Liu (), liuhaoyang@pku.edu.cn
+ *   Organization:  BICMR, Peking University
+ *      Copyright:  Copyright (c) 2021, Haoyang Liu
+ *
+ * ===========================================================================
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SRBio.h"
+#include "private/source.h"
+#include "private/read.h"
+#include "private/stats.h"
+#include "private/fingerprint.h"
+#include "private/kernels.h"
+
+// a card longer than this is taken as garbage rather than buffered
+#define SRBIO_PARSER_LINE_MAX (1 << 16)
+
+enum rb_parser_state {
+    SRB_PARSER_HEADER,
+    SRB_PARSER_PTR,
+    SRB_PARSER_IND,
+    SRB_PARSER_VAL,
+    SRB_PARSER_DONE,        // all blocks parsed, the rest of the input is ignored
+    SRB_PARSER_FINISHED,    // handed over by SRB_parser_finish
+    SRB_PARSER_ERROR
+};
+
+// the input is cut into cards; complete cards are parsed in place in the
+// caller's chunk, only a card split by a chunk boundary is copied to `carry`
+struct rb_parser {
+    rb_matrix_info_t *mat;
+    int flags;
+    rb_stats_t *stats_out;
+    rb_stats_state_t stats;
+    uint64_t *fingerprint_out;
+    rb_fingerprint_t fingerprint;
+
+    enum rb_parser_state state;
+    int ret;                // error code, kept once the parse failed
+    long lineno;
+
+    char header[4 * (SRBIO_LINE_MAX + 2)];
+    size_t hlen;
+    int hlines;
+
+    SRB_INT nl[3];          // cards of the colptr, rowind and value blocks
+    SRB_INT left;           // cards left in the current block
+    SRB_INT n;              // numbers parsed in the current block
+
+    char *carry;
+    size_t clen;
+    size_t ccap;
+};
+
+rb_parser_t *SRB_parser_create(rb_matrix_info_t *mat, const rb_read_opts_t *opts){
+    rb_parser_t *p;
+
+    if (opts != NULL && (opts->row_perm != NULL || opts->col_perm != NULL ||
+                opts->row_scale != NULL || opts->col_scale != NULL || opts->drop_tol > 0 ||
+                opts->nthreads > 0)){
+        fprintf(stderr, "SRB_parser: only SRB_READ_PATTERN, SRB_READ_ZERO_BASED, "
+                "SRB_READ_NO_STORE, stats and fingerprints are supported.\n");
+        return NULL;
+    }
+
+    p = (rb_parser_t*)calloc(1, sizeof(rb_parser_t));
+    if (p == NULL)
+        return NULL;
+    p->mat = mat;
+    p->flags = opts != NULL ? opts->flags : 0;
+    p->stats_out = opts != NULL ? opts->stats : NULL;
+    p->fingerprint_out = opts != NULL ? opts->fingerprint : NULL;
+    SRB_fp_init(&p->fingerprint);
+    p->state = SRB_PARSER_HEADER;
+
+    mat->colptr = NULL;
+    mat->rowind = NULL;
+    mat->valptr_d = NULL;
+    mat->valptr_i = NULL;
+    return p;
+}
+
+static int SRB_parser_fail(rb_parser_t *p, int ret){
+    SRB_destroy(p->mat);
+    p->state = SRB_PARSER_ERROR;
+    p->ret = ret;
+    return ret;
+}
+
+// block error code of the state, as in SRB_read
+static int SRB_parser_code(const rb_parser_t *p){
+    switch (p->state){
+        case SRB_PARSER_HEADER: return -(p->hlines + 1);
+        case SRB_PARSER_PTR: return -1;
+        case SRB_PARSER_IND: return -2;
+        default: return -3;
+    }
+}
+
+// lines 1-4 go through SRB_read_header, so both parsers agree on them
+static int SRB_parser_header(rb_parser_t *p){
+    rb_matrix_info_t *mat = p->mat;
+    rb_source_t src;
+    int store = !(p->flags & SRB_READ_NO_STORE);
+    int ret;
+
+    SRB_source_init_mem(&src, p->header, p->hlen);
+    ret = SRB_read_header(&src, mat, SRB_source_gets, &p->nl[0], &p->nl[1], &p->nl[2]);
+    if (ret != 0)
+        return SRB_parser_fail(p, ret);
+
+    switch (mat->mtype){
+        case 'r': case 'i': case 'p':
+            break;
+        case 'c': case 'q':
+            fprintf(stderr, "SRB_parser: matrix type %c is not supported.\n", mat->mtype);
+            return SRB_parser_fail(p, -999);
+        default:
+            fprintf(stderr, "SRB_parser: illegal type (%c)\n", mat->mtype);
+            return SRB_parser_fail(p, -41);
+    }
+
+    mat->colptr = (SRB_INT*)malloc((1 + mat->cols) * sizeof(SRB_INT));
+    if (store)
+        mat->rowind = (SRB_INT*)malloc((mat->nnz > 0 ? mat->nnz : 1) * sizeof(SRB_INT));
+    if (mat->colptr == NULL || (store && mat->rowind == NULL))
+        return SRB_parser_fail(p, -1);
+
+    p->state = SRB_PARSER_PTR;
+    p->left = p->nl[0];
+    p->n = 0;
+    return 0;
+}
+
+// a finished block moves the parser on, blocks without cards are passed
+// over at once; 1 once the matrix is complete
+static int SRB_parser_advance(rb_parser_t *p){
+    rb_matrix_info_t *mat = p->mat;
+    int store = !(p->flags & SRB_READ_NO_STORE);
+
+    while (p->left == 0){
+        switch (p->state){
+            case SRB_PARSER_PTR:
+                if (p->n < mat->cols + 1){
+                    fprintf(stderr, "SRB_parser: colptr block is short (%d)\n", (int)p->n);
+                    return SRB_parser_fail(p, -1);
+                }
+                if (p->stats_out != NULL)
+                    SRB_stats_begin(&p->stats, p->stats_out, mat);
+                if (p->fingerprint_out != NULL){
+                    for (SRB_INT j = 0; j <= mat->cols; ++j)
+                        SRB_fp_int(&p->fingerprint, mat->colptr[j]);
+                }
+                p->state = SRB_PARSER_IND;
+                p->left = p->nl[1];
+                break;
+            case SRB_PARSER_IND:
+                if (p->n < mat->nnz){
+                    fprintf(stderr, "SRB_parser: rowind block is short (%d)\n", (int)p->n);
+                    return SRB_parser_fail(p, -2);
+                }
+                if (p->stats_out != NULL)
+                    SRB_stats_finish(&p->stats);
+                if ((p->flags & SRB_READ_PATTERN) || mat->mtype == 'p'){
+                    mat->mtype = 'p';
+                    if (p->fingerprint_out != NULL)
+                        SRB_fp_finish(&p->fingerprint, mat, p->fingerprint_out);
+                    p->state = SRB_PARSER_DONE;
+                    return 1;
+                }
+                if (store && mat->mtype == 'r')
+                    mat->valptr_d = (SRB_Scalar*)malloc((mat->nnz > 0 ? mat->nnz : 1) * sizeof(SRB_Scalar));
+                else if (store)
+                    mat->valptr_i = (SRB_INT*)malloc((mat->nnz > 0 ? mat->nnz : 1) * sizeof(SRB_INT));
+                if (store && mat->valptr_d == NULL && mat->valptr_i == NULL)
+                    return SRB_parser_fail(p, -3);
+                p->state = SRB_PARSER_VAL;
+                p->left = p->nl[2];
+                break;
+            case SRB_PARSER_VAL:
+                if (p->n < mat->nnz){
+                    fprintf(stderr, "SRB_parser: value block is short (%d)\n", (int)p->n);
+                    return SRB_parser_fail(p, -3);
+                }
+                if (p->stats_out != NULL)
+                    p->stats_out->values = 1;
+                if (p->fingerprint_out != NULL)
+                    SRB_fp_finish(&p->fingerprint, mat, p->fingerprint_out);
+                p->state = SRB_PARSER_DONE;
+                return 1;
+            default:
+                return 0;
+        }
+        p->n = 0;
+    }
+    return 0;
+}
+
+// the card ends at `end`; strtol/strtod only start on a digit or sign, so
+// they never run past it into the next card
+static inline const char *SRB_parser_skip(const char *s, const char *end){
+    while (s < end && (*s == ' ' || *s == '\t' || *s == '\r'))
+        ++s;
+    return s;
+}
+
+static int SRB_parser_card(rb_parser_t *p, const char *s, const char *end){
+    rb_matrix_info_t *mat = p->mat;
+    int store = !(p->flags & SRB_READ_NO_STORE);
+    int64_t card[SRBIO_CARD_NUMS];
+    int m;
+    char *e;
+
+    ++p->lineno;
+    switch (p->state){
+        case SRB_PARSER_HEADER: {
+            size_t len = (size_t)(end - s);
+            if (len > SRBIO_LINE_MAX) len = SRBIO_LINE_MAX;
+            memcpy(p->header + p->hlen, s, len);
+            p->hlen += len;
+            p->header[p->hlen++] = '\n';
+            if (++p->hlines < 4)
+                return 0;
+            if (SRB_parser_header(p) != 0)
+                return p->ret;
+            break;
+        }
+        case SRB_PARSER_PTR:
+            do {
+                m = SRB_card_ints(&s, end, card, SRB_card_want(mat->cols + 1 - p->n));
+                for (int j = 0; j < m; ++j)
+                    mat->colptr[p->n++] = (SRB_INT)card[j];
+            } while (m == SRBIO_CARD_NUMS);
+            --p->left;
+            break;
+        case SRB_PARSER_IND:
+            do {
+                m = SRB_card_ints(&s, end, card, SRB_card_want(mat->nnz - p->n));
+                for (int j = 0; j < m; ++j, ++p->n){
+                    SRB_INT row = (SRB_INT)card[j];
+                    if (p->stats_out != NULL) SRB_stats_row(&p->stats, p->n, row);
+                    if (p->fingerprint_out != NULL) SRB_fp_int(&p->fingerprint, row);
+                    if (store) mat->rowind[p->n] = row;
+                }
+            } while (m == SRBIO_CARD_NUMS);
+            --p->left;
+            break;
+        case SRB_PARSER_VAL:
+            for (; p->n < mat->nnz; ++p->n, s = e){
+                s = SRB_parser_skip(s, end);
+                if (s == end) break;
+                if (mat->mtype == 'r'){
+                    double v = strtod(s, &e);
+                    if (e == s) break;
+                    if (p->stats_out != NULL) SRB_stats_value(&p->stats, v);
+                    if (p->fingerprint_out != NULL) SRB_fp_real(&p->fingerprint, v);
+                    if (store) mat->valptr_d[p->n] = v;
+                } else {
+                    SRB_INT v = strtol(s, &e, 10);
+                    if (e == s) break;
+                    if (p->stats_out != NULL) SRB_stats_value(&p->stats, (double)v);
+                    if (p->fingerprint_out != NULL) SRB_fp_int(&p->fingerprint, v);
+                    if (store) mat->valptr_i[p->n] = v;
+                }
+            }
+            --p->left;
+            break;
+        default:
+            return 0;
+    }
+    return SRB_parser_advance(p);
+}
+
+// keeps the start of a card split by the end of a chunk
+static int SRB_parser_keep(rb_parser_t *p, const char *s, size_t len){
+    if (p->clen + len + 1 > p->ccap){
+        size_t cap = p->ccap > 0 ? p->ccap : 2 * (SRBIO_LINE_MAX + 2);
+        while (cap < p->clen + len + 1) cap *= 2;
+        if (cap > SRBIO_PARSER_LINE_MAX){
+            fprintf(stderr, "SRB_parser: line %ld is too long\n", p->lineno + 1);
+            return SRB_parser_fail(p, SRB_parser_code(p));
+        }
+        char *carry = (char*)realloc(p->carry, cap);
+        if (carry == NULL)
+            return SRB_parser_fail(p, SRB_parser_code(p));
+        p->carry = carry;
+        p->ccap = cap;
+    }
+    memcpy(p->carry + p->clen, s, len);
+    p->clen += len;
+    p->carry[p->clen] = '\0';
+    return 0;
+}
+
+int SRB_parser_feed(rb_parser_t *p, const void *data, size_t len){
+    const char *s = (const char*)data, *end = s + len, *nl;
+    int ret;
+
+    if (p->state == SRB_PARSER_ERROR)
+        return p->ret;
+    if (p->state >= SRB_PARSER_DONE)
+        return 1;
+
+    // finish the card left over from the previous chunk
+    if (p->clen > 0){
+        nl = (const char*)memchr(s, '\n', len);
+        if (nl == NULL)
+            return SRB_parser_keep(p, s, len);
+        ret = SRB_parser_keep(p, s, (size_t)(nl - s));
+        if (ret != 0)
+            return ret;
+        p->clen = 0;
+        ret = SRB_parser_card(p, p->carry, p->carry + strlen(p->carry));
+        if (ret != 0)
+            return ret;
+        s = nl + 1;
+    }
+
+    while (s < end){
+        nl = (const char*)memchr(s, '\n', (size_t)(end - s));
+        if (nl == NULL)
+            return SRB_parser_keep(p, s, (size_t)(end - s));
+        ret = SRB_parser_card(p, s, nl);
+        if (ret != 0)
+            return ret;
+        s = nl + 1;
+    }
+    return 0;
+}
+
+int SRB_parser_finish(rb_parser_t *p){
+    int ret;
+
+    // the last card need not end with a newline
+    if (p->clen > 0 && p->state < SRB_PARSER_DONE){
+        p->clen = 0;
+        ret = SRB_parser_card(p, p->carry, p->carry + strlen(p->carry));
+        if (ret < 0)
+            return ret;
+    }
+
+    switch (p->state){
+        case SRB_PARSER_ERROR:
+            return p->ret;
+        case SRB_PARSER_FINISHED:
+            return 0;
+        case SRB_PARSER_DONE: {
+            rb_read_opts_t opts;
+            SRB_read_opts_init(&opts);
+            opts.flags = p->flags;
+            SRB_read_rebase(p->mat, &opts);
+            p->state = SRB_PARSER_FINISHED;
+            return 0;
+        }
+        default:
+            fprintf(stderr, "SRB_parser: input ended at line %ld\n", p->lineno);
+            return SRB_parser_fail(p, SRB_parser_code(p));
+    }
+}
+
+// an unfinished matrix is freed with the parser, a finished one is the caller's
+void SRB_parser_destroy(rb_parser_t *p){
+    if (p == NULL)
+        return;
+    if (p->state != SRB_PARSER_FINISHED && p->state != SRB_PARSER_ERROR)
+        SRB_destroy(p->mat);
+    free(p->carry);
+    free(p);
+}
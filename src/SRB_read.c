@@ -20,51 +20,122 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
 
 #include "SRBio.h"
 #include "private/wrap.h"
+#include "private/gzip.h"
+#include "private/context.h"
+#include "private/source.h"
+#include "private/read.h"
+#include "private/numa.h"
+#include "private/stats.h"
+#include "private/fingerprint.h"
+#include "private/kernels.h"
 
-int SRB_read_csc_impl(void*, rb_matrix_info_t*, SRB_gets_f, SRB_INT, SRB_INT, SRB_INT);
-int SRB_read_impl(const char *, rb_matrix_info_t*, SRB_open_f, SRB_close_f, SRB_gets_f);
+int SRB_read_csc_impl(void*, rb_matrix_info_t*, SRB_gets_f, SRB_INT, SRB_INT, SRB_INT,
+        const rb_read_opts_t*, const rb_value_sink_t*);
+int SRB_read_impl(const char *, const char *, rb_matrix_info_t*, SRB_open_f, SRB_close_f,
+        SRB_gets_f, const rb_read_opts_t*, const rb_value_sink_t*);
+
+void SRB_read_opts_init(rb_read_opts_t *opts){
+    memset(opts, 0, sizeof(rb_read_opts_t));
+}
 
 int SRB_read(const char *filename, rb_matrix_info_t *mat, rb_file_compress_t flag){
-    SRB_gets_f rb_gets;
-    SRB_close_f rb_close;
-    SRB_open_f rb_open;
-    switch (flag) {
+    return SRB_read_ex(filename, mat, flag, NULL);
+}
+
+int SRB_read_ex(const char *filename, rb_matrix_info_t *mat, rb_file_compress_t flag,
+        const rb_read_opts_t *opts){
+    return SRB_read_into(filename, mat, flag, opts, NULL);
+}
+
+// plain and gzip files are read through the buffers and inflate state of
+// the context, an indexed gzip file is inflated by its workers; opts NULL:
+// its defaults
+int SRB_read_ctx(rb_context_t *ctx, const char *filename, rb_matrix_info_t *mat,
+        rb_file_compress_t flag, const rb_read_opts_t *opts){
+    if (opts == NULL)
+        opts = &ctx->read_opts;
+
+#ifdef SRBIO_USE_ZLIB
+    int codec = flag & SRB_COMPRESS_MASK;
+    if ((codec == SRB_COMPRESS_NONE && !(flag & SRB_IO_DIRECT)) ||
+            (codec == SRB_COMPRESS_GZIP && !(flag & SRB_GZIP_NO_INDEX))){
+        void *fp = SRB_igzopen_ctx(filename, ctx, codec == SRB_COMPRESS_NONE);
+        int ret;
+        if (fp == NULL){
+            fprintf(stderr, "Failed to open file: %s.\n", filename);
+            return -100;
+        }
+        ret = SRB_read_stream(fp, mat, SRB_igzgets, opts, NULL);
+        SRB_igzclose(fp);
+        return ret;
+    }
+#endif
+    return SRB_read_ex(filename, mat, flag, opts);
+}
+
+// line reader of the compress flag, -999 if it is not built in
+int SRB_read_backend(rb_file_compress_t flag, SRB_open_f *rb_open, SRB_close_f *rb_close,
+        SRB_gets_f *rb_gets){
+    switch (flag & SRB_COMPRESS_MASK) {
         case SRB_COMPRESS_NONE:
-            rb_open = SRB_fopen;
-            rb_close = SRB_fclose;
-            rb_gets = SRB_fgets;
+#ifdef SRBIO_USE_IO_URING
+            *rb_open = SRB_uringopen;
+            *rb_close = SRB_uringclose;
+            *rb_gets = SRB_uringgets;
+#else
+            *rb_open = SRB_fopen;
+            *rb_close = SRB_fclose;
+            *rb_gets = SRB_fgets;
+#endif
             break;
 #ifdef SRBIO_USE_ZLIB
         case SRB_COMPRESS_GZIP:
-            rb_open = SRB_gzopen;
-            rb_close = SRB_gzclose;
-            rb_gets = SRB_gzgets;
+            if (flag & SRB_GZIP_NO_INDEX){
+                *rb_open = SRB_gzopen;
+                *rb_close = SRB_gzclose;
+                *rb_gets = SRB_gzgets;
+            } else {
+                *rb_open = SRB_igzopen;
+                *rb_close = SRB_igzclose;
+                *rb_gets = SRB_igzgets;
+            }
             break;
 #endif
 #ifdef SRBIO_USE_BZIP2
         case SRB_COMPRESS_BZIP2:
-            rb_open = SRB_bz2open;
-            rb_close = SRB_bz2close;
-            rb_gets = SRB_bz2gets;
+            *rb_open = SRB_bz2open;
+            *rb_close = SRB_bz2close;
+            *rb_gets = SRB_bz2gets;
             break;
 #endif
         default:
             return -999;
     }
-    return SRB_read_impl(filename, mat, rb_open, rb_close, rb_gets);
+    return 0;
 }
 
-int SRB_read_impl(const char *filename, rb_matrix_info_t* mat,
-        SRB_open_f rb_open, SRB_close_f rb_close, SRB_gets_f rb_gets){
+int SRB_read_into(const char *filename, rb_matrix_info_t *mat, rb_file_compress_t flag,
+        const rb_read_opts_t *opts, const rb_value_sink_t *sink){
+    SRB_gets_f rb_gets;
+    SRB_close_f rb_close;
+    SRB_open_f rb_open;
+    if (SRB_read_backend(flag, &rb_open, &rb_close, &rb_gets) != 0)
+        return -999;
+    return SRB_read_impl(filename, (flag & SRB_IO_DIRECT) ? "rd" : "r",
+            mat, rb_open, rb_close, rb_gets, opts, sink);
+}
+
+int SRB_read_impl(const char *filename, const char *mode, rb_matrix_info_t* mat,
+        SRB_open_f rb_open, SRB_close_f rb_close, SRB_gets_f rb_gets,
+        const rb_read_opts_t *opts, const rb_value_sink_t *sink){
     void *fp;
-    char buffer[SRBIO_LINE_MAX + 2];
     int ret;
-    SRB_INT totcrd, ptrcrd, indcrd, valcrd;
 
-    fp = rb_open(filename, "r");
+    fp = rb_open(filename, mode);
     if (fp == NULL){
         fprintf(stderr, "Failed to open file: %s.\n", filename);
         return -100;
@@ -74,11 +145,104 @@ int SRB_read_impl(const char *filename, rb_matrix_info_t* mat,
     printf("Successfully opened file %s\n", filename);
 #endif
 
+    ret = SRB_read_stream(fp, mat, rb_gets, opts, sink);
+
+    rb_close(fp);
+    return ret;
+}
+
+int SRB_read_mem(const void *data, size_t len, rb_matrix_info_t *mat,
+        rb_file_compress_t flag){
+    rb_memfile_t mf;
+    rb_decoder_t dec;
+    rb_source_t src;
+    int ret;
+
+    // plain text is parsed in place
+    if ((flag & SRB_COMPRESS_MASK) == SRB_COMPRESS_NONE){
+        SRB_source_init_mem(&src, (const char*)data, len);
+        return SRB_read_stream(&src, mat, SRB_source_gets, NULL, NULL);
+    }
+
+    mf.data = (const char*)data;
+    mf.len = len;
+    mf.pos = 0;
+    ret = SRB_decoder_init(&dec, SRB_memread, &mf, flag);
+    if (ret != 0)
+        return ret;
+    if (SRB_source_init(&src, SRB_decoder_read, &dec, 0) != 0){
+        SRB_decoder_free(&dec);
+        return -1;
+    }
+
+    ret = SRB_read_stream(&src, mat, SRB_source_gets, NULL, NULL);
+
+    SRB_source_free(&src);
+    SRB_decoder_free(&dec);
+    return ret;
+}
+
+// parse an opened stream, lines are pulled with rb_gets
+int SRB_read_stream(void *fp, rb_matrix_info_t *mat, SRB_gets_f rb_gets,
+        const rb_read_opts_t *opts, const rb_value_sink_t *sink){
+    SRB_INT ptrcrd, indcrd, valcrd;
+    int ret;
+
+    ret = SRB_read_header(fp, mat, rb_gets, &ptrcrd, &indcrd, &valcrd);
+    if (ret != 0)
+        return ret;
+
+    // data block
+    return SRB_read_csc_impl(fp, mat, rb_gets, ptrcrd, indcrd, valcrd, opts, sink);
+}
+
+// lines 1-4, the stream is left at the colptr block
+int SRB_read_header(void *fp, rb_matrix_info_t *mat, SRB_gets_f rb_gets,
+        SRB_INT *ptrcrd_out, SRB_INT *indcrd_out, SRB_INT *valcrd_out){
+    rb_matrix_mixed_t hdr;
+    int64_t crd[3];
+    int ret;
+
+    ret = SRB_read_header_mixed(fp, &hdr, rb_gets, crd);
+    if (ret != 0)
+        return ret;
+
+#ifndef SRBIO_ILP64
+    // colptr holds nnz + 1
+    if (hdr.rows > INT_MAX || hdr.cols >= INT_MAX || hdr.nnz >= INT_MAX ||
+            crd[0] > INT_MAX || crd[1] > INT_MAX || crd[2] > INT_MAX){
+        fprintf(stderr, "SRB_read: %ld x %ld with %ld nonzeros overflows 32-bit "
+                "indices, use SRB_read_mixed.\n", (long)hdr.rows, (long)hdr.cols, (long)hdr.nnz);
+        return -999;
+    }
+#endif
+
+    memcpy(mat->descr, hdr.descr, sizeof(mat->descr));
+    memcpy(mat->key, hdr.key, sizeof(mat->key));
+    mat->mtype = hdr.mtype;
+    mat->stype = hdr.stype;
+    mat->ftype = hdr.ftype;
+    mat->rows = (SRB_INT)hdr.rows;
+    mat->cols = (SRB_INT)hdr.cols;
+    mat->nnz = (SRB_INT)hdr.nnz;
+    *ptrcrd_out = (SRB_INT)crd[0];
+    *indcrd_out = (SRB_INT)crd[1];
+    *valcrd_out = (SRB_INT)crd[2];
+    return 0;
+}
+
+// lines 1-4 at full width, crd gets the card counts of the colptr, rowind
+// and value blocks
+int SRB_read_header_mixed(void *fp, rb_matrix_mixed_t *mat, SRB_gets_f rb_gets,
+        int64_t *crd){
+    char buffer[SRBIO_LINE_MAX + 2];
+    int ret;
+    long totcrd, ptrcrd, indcrd, valcrd;
+
     // line 1: title and id
     if (!rb_gets(buffer, SRBIO_LINE_MAX + 2, fp)){
         fprintf(stderr, "SRB_read: failed to read line 1.");
-        ret = -1;
-        goto FINALIZE;
+        return -1;
     }
 
     ret = snprintf(mat->descr, 73, "%s", buffer);
@@ -96,33 +260,26 @@ int SRB_read_impl(const char *filename, rb_matrix_info_t* mat,
     // line 2: lines info
     if (!rb_gets(buffer, SRBIO_LINE_MAX + 2, fp)){
         fprintf(stderr, "SRB_read: failed to read line 2.\n");
-        ret = -2;
-        goto FINALIZE;
+        return -2;
     }
 
-#ifdef SRBIO_ILP64
     ret = sscanf(buffer, "%ld %ld %ld %ld", &totcrd, &ptrcrd, &indcrd, &valcrd);
-#else
-    ret = sscanf(buffer, "%d %d %d %d", &totcrd, &ptrcrd, &indcrd, &valcrd);
-#endif
     if (ret != 4){
         fprintf(stderr, "SRB_read: line 2 is illegal.\n");
-        ret = -2;
-        goto FINALIZE;
+        return -2;
     }
 
 #ifndef NDEBUG
-    printf("# lines (total): %d\n", (int)totcrd);
-    printf("# lines (ptr): %d\n", (int)ptrcrd);
-    printf("# lines (ind): %d\n", (int)indcrd);
-    printf("# lines (val): %d\n", (int)valcrd);
+    printf("# lines (total): %ld\n", totcrd);
+    printf("# lines (ptr): %ld\n", ptrcrd);
+    printf("# lines (ind): %ld\n", indcrd);
+    printf("# lines (val): %ld\n", valcrd);
 #endif
 
     // line 3: matrix info
     if (!rb_gets(buffer, SRBIO_LINE_MAX + 2, fp)){
         fprintf(stderr, "SRB_read: failed to read line 3.\n");
-        ret = -3;
-        goto FINALIZE;
+        return -3;
     }
 
     ret = sscanf(buffer, "%c%c%c", &mat->mtype, &mat->stype, &mat->ftype);
@@ -131,51 +288,232 @@ int SRB_read_impl(const char *filename, rb_matrix_info_t* mat,
     if (mat->ftype < 'a') mat->ftype += 'a' - 'A';
 
     if (mat->ftype == 'a'){
-#ifdef SRBIO_ILP64
-        ret = sscanf(buffer + 3, "%ld %ld %ld", &mat->rows, &mat->cols, &mat->nnz);
-#else
-        ret = sscanf(buffer + 3, "%d %d %d", &mat->rows, &mat->cols, &mat->nnz);
-#endif
+        long rows, cols, nnz;
+        ret = sscanf(buffer + 3, "%ld %ld %ld", &rows, &cols, &nnz);
         if (ret != 3){
             fprintf(stderr, "SRB_read: line 3 is illegal.\n");
-            ret = -3;
-            goto FINALIZE;
+            return -3;
         }
+        mat->rows = rows;
+        mat->cols = cols;
+        mat->nnz = nnz;
     } else if (mat->ftype == 'e'){
         fprintf(stderr, "SRB_read: elemental format is not supported yet.\n");
-        ret = -999;
-        goto FINALIZE;
+        return -999;
     } else {
         fprintf(stderr, "SRB_read: unknown format: %c\n", mat->ftype);
-        ret = -31;
-        goto FINALIZE;
+        return -31;
     }
     
     // line 4: fortran format info
     // for C program, just discard it
     if (!rb_gets(buffer, SRBIO_LINE_MAX + 2, fp)){
         fprintf(stderr, "SRB_read: failed to read line 4.\n");
-        ret = -4;
-        goto FINALIZE;
+        return -4;
     }
 
-    // data block
-    if (mat->ftype == 'a'){
-        ret = SRB_read_csc_impl(fp, mat, rb_gets, ptrcrd, indcrd, valcrd);
+    crd[0] = ptrcrd;
+    crd[1] = indcrd;
+    crd[2] = valcrd;
+    return 0;
+}
+
+// state of the fused transform of rb_read_opts
+struct rb_transform {
+    const rb_read_opts_t *opts;
+    SRB_INT *start;     // new colptr counted from 0, NULL without col_perm
+    SRB_INT col;        // original column of the current entry
+    SRB_INT dropped;
+    int defer_rows;     // keep original rows until the values are scaled
+};
+
+typedef struct rb_transform rb_transform_t;
+
+static int SRB_transform_active(const rb_read_opts_t *opts){
+    return opts != NULL && (opts->row_perm != NULL || opts->col_perm != NULL ||
+            opts->row_scale != NULL || opts->col_scale != NULL || opts->drop_tol > 0);
+}
+
+// called once colptr is parsed, entries are placed by it from then on
+static int SRB_transform_init(rb_transform_t *tr, const rb_matrix_info_t *mat,
+        const rb_read_opts_t *opts){
+    int values = mat->mtype == 'r' && !(opts->flags & SRB_READ_PATTERN);
+    int scaled = opts->row_scale != NULL || opts->col_scale != NULL || opts->drop_tol > 0;
+
+    memset(tr, 0, sizeof(rb_transform_t));
+    tr->opts = opts;
+
+    if ((opts->row_perm != NULL || opts->col_perm != NULL) &&
+            mat->stype != 'u' && mat->stype != 'r'){
+        fprintf(stderr, "SRB_read: permuting a stored triangle is not supported.\n");
+        return -999;
+    }
+    if (scaled && mat->mtype == 'i' && !(opts->flags & SRB_READ_PATTERN)){
+        fprintf(stderr, "SRB_read: scaling integer values is not supported.\n");
+        return -999;
     }
 
-FINALIZE:
-    rb_close(fp);
-    return ret;
+    if (mat->colptr[0] != 1 || mat->colptr[mat->cols] != mat->nnz + 1){
+        fprintf(stderr, "SRB_read: colptr is inconsistent with nnz.\n");
+        return -51;
+    }
+    for (SRB_INT j = 0; j < mat->cols; ++j){
+        if (mat->colptr[j + 1] < mat->colptr[j]){
+            fprintf(stderr, "SRB_read: colptr is not monotone at %d.\n", (int)j);
+            return -51;
+        }
+    }
+    if (opts->row_perm != NULL){
+        for (SRB_INT i = 0; i < mat->rows; ++i){
+            if (opts->row_perm[i] < 0 || opts->row_perm[i] >= mat->rows){
+                fprintf(stderr, "SRB_read: row_perm[%d] is out of range.\n", (int)i);
+                return -51;
+            }
+        }
+    }
+
+    if (opts->col_perm != NULL){
+        // count the entries of each new column, -1 marks an unused slot
+        tr->start = (SRB_INT*)malloc((mat->cols + 1) * sizeof(SRB_INT));
+        if (tr->start == NULL)
+            return -1;
+        for (SRB_INT j = 0; j <= mat->cols; ++j) tr->start[j] = -1;
+        for (SRB_INT j = 0; j < mat->cols; ++j){
+            SRB_INT q = opts->col_perm[j];
+            if (q < 0 || q >= mat->cols || tr->start[q] >= 0){
+                fprintf(stderr, "SRB_read: col_perm is not a permutation.\n");
+                free(tr->start);
+                tr->start = NULL;
+                return -51;
+            }
+            tr->start[q] = mat->colptr[j + 1] - mat->colptr[j];
+        }
+        SRB_INT sum = 0;
+        for (SRB_INT q = 0; q <= mat->cols; ++q){
+            SRB_INT cnt = tr->start[q];
+            tr->start[q] = sum;
+            sum += cnt;
+        }
+    }
+
+    tr->defer_rows = values && opts->row_perm != NULL && opts->row_scale != NULL;
+    return 0;
+}
+
+// destination of the k-th entry of the file, entries come in file order
+static inline SRB_INT SRB_transform_dest(rb_transform_t *tr, const SRB_INT *colptr, SRB_INT k){
+    while (k + 1 >= colptr[tr->col + 1]) ++tr->col;
+    if (tr->start == NULL)
+        return k;
+    return tr->start[tr->opts->col_perm[tr->col]] + k + 1 - colptr[tr->col];
+}
+
+static inline int SRB_transform_row(rb_transform_t *tr, rb_matrix_info_t *mat,
+        SRB_INT k, SRB_INT row){
+    if (row < 1 || row > mat->rows)
+        return -1;
+    if (tr->opts->row_perm != NULL && !tr->defer_rows)
+        row = tr->opts->row_perm[row - 1] + 1;
+    mat->rowind[SRB_transform_dest(tr, mat->colptr, k)] = row;
+    return 0;
+}
+
+// dropped entries are marked with row 0 and squeezed out at the end
+static inline void SRB_transform_value(rb_transform_t *tr, rb_matrix_info_t *mat,
+        SRB_INT k, SRB_Scalar v){
+    const rb_read_opts_t *opts = tr->opts;
+    SRB_INT d = SRB_transform_dest(tr, mat->colptr, k);
+    SRB_INT row = mat->rowind[d];
+
+    if (opts->row_scale != NULL) v *= opts->row_scale[row - 1];
+    if (opts->col_scale != NULL) v *= opts->col_scale[tr->col];
+    if (tr->defer_rows) mat->rowind[d] = opts->row_perm[row - 1] + 1;
+    if ((v < 0 ? -v : v) < opts->drop_tol){
+        mat->rowind[d] = 0;
+        ++tr->dropped;
+    }
+    mat->valptr_d[d] = v;
+}
+
+// install the new column pointers and compact the dropped entries in place
+static void SRB_transform_finish(rb_transform_t *tr, rb_matrix_info_t *mat){
+    if (tr->start != NULL){
+        for (SRB_INT j = 0; j <= mat->cols; ++j)
+            mat->colptr[j] = tr->start[j] + 1;
+        free(tr->start);
+        tr->start = NULL;
+    }
+    if (tr->dropped == 0)
+        return;
+
+    SRB_INT w = 0, k = 0;
+    for (SRB_INT j = 0; j < mat->cols; ++j){
+        SRB_INT end = mat->colptr[j + 1] - 1;
+        for (; k < end; ++k){
+            if (mat->rowind[k] == 0)
+                continue;
+            mat->rowind[w] = mat->rowind[k];
+            mat->valptr_d[w] = mat->valptr_d[k];
+            ++w;
+        }
+        mat->colptr[j + 1] = w + 1;
+    }
+    mat->nnz = w;
+
+    // give the tail back, the old blocks stay valid if realloc fails
+    if (w > 0){
+        SRB_INT *rowind = (SRB_INT*)realloc(mat->rowind, w * sizeof(SRB_INT));
+        SRB_Scalar *valptr = (SRB_Scalar*)realloc(mat->valptr_d, w * sizeof(SRB_Scalar));
+        if (rowind != NULL) mat->rowind = rowind;
+        if (valptr != NULL) mat->valptr_d = valptr;
+    }
+}
+
+// indices from 0 for SRB_READ_ZERO_BASED
+void SRB_read_rebase(rb_matrix_info_t *mat, const rb_read_opts_t *opts){
+    if (opts == NULL || !(opts->flags & SRB_READ_ZERO_BASED))
+        return;
+    for (SRB_INT j = 0; j <= mat->cols; ++j)
+        --mat->colptr[j];
+    if (mat->rowind != NULL){
+        for (SRB_INT k = 0; k < mat->nnz; ++k)
+            --mat->rowind[k];
+    }
 }
 
 int SRB_read_csc_impl(void *fp, rb_matrix_info_t *mat, SRB_gets_f rb_gets,
-        SRB_INT nl_ptr, SRB_INT nl_ind, SRB_INT nl_val){
+        SRB_INT nl_ptr, SRB_INT nl_ind, SRB_INT nl_val, const rb_read_opts_t *opts,
+        const rb_value_sink_t *sink){
+    char buffer[SRBIO_LINE_MAX + 2], *chret;
+    int64_t card[SRBIO_CARD_NUMS];
+    rb_transform_t transform, *tr = NULL;
+    rb_stats_state_t stats, *st = NULL;
+    rb_fingerprint_t fingerprint, *hash = NULL;
+    int store = opts == NULL || !(opts->flags & SRB_READ_NO_STORE);
+    int ret;
+
+    if (!store && SRB_transform_active(opts)){
+        fprintf(stderr, "SRB_read: SRB_READ_NO_STORE does not combine with transforms.\n");
+        return -999;
+    }
+    if (!store)
+        sink = NULL;
+
     mat->colptr = (SRB_INT*)malloc((1 + mat->cols) * sizeof(SRB_INT));
-    mat->rowind = (SRB_INT*)malloc(mat->nnz * sizeof(SRB_INT));
+    mat->rowind = NULL;
+    if (store)
+        mat->rowind = (SRB_INT*)malloc(mat->nnz * sizeof(SRB_INT));
     mat->valptr_d = NULL;
     mat->valptr_i = NULL;
-    char buffer[SRBIO_LINE_MAX + 2], *chret;
+
+    if (SRB_numa_active(opts)){
+        ret = SRB_numa_check(opts, mat->cols);
+        if (ret != 0){
+            SRB_destroy(mat);
+            return ret;
+        }
+        SRB_numa_touch_colptr(opts, mat);
+    }
 
     // colptr block
     SRB_INT n = 0;
@@ -187,11 +525,54 @@ int SRB_read_csc_impl(void *fp, rb_matrix_info_t *mat, SRB_gets_f rb_gets,
             SRB_destroy(mat);
             return -1;
         }
-        SRB_INT num_per_line = (mat->cols + 1) / nl_ptr;
-        if ((mat->cols + 1) % nl_ptr > 0) ++num_per_line;
-        for (SRB_INT j = 0; j < num_per_line && n < mat->cols + 1; ++j, ++n){
-            mat->colptr[n] = strtol(chret, &chret, 10);
+        // a card holds as many numbers as its format, which need not be
+        // the count spread evenly over the cards
+        const char *s = chret, *end = chret + strlen(chret);
+        int m;
+        do {
+            m = SRB_card_ints(&s, end, card, SRB_card_want(mat->cols + 1 - n));
+            for (int j = 0; j < m; ++j)
+                mat->colptr[n++] = (SRB_INT)card[j];
+        } while (m == SRBIO_CARD_NUMS);
+    }
+    if (n < mat->cols + 1){
+        fprintf(stderr, "SRB_read_csc_impl: colptr block is short (%d)\n", (int)n);
+        SRB_destroy(mat);
+        return -1;
+    }
+
+    if (opts != NULL && opts->stats != NULL){
+        SRB_stats_begin(&stats, opts->stats, mat);
+        st = &stats;
+    }
+    if (opts != NULL && opts->fingerprint != NULL){
+        SRB_fp_init(&fingerprint);
+        hash = &fingerprint;
+        for (SRB_INT j = 0; j <= mat->cols; ++j)
+            SRB_fp_int(hash, mat->colptr[j]);
+    }
+
+    if (SRB_transform_active(opts)){
+        ret = SRB_transform_init(&transform, mat, opts);
+        if (ret != 0){
+            SRB_destroy(mat);
+            return ret;
+        }
+        tr = &transform;
+    }
+
+    // the value block is allocated early so its pages are placed too
+    if (SRB_numa_active(opts)){
+        if (sink == NULL && store && !(opts->flags & SRB_READ_PATTERN)){
+            if (mat->mtype == 'r')
+                mat->valptr_d = (SRB_Scalar*)malloc(mat->nnz * sizeof(SRB_Scalar));
+            else if (mat->mtype == 'i')
+                mat->valptr_i = (SRB_INT*)malloc(mat->nnz * sizeof(SRB_INT));
         }
+        if (tr != NULL && tr->start != NULL)
+            SRB_numa_touch_entries(opts, mat, tr->start, 0);
+        else
+            SRB_numa_touch_entries(opts, mat, mat->colptr, 1);
     }
 
     // rowind block
@@ -201,68 +582,155 @@ int SRB_read_csc_impl(void *fp, rb_matrix_info_t *mat, SRB_gets_f rb_gets,
         if (chret == NULL){
             fprintf(stderr, "SRB_read_csc_impl: file corrupted at line %d",
                     (int)(i + 4 + nl_ptr));
+            if (tr != NULL) free(tr->start);
             SRB_destroy(mat);
             return -2;
         }
-        SRB_INT num_per_line = (mat->nnz) / nl_ind;
-        if ((mat->nnz) % nl_ind > 0) ++num_per_line;
-        for (SRB_INT j = 0; j < num_per_line && n < mat->nnz; ++j, ++n){
-            mat->rowind[n] = strtol(chret, &chret, 10);
+        const char *s = chret, *end = chret + strlen(chret);
+        int m;
+        do {
+            m = SRB_card_ints(&s, end, card, SRB_card_want(mat->nnz - n));
+            for (int j = 0; j < m; ++j, ++n){
+                SRB_INT row = (SRB_INT)card[j];
+                if (st != NULL) SRB_stats_row(st, n, row);
+                if (hash != NULL) SRB_fp_int(hash, row);
+                if (!store) continue;
+                if (tr == NULL){
+                    mat->rowind[n] = row;
+                } else if (SRB_transform_row(tr, mat, n, row) != 0){
+                    fprintf(stderr, "SRB_read_csc_impl: row index %d is out of range",
+                            (int)n);
+                    free(tr->start);
+                    SRB_destroy(mat);
+                    return -2;
+                }
+            }
+        } while (m == SRBIO_CARD_NUMS);
+    }
+    if (n < mat->nnz){
+        fprintf(stderr, "SRB_read_csc_impl: rowind block is short (%d)\n", (int)n);
+        if (tr != NULL) free(tr->start);
+        SRB_destroy(mat);
+        return -2;
+    }
+
+    if (st != NULL) SRB_stats_finish(st);
+
+    // structure only: the value cards are the last block of the file,
+    // so they are neither read, decompressed nor parsed
+    if (opts != NULL && (opts->flags & SRB_READ_PATTERN)){
+        mat->mtype = 'p';
+        if (hash != NULL) SRB_fp_finish(hash, mat, opts->fingerprint);
+        if (tr != NULL) SRB_transform_finish(tr, mat);
+        if (sink == NULL) SRB_read_rebase(mat, opts);
+        return 0;
+    }
+
+    if (sink != NULL && (mat->mtype == 'r' || mat->mtype == 'i' || mat->mtype == 'p')){
+        ret = sink->begin(sink->ctx, mat);
+        if (ret != 0){
+            if (tr != NULL) free(tr->start);
+            SRB_destroy(mat);
+            return ret;
         }
     }
 
     // value block
+    if (tr != NULL) tr->col = 0;
     switch (mat->mtype){
         case 'r': // real
-            mat->valptr_d = (SRB_Scalar*)malloc(mat->nnz * sizeof(SRB_Scalar));
+            if (sink == NULL && store && mat->valptr_d == NULL)
+                mat->valptr_d = (SRB_Scalar*)malloc(mat->nnz * sizeof(SRB_Scalar));
             n = 0;
             for (SRB_INT i = 0; i < nl_val; ++i){
                 chret = rb_gets(buffer, SRBIO_LINE_MAX + 2, fp);
                 if (chret == NULL){
                     fprintf(stderr, "SRB_read_csc_gzip: file corrupted at line %d",
                             (int)(i + 4 + nl_ptr + nl_ind));
+                    if (tr != NULL) free(tr->start);
                     SRB_destroy(mat);
                     return -3;
                 }
-                SRB_INT num_per_line = (mat->nnz) / nl_val;
-                if ((mat->nnz) % nl_val > 0) ++num_per_line;
-                for (SRB_INT j = 0; j < num_per_line && n < mat->nnz; ++j, ++n){
-                    mat->valptr_d[n] = strtod(chret, &chret);
+                for (char *end; n < mat->nnz; ++n, chret = end){
+                    double v = strtod(chret, &end);
+                    if (end == chret) break;
+                    if (st != NULL) SRB_stats_value(st, v);
+                    if (hash != NULL) SRB_fp_real(hash, v);
+                    if (!store) continue;
+                    if (sink != NULL)
+                        sink->put(sink->ctx, n, v);
+                    else if (tr == NULL)
+                        mat->valptr_d[n] = v;
+                    else
+                        SRB_transform_value(tr, mat, n, v);
                 }
             }
+            if (n < mat->nnz){
+                fprintf(stderr, "SRB_read_csc_impl: value block is short (%d)\n", (int)n);
+                if (tr != NULL) free(tr->start);
+                SRB_destroy(mat);
+                return -3;
+            }
             break;
         case 'c': // complex
             fprintf(stderr, "SRB_read: complex is not supported.\n");
+            if (tr != NULL) free(tr->start);
             return -999;
             break;
         case 'i': // integer
-            mat->valptr_i = (SRB_INT*)malloc(mat->nnz * sizeof(SRB_INT));
+            if (sink == NULL && store && mat->valptr_i == NULL)
+                mat->valptr_i = (SRB_INT*)malloc(mat->nnz * sizeof(SRB_INT));
             n = 0;
             for (SRB_INT i = 0; i < nl_val; ++i){
                 chret = rb_gets(buffer, SRBIO_LINE_MAX + 2, fp);
                 if (chret == NULL){
                     fprintf(stderr, "SRB_read_csc_impl: file corrupted at line %d",
                             (int)(i + 4 + nl_ptr + nl_ind));
+                    if (tr != NULL) free(tr->start);
                     SRB_destroy(mat);
                     return -3;
                 }
-                SRB_INT num_per_line = (mat->nnz) / nl_val;
-                if ((mat->nnz) % nl_val > 0) ++num_per_line;
-                for (SRB_INT j = 0; j < num_per_line && n < mat->nnz; ++j, ++n){
-                    mat->valptr_i[n] = strtol(chret, &chret, 10);
-                }
+                const char *s = chret, *end = chret + strlen(chret);
+                int m;
+                do {
+                    m = SRB_card_ints(&s, end, card, SRB_card_want(mat->nnz - n));
+                    for (int j = 0; j < m; ++j, ++n){
+                        SRB_INT v = (SRB_INT)card[j];
+                        if (st != NULL) SRB_stats_value(st, (double)v);
+                        if (hash != NULL) SRB_fp_int(hash, v);
+                        if (!store) continue;
+                        if (sink != NULL){
+                            sink->put(sink->ctx, n, (SRB_Scalar)v);
+                            continue;
+                        }
+                        SRB_INT d = tr == NULL ? n : SRB_transform_dest(tr, mat->colptr, n);
+                        mat->valptr_i[d] = v;
+                    }
+                } while (m == SRBIO_CARD_NUMS);
+            }
+            if (n < mat->nnz){
+                fprintf(stderr, "SRB_read_csc_impl: value block is short (%d)\n", (int)n);
+                if (tr != NULL) free(tr->start);
+                SRB_destroy(mat);
+                return -3;
             }
             break;
         case 'p': // pattern
             break;
         case 'q': // pattern & aux file
             fprintf(stderr, "SRB_read: pattern + aux file is not supported.\n");
+            if (tr != NULL) free(tr->start);
             return -999;
         default:  // error
             fprintf(stderr, "SRB_read: illegal type (%c)\n", mat->mtype);
+            if (tr != NULL) free(tr->start);
             return -41;
             break;
     }
+
+    if (st != NULL) st->out->values = mat->mtype == 'r' || mat->mtype == 'i';
+    if (hash != NULL) SRB_fp_finish(hash, mat, opts->fingerprint);
+    if (tr != NULL) SRB_transform_finish(tr, mat);
+    if (sink == NULL) SRB_read_rebase(mat, opts);
     return 0;
 }
-
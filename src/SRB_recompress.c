@@ -0,0 +1,539 @@
+/*
+ * ===========================================================================
+ *
+ *       Filename:  SRB_recompress.c
+ *
+ *    Description:  copy a file into another codec without parsing it
+ *
+ *        Version:  1.0
+ *        Created:  10/20/2026 05:02:18 AM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Haoyang Liu (), liuhaoyang@pku.edu.cn
+ *   Organization:  BICMR, Peking University
+ *      Copyright:  Copyright (c) 2021, Haoyang Liu
+ *
+ * ===========================================================================
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "SRBio.h"
+
+#ifdef SRBIO_USE_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef SRBIO_USE_BZIP2
+#include <bzlib.h>
+#endif
+
+#include "private/context.h"
+#include "private/source.h"
+#include "private/read.h"
+
+// text of a gzip block; a bzip2 block is as large as the codec's own
+#define SRBIO_RECOMPRESS_BLOCK (1 << 20)
+
+#define SRB_RZ_FREE 0
+#define SRB_RZ_FILLED 1
+#define SRB_RZ_BUSY 2
+#define SRB_RZ_DONE 3
+#define SRB_RZ_FAILED -1
+
+// a block of the decoded text and its encoding; gzip blocks are raw
+// deflate ending on a byte boundary, primed with the window before them
+struct rb_rz_block {
+    char *in;
+    size_t len;
+    char *dict;
+    size_t dict_len;
+    char *out;
+    size_t olen;
+    size_t ocap;
+    unsigned long crc;
+    int state;
+};
+
+typedef struct rb_rz_block rb_rz_block_t;
+
+// the caller decodes into a ring of blocks and writes them out in order,
+// the workers encode the blocks in between
+struct rb_recompress {
+    char codec;         // 'n': none, 'g': gzip, 'b': bzip2
+    int params[4];      // gzip: level, window bits, mem level, strategy
+    int block_size;     // bzip2
+    int work_factor;
+    size_t bsize;
+
+    size_t nblocks;
+    rb_rz_block_t *blocks;
+    size_t filled;      // blocks handed to the workers
+    size_t next;        // next block a worker takes
+    int stop;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+
+    char *window;       // gzip: the text before the next block
+    size_t wlen;
+    unsigned long crc;  // gzip: of the text written
+};
+
+typedef struct rb_recompress rb_recompress_t;
+
+static long SRB_rz_fread(void *buff, size_t size, void *p){
+    size_t n = fread(buff, 1, size, (FILE*)p);
+    return n == 0 && ferror((FILE*)p) ? -1 : (long)n;
+}
+
+// room for `want` more bytes of output
+static int SRB_rz_reserve(rb_rz_block_t *blk, size_t want){
+    if (blk->ocap - blk->olen >= want)
+        return 0;
+    size_t cap = blk->ocap > 0 ? blk->ocap : 4096;
+    while (cap - blk->olen < want)
+        cap *= 2;
+    char *out = (char*)realloc(blk->out, cap);
+    if (out == NULL)
+        return -1;
+    blk->out = out;
+    blk->ocap = cap;
+    return 0;
+}
+
+// `strm` is the worker's deflate state, set up on first use
+static int SRB_rz_encode(rb_recompress_t *rz, rb_rz_block_t *blk, void **strm){
+    blk->olen = 0;
+    switch (rz->codec){
+        case 'n':
+            return 0;
+#ifdef SRBIO_USE_ZLIB
+        case 'g': {
+            z_stream *zs = (z_stream*)*strm;
+            if (zs == NULL){
+                zs = (z_stream*)calloc(1, sizeof(z_stream));
+                if (zs == NULL)
+                    return -1;
+                if (deflateInit2(zs, rz->params[0], Z_DEFLATED, -rz->params[1], rz->params[2],
+                            rz->params[3]) != Z_OK){
+                    free(zs);
+                    return -1;
+                }
+                *strm = zs;
+            } else if (deflateReset(zs) != Z_OK){
+                return -1;
+            }
+            if (blk->dict_len > 0 &&
+                    deflateSetDictionary(zs, (const Bytef*)blk->dict, (uInt)blk->dict_len) != Z_OK)
+                return -1;
+
+            // the sync flush adds an empty stored block
+            if (SRB_rz_reserve(blk, deflateBound(zs, blk->len) + 16) != 0)
+                return -1;
+            zs->next_in = (Bytef*)blk->in;
+            zs->avail_in = (uInt)blk->len;
+            do {
+                if (SRB_rz_reserve(blk, 64) != 0)
+                    return -1;
+                zs->next_out = (Bytef*)blk->out + blk->olen;
+                zs->avail_out = (uInt)(blk->ocap - blk->olen);
+                if (deflate(zs, Z_SYNC_FLUSH) == Z_STREAM_ERROR)
+                    return -1;
+                blk->olen = blk->ocap - zs->avail_out;
+            } while (zs->avail_out == 0);
+            blk->crc = crc32(0L, (const Bytef*)blk->in, (uInt)blk->len);
+            return 0;
+        }
+#endif
+#ifdef SRBIO_USE_BZIP2
+        case 'b': {
+            bz_stream bs;
+            int info;
+            memset(&bs, 0, sizeof(bz_stream));
+            if (BZ2_bzCompressInit(&bs, rz->block_size, 0, rz->work_factor) != BZ_OK)
+                return -1;
+            if (SRB_rz_reserve(blk, blk->len + blk->len / 100 + 600) != 0){
+                BZ2_bzCompressEnd(&bs);
+                return -1;
+            }
+            bs.next_in = blk->in;
+            bs.avail_in = (unsigned int)blk->len;
+            do {
+                if (SRB_rz_reserve(blk, 64) != 0){
+                    BZ2_bzCompressEnd(&bs);
+                    return -1;
+                }
+                bs.next_out = blk->out + blk->olen;
+                bs.avail_out = (unsigned int)(blk->ocap - blk->olen);
+                info = BZ2_bzCompress(&bs, BZ_FINISH);
+                blk->olen = blk->ocap - bs.avail_out;
+            } while (info == BZ_FINISH_OK);
+            BZ2_bzCompressEnd(&bs);
+            return info == BZ_STREAM_END ? 0 : -1;
+        }
+#endif
+        default:
+            return -1;
+    }
+}
+
+static void SRB_rz_free_strm(rb_recompress_t *rz, void *strm){
+#ifdef SRBIO_USE_ZLIB
+    if (rz->codec == 'g' && strm != NULL){
+        deflateEnd((z_stream*)strm);
+        free(strm);
+    }
+#endif
+    (void)rz;
+    (void)strm;
+}
+
+static void *SRB_rz_worker(void *arg){
+    rb_recompress_t *rz = (rb_recompress_t*)arg;
+    void *strm = NULL;
+
+    pthread_mutex_lock(&rz->lock);
+    for (;;){
+        while (rz->next == rz->filled && !rz->stop)
+            pthread_cond_wait(&rz->cond, &rz->lock);
+        if (rz->next == rz->filled)
+            break;
+        rb_rz_block_t *blk = rz->blocks + rz->next++ % rz->nblocks;
+        blk->state = SRB_RZ_BUSY;
+        pthread_mutex_unlock(&rz->lock);
+
+        int ret = SRB_rz_encode(rz, blk, &strm);
+
+        pthread_mutex_lock(&rz->lock);
+        blk->state = ret == 0 ? SRB_RZ_DONE : SRB_RZ_FAILED;
+        pthread_cond_broadcast(&rz->cond);
+    }
+    pthread_mutex_unlock(&rz->lock);
+
+    SRB_rz_free_strm(rz, strm);
+    return NULL;
+}
+
+// the window of text before the next block, after `blk`
+static void SRB_rz_window(rb_recompress_t *rz, rb_rz_block_t *blk){
+    size_t wsize = (size_t)1 << rz->params[1];
+    memcpy(blk->dict, rz->window, rz->wlen);
+    blk->dict_len = rz->wlen;
+
+    if (blk->len >= wsize){
+        memcpy(rz->window, blk->in + blk->len - wsize, wsize);
+        rz->wlen = wsize;
+        return;
+    }
+    size_t keep = rz->wlen + blk->len > wsize ? wsize - blk->len : rz->wlen;
+    memmove(rz->window, rz->window + rz->wlen - keep, keep);
+    memcpy(rz->window + keep, blk->in, blk->len);
+    rz->wlen = keep + blk->len;
+}
+
+static int SRB_rz_setup(rb_recompress_t *rz, rb_file_compress_t flag,
+        const rb_write_opts_t *opts, int nworkers){
+    rb_write_opts_t defaults;
+    if (opts == NULL){
+        SRB_write_opts_init(&defaults);
+        opts = &defaults;
+    }
+
+    memset(rz, 0, sizeof(rb_recompress_t));
+    rz->bsize = SRBIO_RECOMPRESS_BLOCK;
+    switch (flag & SRB_COMPRESS_MASK){
+        case SRB_COMPRESS_NONE:
+            rz->codec = 'n';
+            break;
+#ifdef SRBIO_USE_ZLIB
+        case SRB_COMPRESS_GZIP:
+            rz->codec = 'g';
+            rz->params[0] = opts->level >= 0 ? opts->level : Z_DEFAULT_COMPRESSION;
+            rz->params[1] = opts->window_bits > 0 ? opts->window_bits : 15;
+            rz->params[2] = opts->mem_level > 0 ? opts->mem_level : 8;
+            rz->params[3] = opts->strategy >= 0 ? opts->strategy : Z_DEFAULT_STRATEGY;
+            rz->window = (char*)malloc((size_t)1 << rz->params[1]);
+            if (rz->window == NULL)
+                return -1;
+            break;
+#endif
+#ifdef SRBIO_USE_BZIP2
+        case SRB_COMPRESS_BZIP2:
+            // one bzip2 block per stream
+            rz->codec = 'b';
+            rz->block_size = opts->block_size > 0 ? opts->block_size : 9;
+            rz->work_factor = opts->work_factor >= 0 ? opts->work_factor : 0;
+            rz->bsize = (size_t)rz->block_size * 100000 - 1000;
+            break;
+#endif
+        default:
+            return -999;
+    }
+
+    // every worker busy while as many blocks wait to be written
+    rz->nblocks = nworkers > 0 ? 2 * (size_t)nworkers + 1 : 1;
+    rz->blocks = (rb_rz_block_t*)calloc(rz->nblocks, sizeof(rb_rz_block_t));
+    if (rz->blocks == NULL)
+        return -1;
+    for (size_t k = 0; k < rz->nblocks; ++k){
+        rz->blocks[k].in = (char*)malloc(rz->bsize);
+        if (rz->blocks[k].in == NULL)
+            return -1;
+        if (rz->codec == 'g'){
+            rz->blocks[k].dict = (char*)malloc((size_t)1 << rz->params[1]);
+            if (rz->blocks[k].dict == NULL)
+                return -1;
+        }
+    }
+    pthread_mutex_init(&rz->lock, NULL);
+    pthread_cond_init(&rz->cond, NULL);
+    return 0;
+}
+
+static void SRB_rz_free(rb_recompress_t *rz){
+    if (rz->blocks != NULL){
+        for (size_t k = 0; k < rz->nblocks; ++k){
+            free(rz->blocks[k].in);
+            free(rz->blocks[k].dict);
+            free(rz->blocks[k].out);
+        }
+        pthread_mutex_destroy(&rz->lock);
+        pthread_cond_destroy(&rz->cond);
+    }
+    free(rz->blocks);
+    free(rz->window);
+}
+
+// the gzip wrapper: a header without name or time, and the check values
+static int SRB_rz_gzip_header(FILE *fp, const rb_recompress_t *rz){
+    unsigned char header[10] = {0x1f, 0x8b, 8, 0, 0, 0, 0, 0, 0, 3};
+    if (rz->params[0] == 9) header[8] = 2;
+    if (rz->params[0] == 1) header[8] = 4;
+    return fwrite(header, 1, 10, fp) == 10 ? 0 : -1;
+}
+
+static int SRB_rz_gzip_trailer(FILE *fp, unsigned long crc, unsigned long long total){
+    // an empty final block, then CRC-32 and length little endian
+    unsigned char trailer[10] = {3, 0};
+    for (int i = 0; i < 4; ++i){
+        trailer[2 + i] = (unsigned char)(crc >> (8 * i));
+        trailer[6 + i] = (unsigned char)(total >> (8 * i));
+    }
+    return fwrite(trailer, 1, 10, fp) == 10 ? 0 : -1;
+}
+
+// cards of the header and of the whole text, counted as they pass
+struct rb_rz_check {
+    int on;
+    long long expect;
+    long long lines;
+    char last;
+};
+
+static int SRB_rz_check_header(struct rb_rz_check *ck, const char *text, size_t len){
+    rb_matrix_info_t hdr;
+    rb_source_t src;
+    char buffer[SRBIO_LINE_MAX + 2];
+    SRB_INT ptrcrd, indcrd, valcrd;
+    long tot = 0, n[4] = {0}, rhscrd = 0;
+
+    SRB_init(&hdr);
+    SRB_source_init_mem(&src, text, len);
+    int ret = SRB_read_header(&src, &hdr, SRB_source_gets, &ptrcrd, &indcrd, &valcrd);
+    if (ret != 0)
+        return ret;
+
+    // totcrd counts an optional right-hand side, announced by a 5th card
+    SRB_source_init_mem(&src, text, len);
+    SRB_source_gets(buffer, SRBIO_LINE_MAX + 2, &src);
+    SRB_source_gets(buffer, SRBIO_LINE_MAX + 2, &src);
+    sscanf(buffer, "%ld %ld %ld %ld %ld", &tot, n + 1, n + 2, n + 3, &rhscrd);
+    ck->expect = 4 + (rhscrd > 0) + tot;
+    return 0;
+}
+
+static void SRB_rz_count(struct rb_rz_check *ck, const char *text, size_t len){
+    const char *p = text, *end = text + len;
+    while ((p = (const char*)memchr(p, '\n', (size_t)(end - p))) != NULL){
+        ++ck->lines;
+        ++p;
+    }
+    if (len > 0)
+        ck->last = text[len - 1];
+}
+
+static int SRB_rz_write(FILE *fp, rb_recompress_t *rz, rb_rz_block_t *blk){
+    pthread_mutex_lock(&rz->lock);
+    while (blk->state != SRB_RZ_DONE && blk->state != SRB_RZ_FAILED)
+        pthread_cond_wait(&rz->cond, &rz->lock);
+    pthread_mutex_unlock(&rz->lock);
+    if (blk->state == SRB_RZ_FAILED){
+        fprintf(stderr, "SRB_recompress: failed to encode a block.\n");
+        return -1;
+    }
+
+#ifdef SRBIO_USE_ZLIB
+    if (rz->codec == 'g')
+        rz->crc = crc32_combine(rz->crc, blk->crc, (z_off_t)blk->len);
+#endif
+    const char *data = rz->codec == 'n' ? blk->in : blk->out;
+    size_t len = rz->codec == 'n' ? blk->len : blk->olen;
+    blk->state = SRB_RZ_FREE;
+    return fwrite(data, 1, len, fp) == len ? 0 : -101;
+}
+
+int SRB_recompress(const char *in, rb_file_compress_t in_flag, const char *out,
+        rb_file_compress_t out_flag, const rb_write_opts_t *opts, int nthreads, int how){
+    rb_recompress_t rz;
+    rb_decoder_t dec;
+    rb_pool_t pool;
+    rb_pool_job_t job;
+    struct rb_rz_check ck;
+    unsigned long long total = 0;
+    size_t head = 0, tail = 0;
+    void *strm = NULL;
+    int ret;
+
+    if (nthreads <= 0){
+        long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+        nthreads = ncpu > 0 ? (int)ncpu : 1;
+    }
+    if ((out_flag & SRB_COMPRESS_MASK) == SRB_COMPRESS_NONE)
+        nthreads = 1;
+
+    FILE *fin = fopen(in, "rb");
+    if (fin == NULL){
+        fprintf(stderr, "Failed to open file: %s.\n", in);
+        return -100;
+    }
+    ret = SRB_decoder_init(&dec, SRB_rz_fread, fin, in_flag);
+    if (ret != 0){
+        fclose(fin);
+        return ret;
+    }
+    ret = SRB_rz_setup(&rz, out_flag, opts, nthreads - 1);
+    if (ret != 0){
+        SRB_rz_free(&rz);
+        SRB_decoder_free(&dec);
+        fclose(fin);
+        return ret;
+    }
+    FILE *fout = fopen(out, "wb");
+    if (fout == NULL){
+        fprintf(stderr, "Failed to open file: %s.\n", out);
+        SRB_rz_free(&rz);
+        SRB_decoder_free(&dec);
+        fclose(fin);
+        return -100;
+    }
+
+    SRB_pool_init(&pool, nthreads - 1);
+    if (pool.nthreads > 0)
+        SRB_pool_submit(&pool, &job, SRB_rz_worker, &rz, pool.nthreads);
+
+    memset(&ck, 0, sizeof(ck));
+    ck.on = (how & SRB_RECOMPRESS_CHECK) != 0;
+    if (rz.codec == 'g' && SRB_rz_gzip_header(fout, &rz) != 0)
+        ret = -101;
+
+    for (int eof = 0; ret == 0 && !eof; ){
+        // the oldest block is written once the ring is full
+        if (tail - head == rz.nblocks){
+            ret = SRB_rz_write(fout, &rz, rz.blocks + head++ % rz.nblocks);
+            if (ret != 0)
+                break;
+        }
+
+        rb_rz_block_t *blk = rz.blocks + tail % rz.nblocks;
+        blk->len = 0;
+        while (blk->len < rz.bsize){
+            long n = SRB_decoder_read(blk->in + blk->len, rz.bsize - blk->len, &dec);
+            if (n < 0){
+                fprintf(stderr, "SRB_recompress: failed to decode file: %s.\n", in);
+                ret = -1;
+                break;
+            }
+            if (n == 0){
+                eof = 1;
+                break;
+            }
+            blk->len += (size_t)n;
+        }
+        if (ret != 0 || blk->len == 0)
+            break;
+
+        if (ck.on){
+            if (tail == 0 && (ret = SRB_rz_check_header(&ck, blk->in, blk->len)) != 0)
+                break;
+            SRB_rz_count(&ck, blk->in, blk->len);
+        }
+        if (rz.codec == 'g'){
+            SRB_rz_window(&rz, blk);
+            total += blk->len;
+        }
+        ++tail;
+
+        if (pool.nthreads > 0){
+            pthread_mutex_lock(&rz.lock);
+            blk->state = SRB_RZ_FILLED;
+            ++rz.filled;
+            pthread_cond_broadcast(&rz.cond);
+            pthread_mutex_unlock(&rz.lock);
+        } else {
+            blk->state = SRB_rz_encode(&rz, blk, &strm) == 0 ? SRB_RZ_DONE : SRB_RZ_FAILED;
+        }
+    }
+
+    if (ret == 0 && ck.on && tail == 0)
+        ret = SRB_rz_check_header(&ck, "", 0);
+
+    // the blocks left are written even after a failure, so the workers
+    // are done with them
+    for (; head < tail; ++head){
+        int info = SRB_rz_write(fout, &rz, rz.blocks + head % rz.nblocks);
+        if (ret == 0)
+            ret = info;
+    }
+    pthread_mutex_lock(&rz.lock);
+    rz.stop = 1;
+    pthread_cond_broadcast(&rz.cond);
+    pthread_mutex_unlock(&rz.lock);
+    if (pool.nthreads > 0)
+        SRB_pool_wait(&pool, &job);
+    SRB_pool_free(&pool);
+    SRB_rz_free_strm(&rz, strm);
+
+    if (ret == 0 && rz.codec == 'g' && SRB_rz_gzip_trailer(fout, rz.crc, total) != 0)
+        ret = -101;
+#ifdef SRBIO_USE_BZIP2
+    // an empty text is still one stream
+    if (ret == 0 && rz.codec == 'b' && tail == 0){
+        rb_rz_block_t *blk = rz.blocks;
+        blk->len = 0;
+        if (SRB_rz_encode(&rz, blk, &strm) != 0 || fwrite(blk->out, 1, blk->olen, fout) != blk->olen)
+            ret = -101;
+    }
+#endif
+    if (fclose(fout) != 0 && ret == 0)
+        ret = -101;
+    if (ret == -101)
+        fprintf(stderr, "SRB_recompress: failed to write file: %s.\n", out);
+
+    if (ret == 0 && ck.on){
+        long long cards = ck.lines + (ck.last != '\n' && ck.last != '\0');
+        if (cards != ck.expect){
+            fprintf(stderr, "SRB_recompress: %lld cards, the header announces %lld.\n",
+                    cards, ck.expect);
+            ret = -5;
+        }
+    }
+
+    SRB_rz_free(&rz);
+    SRB_decoder_free(&dec);
+    fclose(fin);
+    return ret;
+}
@@ -0,0 +1,407 @@
+/*
+ * ===========================================================================
+ *
+ *       Filename:  SRB_shard.c
+ *
+ *    Description:  column blocks in separate RB files listed by a manifest
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 10:02:37 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Haoyang Liu (), liuhaoyang@pku.edu.cn
+ *   Organization:  BICMR, Peking University
+ *      Copyright:  Copyright (c) 2021, Haoyang Liu
+ *
+ * ===========================================================================
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "SRBio.h"
+#include "private/context.h"
+
+#define SRBIO_SHARD_MAGIC "%SRBio-shards 1"
+#define SRBIO_SHARD_PATH_MAX 4096
+
+// manifest:
+//   %SRBio-shards 1
+//   title <descr>
+//   key <key>
+//   matrix <mtype><stype><ftype> <rows> <cols> <nnz> <nshards>
+//   shard <col0> <col1> <nnz> <compress> <file>     (once per shard)
+//
+// files are relative to the manifest; each shard holds all rows of columns
+// [col0, col1) as an ordinary RB file, 'u' unless it is the whole matrix
+
+int SRB_write_impl(const char *, const char *, const rb_matrix_info_t*, int,
+        rb_file_compress_t, const rb_write_opts_t*, rb_context_t*);
+
+struct rb_shard {
+    SRB_INT col0;
+    SRB_INT col1;
+    SRB_INT nnz;
+    int flag;
+    char path[SRBIO_SHARD_PATH_MAX];
+};
+
+// shared by the workers, shards are taken in order
+struct rb_shard_job {
+    pthread_mutex_t lock;
+    int next;
+    int nshards;
+    struct rb_shard *shard;
+    const rb_matrix_info_t *mat;
+    rb_matrix_info_t *out;
+    int precision;
+    rb_file_compress_t flag;
+    const rb_write_opts_t *opts;
+    rb_pool_t *pool;        // NULL: threads of its own
+    int ret;
+};
+
+static const char *SRB_shard_ext(rb_file_compress_t flag){
+    switch (flag & SRB_COMPRESS_MASK){
+        case SRB_COMPRESS_GZIP:
+            return ".gz";
+        case SRB_COMPRESS_BZIP2:
+            return ".bz2";
+        default:
+            return "";
+    }
+}
+
+// `name` next to the manifest
+static void SRB_shard_path(char *path, const char *manifest, const char *name){
+    const char *slash = strrchr(manifest, '/');
+    int dir = slash != NULL ? (int)(slash - manifest + 1) : 0;
+    snprintf(path, SRBIO_SHARD_PATH_MAX, "%.*s%s", dir, manifest, name);
+}
+
+static int SRB_shard_take(struct rb_shard_job *job){
+    int s;
+    pthread_mutex_lock(&job->lock);
+    s = job->ret == 0 && job->next < job->nshards ? job->next++ : -1;
+    pthread_mutex_unlock(&job->lock);
+    return s;
+}
+
+static void SRB_shard_fail(struct rb_shard_job *job, int ret){
+    pthread_mutex_lock(&job->lock);
+    if (job->ret == 0)
+        job->ret = ret;
+    pthread_mutex_unlock(&job->lock);
+}
+
+// run `worker` on min(shards, cpus) threads, the caller being one of them
+static int SRB_shard_run(struct rb_shard_job *job, void *(*worker)(void*)){
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    int nthreads = job->nshards < ncpu ? job->nshards : (int)(ncpu > 0 ? ncpu : 1);
+    pthread_t *threads = NULL;
+    int started = 0;
+
+    pthread_mutex_init(&job->lock, NULL);
+    job->next = 0;
+    job->ret = 0;
+    if (job->pool != NULL){
+        rb_pool_job_t run;
+        SRB_pool_submit(job->pool, &run, worker, job, job->nshards - 1);
+        worker(job);
+        SRB_pool_wait(job->pool, &run);
+        pthread_mutex_destroy(&job->lock);
+        return job->ret;
+    }
+
+    threads = (pthread_t*)malloc(nthreads * sizeof(pthread_t));
+    for (int t = 1; threads != NULL && t < nthreads; ++t){
+        if (pthread_create(&threads[started], NULL, worker, job) != 0)
+            break;
+        ++started;
+    }
+    worker(job);
+    for (int t = 0; t < started; ++t)
+        pthread_join(threads[t], NULL);
+    pthread_mutex_destroy(&job->lock);
+    free(threads);
+    return job->ret;
+}
+
+static void *SRB_shard_write_worker(void *p){
+    struct rb_shard_job *job = (struct rb_shard_job*)p;
+    const rb_matrix_info_t *mat = job->mat;
+    int base = (job->flag & SRB_WRITE_ZERO_BASED) ? 0 : 1;
+    int s;
+
+    while ((s = SRB_shard_take(job)) >= 0){
+        const struct rb_shard *sh = job->shard + s;
+        rb_matrix_info_t view = *mat;
+        SRB_INT off = mat->colptr[sh->col0] - base;
+        int ret;
+
+        // the entries are used in place, only colptr is made local
+        view.cols = sh->col1 - sh->col0;
+        view.nnz = sh->nnz;
+        if (job->nshards > 1)
+            view.stype = 'u';
+        view.colptr = (SRB_INT*)malloc((view.cols + 1) * sizeof(SRB_INT));
+        if (view.colptr == NULL){
+            SRB_shard_fail(job, -1);
+            break;
+        }
+        for (SRB_INT j = 0; j <= view.cols; ++j)
+            view.colptr[j] = mat->colptr[sh->col0 + j] - off;
+        if (mat->rowind != NULL) view.rowind = mat->rowind + off;
+        if (mat->valptr_d != NULL) view.valptr_d = mat->valptr_d + off;
+        if (mat->valptr_i != NULL) view.valptr_i = mat->valptr_i + off;
+
+        ret = SRB_write_impl(sh->path, (job->flag & SRB_IO_DIRECT) ? "wd" : "w",
+                &view, job->precision, job->flag, job->opts, NULL);
+        free(view.colptr);
+        if (ret != 0)
+            SRB_shard_fail(job, ret);
+    }
+    return NULL;
+}
+
+// the shards are cut at nnz / nshards entries, on column boundaries
+int SRB_write_shards(const char *filename, const rb_matrix_info_t *mat, int precision,
+        rb_file_compress_t flag, const rb_write_opts_t *opts, rb_context_t *ctx){
+    int nshards = (flag & SRB_SHARDS_MASK) >> SRB_SHARDS_SHIFT;
+    int base = (flag & SRB_WRITE_ZERO_BASED) ? 0 : 1;
+    struct rb_shard_job job;
+    struct rb_shard *shard;
+    rb_write_opts_t shard_opts;
+    const char *name;
+    FILE *fp;
+    int ret;
+
+    if (mat->ftype != 'a')
+        return -999;
+    if (nshards > mat->cols)
+        nshards = mat->cols > 0 ? (int)mat->cols : 1;
+    shard = (struct rb_shard*)calloc(nshards, sizeof(struct rb_shard));
+    if (shard == NULL)
+        return -1;
+
+    name = strrchr(filename, '/');
+    name = name != NULL ? name + 1 : filename;
+
+    SRB_INT j = 0;
+    for (int s = 0; s < nshards; ++s){
+        SRB_INT target = (SRB_INT)((double)mat->nnz * (s + 1) / nshards) + base;
+        shard[s].col0 = j;
+        if (s == nshards - 1)
+            j = mat->cols;
+        else {
+            // leave a column for each of the remaining shards
+            while (j < mat->cols - (nshards - s - 1) &&
+                    (j == shard[s].col0 || mat->colptr[j] < target))
+                ++j;
+        }
+        shard[s].col1 = j;
+        shard[s].nnz = mat->colptr[shard[s].col1] - mat->colptr[shard[s].col0];
+        shard[s].flag = flag & SRB_COMPRESS_MASK;
+        snprintf(shard[s].path, SRBIO_SHARD_PATH_MAX, "%s.%d%s", filename, s,
+                SRB_shard_ext(flag));
+    }
+
+    job.nshards = nshards;
+    job.shard = shard;
+    job.mat = mat;
+    job.precision = precision;
+    job.flag = flag & ~(SRB_SHARDS_MASK | SRB_WRITE_SYMMETRY);
+    job.opts = opts;
+    job.pool = ctx != NULL ? &ctx->pool : NULL;
+    // the shards are hashed one by one, which is not the matrix
+    if (opts != NULL && opts->fingerprint != NULL){
+        shard_opts = *opts;
+        shard_opts.fingerprint = NULL;
+        job.opts = &shard_opts;
+    }
+    ret = SRB_shard_run(&job, SRB_shard_write_worker);
+
+    // the manifest goes last, a missing one marks an incomplete save
+    if (ret == 0){
+        fp = fopen(filename, "w");
+        if (fp == NULL){
+            fprintf(stderr, "Failed to open file: %s.\n", filename);
+            free(shard);
+            return -100;
+        }
+        fprintf(fp, "%s\n", SRBIO_SHARD_MAGIC);
+        fprintf(fp, "title %s\n", mat->descr);
+        fprintf(fp, "key %s\n", mat->key);
+        fprintf(fp, "matrix %c%c%c %ld %ld %ld %d\n", mat->mtype, mat->stype, mat->ftype,
+                (long)mat->rows, (long)mat->cols, (long)mat->nnz, nshards);
+        for (int s = 0; s < nshards; ++s){
+            fprintf(fp, "shard %ld %ld %ld %d %s.%d%s\n", (long)shard[s].col0,
+                    (long)shard[s].col1, (long)shard[s].nnz, shard[s].flag, name, s,
+                    SRB_shard_ext(flag));
+        }
+        if (fclose(fp) != 0){
+            fprintf(stderr, "SRB_write: failed to write file: %s.\n", filename);
+            ret = -101;
+        }
+    }
+
+    free(shard);
+    return ret;
+}
+
+static void *SRB_shard_read_worker(void *p){
+    struct rb_shard_job *job = (struct rb_shard_job*)p;
+    rb_matrix_info_t *out = job->out;
+    int s;
+
+    while ((s = SRB_shard_take(job)) >= 0){
+        const struct rb_shard *sh = job->shard + s;
+        rb_matrix_info_t part;
+        int ret;
+
+        SRB_init(&part);
+        ret = SRB_read(sh->path, &part, (rb_file_compress_t)sh->flag);
+        if (ret != 0){
+            SRB_shard_fail(job, ret);
+            break;
+        }
+        if (part.rows != out->rows || part.cols != sh->col1 - sh->col0 ||
+                part.nnz != sh->nnz || part.mtype != out->mtype){
+            fprintf(stderr, "SRB_read_shards: %s does not match the manifest.\n", sh->path);
+            SRB_destroy(&part);
+            SRB_shard_fail(job, -31);
+            break;
+        }
+
+        SRB_INT off = out->colptr[sh->col0] - 1;
+        for (SRB_INT j = 0; j < part.cols; ++j)
+            out->colptr[sh->col0 + j] = part.colptr[j] + off;
+        memcpy(out->rowind + off, part.rowind, part.nnz * sizeof(SRB_INT));
+        if (out->valptr_d != NULL)
+            memcpy(out->valptr_d + off, part.valptr_d, part.nnz * sizeof(SRB_Scalar));
+        if (out->valptr_i != NULL)
+            memcpy(out->valptr_i + off, part.valptr_i, part.nnz * sizeof(SRB_INT));
+        SRB_destroy(&part);
+    }
+    return NULL;
+}
+
+// read the shards concurrently into one matrix
+int SRB_read_shards(const char *filename, rb_matrix_info_t *mat){
+    char line[SRBIO_SHARD_PATH_MAX + 128], name[SRBIO_SHARD_PATH_MAX];
+    struct rb_shard_job job;
+    struct rb_shard *shard = NULL;
+    long rows, cols, nnz;
+    int nshards = 0, nalloc = 0, ret = 0;
+    FILE *fp;
+
+    fp = fopen(filename, "r");
+    if (fp == NULL){
+        fprintf(stderr, "Failed to open file: %s.\n", filename);
+        return -100;
+    }
+
+    SRB_init(mat);
+    if (fgets(line, sizeof(line), fp) == NULL ||
+            strncmp(line, SRBIO_SHARD_MAGIC, strlen(SRBIO_SHARD_MAGIC)) != 0){
+        fprintf(stderr, "SRB_read_shards: %s is not a manifest.\n", filename);
+        fclose(fp);
+        return -31;
+    }
+
+    while (fgets(line, sizeof(line), fp) != NULL){
+        line[strcspn(line, "\n")] = '\0';
+        if (strncmp(line, "title ", 6) == 0)
+            snprintf(mat->descr, sizeof(mat->descr), "%s", line + 6);
+        else if (strncmp(line, "key ", 4) == 0)
+            snprintf(mat->key, sizeof(mat->key), "%s", line + 4);
+        else if (strncmp(line, "matrix ", 7) == 0 && shard == NULL){
+            if (sscanf(line + 7, "%c%c%c %ld %ld %ld %d", &mat->mtype, &mat->stype,
+                        &mat->ftype, &rows, &cols, &nnz, &nshards) != 7 || nshards <= 0){
+                ret = -31;
+                break;
+            }
+            mat->rows = rows;
+            mat->cols = cols;
+            mat->nnz = nnz;
+            shard = (struct rb_shard*)calloc(nshards, sizeof(struct rb_shard));
+            if (shard == NULL){
+                ret = -1;
+                break;
+            }
+            nalloc = nshards;
+            nshards = 0;
+        } else if (strncmp(line, "shard ", 6) == 0 && shard != NULL && nshards < nalloc){
+            long c0, c1, n;
+            struct rb_shard *sh = shard + nshards;
+            if (sscanf(line + 6, "%ld %ld %ld %d %4095s", &c0, &c1, &n, &sh->flag, name) != 5){
+                ret = -31;
+                break;
+            }
+            sh->col0 = c0;
+            sh->col1 = c1;
+            sh->nnz = n;
+            SRB_shard_path(sh->path, filename, name);
+            ++nshards;
+        }
+    }
+    fclose(fp);
+
+    // the shards must tile the columns and the entries in order
+    if (ret == 0 && (shard == NULL || nshards != nalloc || shard[0].col0 != 0 ||
+                shard[nshards - 1].col1 != mat->cols))
+        ret = -31;
+    for (int s = 0; ret == 0 && s < nshards; ++s){
+        if (shard[s].col1 < shard[s].col0 || (s > 0 && shard[s].col0 != shard[s - 1].col1))
+            ret = -31;
+    }
+    if (ret != 0){
+        if (ret == -31)
+            fprintf(stderr, "SRB_read_shards: %s is malformed.\n", filename);
+        free(shard);
+        return ret;
+    }
+
+    mat->colptr = (SRB_INT*)malloc((mat->cols + 1) * sizeof(SRB_INT));
+    mat->rowind = (SRB_INT*)malloc(mat->nnz * sizeof(SRB_INT));
+    if (mat->mtype == 'r')
+        mat->valptr_d = (SRB_Scalar*)malloc(mat->nnz * sizeof(SRB_Scalar));
+    else if (mat->mtype == 'i')
+        mat->valptr_i = (SRB_INT*)malloc(mat->nnz * sizeof(SRB_INT));
+    if (mat->colptr == NULL || mat->rowind == NULL ||
+            (mat->mtype == 'r' && mat->valptr_d == NULL) ||
+            (mat->mtype == 'i' && mat->valptr_i == NULL)){
+        SRB_destroy(mat);
+        free(shard);
+        return -1;
+    }
+
+    // the start of each block is known before any shard is parsed
+    SRB_INT pos = 1;
+    for (int s = 0; s < nshards; ++s){
+        mat->colptr[shard[s].col0] = pos;
+        pos += shard[s].nnz;
+    }
+    mat->colptr[mat->cols] = pos;
+    if (pos != mat->nnz + 1){
+        fprintf(stderr, "SRB_read_shards: %s is malformed.\n", filename);
+        SRB_destroy(mat);
+        free(shard);
+        return -31;
+    }
+
+    job.nshards = nshards;
+    job.shard = shard;
+    job.out = mat;
+    job.pool = NULL;
+    ret = SRB_shard_run(&job, SRB_shard_read_worker);
+    if (ret != 0)
+        SRB_destroy(mat);
+
+    free(shard);
+    return ret;
+}
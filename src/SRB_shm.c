@@ -0,0 +1,306 @@
+/*
+ * ===========================================================================
+ *
+ *       Filename:  SRB_shm.c
+ *
+ *    Description:  matrices shared across processes in POSIX shared memory
+ *
+ *        Version:  1.0
+ *        Created:  10/20/2026 06:32:18 AM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Haoyang Liu (), liuhaoyang@pku.edu.cn
+ *   Organization:  BICMR, Peking University
+ *      Copyright:  Copyright (c) 2021, Haoyang Liu
+ *
+ * ===========================================================================
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "SRBio.h"
+
+#define RB_SHM_MAGIC "SRBshm1"
+#define RB_SHM_ALIGN 64
+
+// the first page(s) of the object, mapped writable for the reference count;
+// the arrays follow at `data`, offsets are from there and 0 means absent
+struct rb_shm_header {
+    char magic[8];          // stored last by the publisher
+    uint32_t int_size;      // sizeof(SRB_INT) and sizeof(SRB_Scalar) of the
+    uint32_t scalar_size;   // library which published it
+    int64_t refs;
+    uint64_t data;
+    uint64_t bytes;
+
+    char descr[73];
+    char key[9];
+    char mtype;
+    char stype;
+    char ftype;
+    int64_t rows;
+    int64_t cols;
+    int64_t nnz;
+
+    uint64_t colptr;
+    uint64_t rowind;
+    uint64_t valptr_d;
+    uint64_t valptr_i;
+};
+
+typedef struct rb_shm_header rb_shm_header_t;
+
+struct rb_shm {
+    rb_matrix_info_t mat;
+    char *name;
+    rb_shm_header_t *hdr;
+    size_t hdr_len;
+    void *data;
+    size_t data_len;
+};
+
+static size_t SRB_shm_round(size_t n, size_t a){
+    return (n + a - 1) / a * a;
+}
+
+// places an array of n bytes after *pos, 0 if there is none
+static uint64_t SRB_shm_place(const void *p, size_t n, size_t *pos){
+    if (p == NULL)
+        return 0;
+    uint64_t off = *pos;
+    *pos = SRB_shm_round(*pos + n, RB_SHM_ALIGN);
+    return off;
+}
+
+// maps an object whose header is complete, the reference the caller holds
+// is the handle's from now on
+static rb_shm_t *SRB_shm_map(int fd, const char *name, int *info){
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t hdr_len = SRB_shm_round(sizeof(rb_shm_header_t), page);
+    struct stat st;
+    rb_shm_t *shm;
+    rb_shm_header_t *hdr;
+
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size < hdr_len){
+        fprintf(stderr, "SRB_shm_attach: %s is not ready.\n", name);
+        *info = -1;
+        return NULL;
+    }
+    hdr = (rb_shm_header_t*)mmap(NULL, hdr_len, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (hdr == MAP_FAILED){
+        *info = -100;
+        return NULL;
+    }
+    if (__atomic_load_n(&hdr->magic[0], __ATOMIC_ACQUIRE) == 0 ||
+            memcmp(hdr->magic, RB_SHM_MAGIC, sizeof(hdr->magic)) != 0 ||
+            hdr->data != hdr_len || hdr->bytes != (uint64_t)st.st_size){
+        fprintf(stderr, "SRB_shm_attach: %s is not ready.\n", name);
+        munmap(hdr, hdr_len);
+        *info = -1;
+        return NULL;
+    }
+    if (hdr->int_size != sizeof(SRB_INT) || hdr->scalar_size != sizeof(SRB_Scalar)){
+        fprintf(stderr, "SRB_shm_attach: %s holds %u-byte integers and %u-byte reals.\n",
+                name, hdr->int_size, hdr->scalar_size);
+        munmap(hdr, hdr_len);
+        *info = -999;
+        return NULL;
+    }
+
+    shm = (rb_shm_t*)calloc(1, sizeof(rb_shm_t));
+    if (shm == NULL || (shm->name = strdup(name)) == NULL){
+        free(shm);
+        munmap(hdr, hdr_len);
+        *info = -1;
+        return NULL;
+    }
+    shm->hdr = hdr;
+    shm->hdr_len = hdr_len;
+    shm->data_len = hdr->bytes - hdr_len;
+    shm->data = mmap(NULL, shm->data_len, PROT_READ, MAP_SHARED, fd, hdr_len);
+    if (shm->data == MAP_FAILED){
+        munmap(hdr, hdr_len);
+        free(shm->name);
+        free(shm);
+        *info = -100;
+        return NULL;
+    }
+
+    char *base = (char*)shm->data;
+    rb_matrix_info_t *mat = &shm->mat;
+    memcpy(mat->descr, hdr->descr, sizeof(mat->descr));
+    memcpy(mat->key, hdr->key, sizeof(mat->key));
+    mat->mtype = hdr->mtype;
+    mat->stype = hdr->stype;
+    mat->ftype = hdr->ftype;
+    mat->rows = (SRB_INT)hdr->rows;
+    mat->cols = (SRB_INT)hdr->cols;
+    mat->nnz = (SRB_INT)hdr->nnz;
+    mat->colptr = (SRB_INT*)(base + hdr->colptr);
+    mat->rowind = hdr->rowind ? (SRB_INT*)(base + hdr->rowind) : NULL;
+    mat->valptr_d = hdr->valptr_d ? (SRB_Scalar*)(base + hdr->valptr_d) : NULL;
+    mat->valptr_i = hdr->valptr_i ? (SRB_INT*)(base + hdr->valptr_i) : NULL;
+
+    *info = 0;
+    return shm;
+}
+
+// copies mat into a new object `name` (an existing one is not replaced)
+// and returns a handle holding the first reference
+rb_shm_t *SRB_shm_publish(const char *name, const rb_matrix_info_t *mat, int *info){
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t hdr_len = SRB_shm_round(sizeof(rb_shm_header_t), page);
+    size_t nnz = mat->nnz;
+    size_t pos = 0;
+    int ret = 0;
+    rb_shm_t *shm;
+
+    if (info == NULL) info = &ret;
+    if (mat->colptr == NULL){
+        *info = -1;
+        return NULL;
+    }
+
+    // the arrays are laid out first, the object is sized once
+    rb_shm_header_t h;
+    memset(&h, 0, sizeof(h));
+    h.colptr = SRB_shm_place(mat->colptr, (mat->cols + 1) * sizeof(SRB_INT), &pos);
+    h.rowind = SRB_shm_place(mat->rowind, nnz * sizeof(SRB_INT), &pos);
+    h.valptr_d = SRB_shm_place(mat->valptr_d, nnz * sizeof(SRB_Scalar), &pos);
+    h.valptr_i = SRB_shm_place(mat->valptr_i, nnz * sizeof(SRB_INT), &pos);
+    h.int_size = sizeof(SRB_INT);
+    h.scalar_size = sizeof(SRB_Scalar);
+    h.refs = 1;
+    h.data = hdr_len;
+    h.bytes = hdr_len + pos;
+    memcpy(h.descr, mat->descr, sizeof(h.descr));
+    memcpy(h.key, mat->key, sizeof(h.key));
+    h.mtype = mat->mtype;
+    h.stype = mat->stype;
+    h.ftype = mat->ftype;
+    h.rows = mat->rows;
+    h.cols = mat->cols;
+    h.nnz = mat->nnz;
+
+    int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600);
+    if (fd < 0){
+        fprintf(stderr, "SRB_shm_publish: cannot create %s: %s\n", name, strerror(errno));
+        *info = -100;
+        return NULL;
+    }
+    char *p = NULL;
+    if (ftruncate(fd, (off_t)h.bytes) != 0 ||
+            (p = (char*)mmap(NULL, h.bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED){
+        fprintf(stderr, "SRB_shm_publish: cannot size %s: %s\n", name, strerror(errno));
+        shm_unlink(name);
+        close(fd);
+        *info = -101;
+        return NULL;
+    }
+
+    char *base = p + hdr_len;
+    memcpy(base + h.colptr, mat->colptr, (mat->cols + 1) * sizeof(SRB_INT));
+    if (h.rowind) memcpy(base + h.rowind, mat->rowind, nnz * sizeof(SRB_INT));
+    if (h.valptr_d) memcpy(base + h.valptr_d, mat->valptr_d, nnz * sizeof(SRB_Scalar));
+    if (h.valptr_i) memcpy(base + h.valptr_i, mat->valptr_i, nnz * sizeof(SRB_INT));
+
+    // attachers look at the magic first, it goes in after everything else
+    rb_shm_header_t *hdr = (rb_shm_header_t*)p;
+    memcpy(hdr, &h, sizeof(h));
+    memcpy(hdr->magic + 1, RB_SHM_MAGIC + 1, sizeof(hdr->magic) - 1);
+    __atomic_store_n(&hdr->magic[0], RB_SHM_MAGIC[0], __ATOMIC_RELEASE);
+    munmap(p, h.bytes);
+
+    shm = SRB_shm_map(fd, name, info);
+    close(fd);
+    if (shm == NULL)
+        shm_unlink(name);
+    return shm;
+}
+
+// parses a file as SRB_read and publishes it
+rb_shm_t *SRB_shm_load(const char *name, const char *filename, rb_file_compress_t flag, int *info){
+    rb_matrix_info_t mat;
+    int ret;
+
+    SRB_init(&mat);
+    ret = SRB_read(filename, &mat, flag);
+    if (ret != 0){
+        if (info != NULL) *info = ret;
+        return NULL;
+    }
+    rb_shm_t *shm = SRB_shm_publish(name, &mat, info);
+    SRB_destroy(&mat);
+    return shm;
+}
+
+// maps a published object read-only, -100 in info if there is none or it is
+// being removed, -1 if its publisher has not finished, -999 if it was
+// published by a library of other integer or real sizes
+rb_shm_t *SRB_shm_attach(const char *name, int *info){
+    int ret = 0;
+    if (info == NULL) info = &ret;
+
+    int fd = shm_open(name, O_RDWR, 0);
+    if (fd < 0){
+        fprintf(stderr, "SRB_shm_attach: cannot open %s: %s\n", name, strerror(errno));
+        *info = -100;
+        return NULL;
+    }
+    rb_shm_t *shm = SRB_shm_map(fd, name, info);
+    close(fd);
+    if (shm == NULL)
+        return NULL;
+
+    // take a reference unless the last holder is already removing it
+    int64_t refs = __atomic_load_n(&shm->hdr->refs, __ATOMIC_ACQUIRE);
+    do {
+        if (refs <= 0){
+            munmap(shm->data, shm->data_len);
+            munmap(shm->hdr, shm->hdr_len);
+            free(shm->name);
+            free(shm);
+            *info = -100;
+            return NULL;
+        }
+    } while (!__atomic_compare_exchange_n(&shm->hdr->refs, &refs, refs + 1, 0,
+                __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE));
+    return shm;
+}
+
+// read-only, valid until the handle is detached
+const rb_matrix_info_t *SRB_shm_matrix(const rb_shm_t *shm){
+    return &shm->mat;
+}
+
+// drops the handle's reference, the last one removes the name
+void SRB_shm_detach(rb_shm_t *shm){
+    if (shm == NULL)
+        return;
+    if (__atomic_sub_fetch(&shm->hdr->refs, 1, __ATOMIC_ACQ_REL) == 0)
+        shm_unlink(shm->name);
+    munmap(shm->data, shm->data_len);
+    munmap(shm->hdr, shm->hdr_len);
+    free(shm->name);
+    free(shm);
+}
+
+// removes a name whatever its count, e.g. one left by a process that died
+// holding a reference; current mappings stay valid
+int SRB_shm_unlink(const char *name){
+    if (shm_unlink(name) != 0){
+        fprintf(stderr, "SRB_shm_unlink: cannot remove %s: %s\n", name, strerror(errno));
+        return -100;
+    }
+    return 0;
+}
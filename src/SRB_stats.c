@@ -0,0 +1,72 @@
+/*
+ * ===========================================================================
+ *
+ *       Filename:  SRB_stats.c
+ *
+ *    Description:  statistics collected by the parser
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 09:43:02 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Haoyang Liu (), liuhaoyang@pku.edu.cn
+ *   Organization:  BICMR, Peking University
+ *      Copyright:  Copyright (c) 2021, Haoyang Liu
+ *
+ * ===========================================================================
+ */
+
+#include <string.h>
+
+#include "SRBio.h"
+#include "private/stats.h"
+
+// colptr is parsed, the column counts are taken from it here
+void SRB_stats_begin(rb_stats_state_t *st, rb_stats_t *out, const rb_matrix_info_t *mat){
+    memset(out, 0, sizeof(rb_stats_t));
+    memset(st, 0, sizeof(rb_stats_state_t));
+    st->out = out;
+    st->colptr = mat->colptr;
+    st->rows = mat->rows;
+    st->cols = mat->cols;
+    st->col = -1;
+    st->lower_profile = mat->stype != 'u';
+
+    for (SRB_INT j = 0; j < mat->cols; ++j){
+        SRB_INT cnt = mat->colptr[j + 1] - mat->colptr[j];
+        int b = 0;
+        while (b < SRB_STATS_BINS - 1 && cnt >= ((SRB_INT)1 << b))
+            ++b;
+        ++out->colhist[b];
+        if (j == 0 || cnt < out->colnnz_min) out->colnnz_min = cnt;
+        if (cnt > out->colnnz_max) out->colnnz_max = cnt;
+    }
+}
+
+// close the current column and step to the next one
+void SRB_stats_column(rb_stats_state_t *st){
+    rb_stats_t *out = st->out;
+
+    if (st->col >= 0){
+        SRB_INT j = st->col + 1;
+        if (st->rmax > 0){
+            if (st->lower_profile && st->rmax > j) out->profile += st->rmax - j;
+            if (!st->lower_profile && st->rmin < j) out->profile += j - st->rmin;
+        }
+        if (j <= st->rows && !st->seen_diag)
+            ++out->diag_missing;
+    }
+
+    ++st->col;
+    if (st->col < st->cols)
+        st->end = st->colptr[st->col + 1] - 1;
+    st->rmin = st->rows + 1;
+    st->rmax = 0;
+    st->seen_diag = 0;
+}
+
+void SRB_stats_finish(rb_stats_state_t *st){
+    while (st->col < st->cols)
+        SRB_stats_column(st);
+}
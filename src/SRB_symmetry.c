@@ -0,0 +1,177 @@
+/*
+ * ===========================================================================
+ *
+ *       Filename:  SRB_symmetry.c
+ *
+ *    Description:  symmetry detection by a parallel transpose comparison
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 08:21:37 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Haoyang Liu (), liuhaoyang@pku.edu.cn
+ *   Organization:  BICMR, Peking University
+ *      Copyright:  Copyright (c) 2021, Haoyang Liu
+ *
+ * ===========================================================================
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
+
+#include "SRBio.h"
+
+// transpose from 0, columns come out sorted
+struct rb_transpose {
+    SRB_INT *ptr;
+    SRB_INT *ind;
+    double *val;        // NULL for patterns
+};
+
+static double SRB_sym_value(const rb_matrix_info_t *mat, SRB_INT k){
+    if (mat->valptr_d != NULL)
+        return (double)mat->valptr_d[k];
+    return (double)mat->valptr_i[k];
+}
+
+static void SRB_sym_free(struct rb_transpose *t){
+    free(t->ptr);
+    free(t->ind);
+    free(t->val);
+}
+
+// each thread counts the rows of its column range, the counts are turned
+// into per-thread offsets so the scatter keeps columns in order
+static int SRB_sym_transpose(const rb_matrix_info_t *mat, struct rb_transpose *t){
+    SRB_INT n = mat->rows;
+    int values = mat->valptr_d != NULL || mat->valptr_i != NULL;
+    int nthreads = 1;
+    SRB_INT *cnt;
+
+#ifdef _OPENMP
+    // keep the count arrays within a fraction of the matrix
+    nthreads = omp_get_max_threads();
+    if ((double)nthreads * n > mat->nnz / 4.0 + n){
+        int cap = 1 + (int)(mat->nnz / (4.0 * n + 1));
+        if (cap < nthreads) nthreads = cap;
+    }
+#endif
+
+    memset(t, 0, sizeof(struct rb_transpose));
+    t->ptr = (SRB_INT*)malloc((n + 1) * sizeof(SRB_INT));
+    t->ind = (SRB_INT*)malloc((mat->nnz > 0 ? mat->nnz : 1) * sizeof(SRB_INT));
+    if (values)
+        t->val = (double*)malloc((mat->nnz > 0 ? mat->nnz : 1) * sizeof(double));
+    cnt = (SRB_INT*)calloc((size_t)nthreads * n + 1, sizeof(SRB_INT));
+    if (t->ptr == NULL || t->ind == NULL || (values && t->val == NULL) || cnt == NULL){
+        free(cnt);
+        SRB_sym_free(t);
+        return -1;
+    }
+
+#ifdef _OPENMP
+#pragma omp parallel num_threads(nthreads)
+#endif
+    {
+        int tid = 0, nt = 1;
+#ifdef _OPENMP
+        tid = omp_get_thread_num();
+        nt = omp_get_num_threads();
+#endif
+        SRB_INT *c = cnt + (size_t)tid * n;
+        SRB_INT j0 = (SRB_INT)((long long)mat->cols * tid / nt);
+        SRB_INT j1 = (SRB_INT)((long long)mat->cols * (tid + 1) / nt);
+
+        for (SRB_INT k = mat->colptr[j0] - 1; k < mat->colptr[j1] - 1; ++k)
+            ++c[mat->rowind[k] - 1];
+
+#ifdef _OPENMP
+#pragma omp barrier
+#pragma omp single
+#endif
+        {
+            SRB_INT pos = 0;
+            for (SRB_INT i = 0; i < n; ++i){
+                t->ptr[i] = pos;
+                for (int q = 0; q < nt; ++q){
+                    SRB_INT tmp = cnt[(size_t)q * n + i];
+                    cnt[(size_t)q * n + i] = pos;
+                    pos += tmp;
+                }
+            }
+            t->ptr[n] = pos;
+        }
+
+        for (SRB_INT j = j0; j < j1; ++j){
+            for (SRB_INT k = mat->colptr[j] - 1; k < mat->colptr[j + 1] - 1; ++k){
+                SRB_INT d = c[mat->rowind[k] - 1]++;
+                t->ind[d] = j;
+                if (values) t->val[d] = SRB_sym_value(mat, k);
+            }
+        }
+    }
+
+    free(cnt);
+    return 0;
+}
+
+static SRB_INT SRB_sym_find(const SRB_INT *ind, SRB_INT lo, SRB_INT hi, SRB_INT key){
+    while (lo < hi){
+        SRB_INT mid = lo + (hi - lo) / 2;
+        if (ind[mid] < key) lo = mid + 1;
+        else hi = mid;
+    }
+    return lo;
+}
+
+// column j of A must match column j of A^T (row j of A); the transpose is
+// sorted, so A may keep its rows in any order
+char SRB_symmetry(const rb_matrix_info_t *mat){
+    struct rb_transpose t;
+    int sym = 1, skew = 1;
+
+    if (mat->rows != mat->cols || mat->colptr == NULL || mat->rowind == NULL)
+        return 'u';
+    if (SRB_sym_transpose(mat, &t) != 0)
+        return 'u';
+    if (t.val == NULL)
+        skew = 0;
+
+#ifdef _OPENMP
+#pragma omp parallel for schedule(dynamic, 256) reduction(&&:sym, skew)
+#endif
+    for (SRB_INT j = 0; j < mat->cols; ++j){
+        SRB_INT lo = t.ptr[j], hi = t.ptr[j + 1];
+        if (!sym && !skew)
+            continue;
+        if (hi - lo != mat->colptr[j + 1] - mat->colptr[j]){
+            sym = skew = 0;
+            continue;
+        }
+        for (SRB_INT k = mat->colptr[j] - 1; k < mat->colptr[j + 1] - 1; ++k){
+            SRB_INT i = mat->rowind[k] - 1;
+            SRB_INT q = SRB_sym_find(t.ind, lo, hi, i);
+            if (q == hi || t.ind[q] != i){
+                sym = skew = 0;
+                break;
+            }
+            if (t.val != NULL){
+                double a = SRB_sym_value(mat, k);
+                if (a != t.val[q]) sym = 0;
+                if (a != -t.val[q]) skew = 0;
+            }
+        }
+    }
+
+    SRB_sym_free(&t);
+#ifndef NDEBUG
+    printf("SRB_symmetry: symmetric %d, skew %d\n", sym, skew);
+#endif
+    return sym ? 's' : (skew ? 'z' : 'u');
+}
@@ -0,0 +1,293 @@
+/*
+ * ===========================================================================
+ *
+ *       Filename:  SRB_tar.c
+ *
+ *    Description:  read RB members of .tar/.tar.gz/.tar.bz2 archives
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 07:48:26 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Haoyang Liu (), liuhaoyang@pku.edu.cn
+ *   Organization:  BICMR, Peking University
+ *      Copyright:  Copyright (c) 2021, Haoyang Liu
+ *
+ * ===========================================================================
+ */
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+#include "SRBio.h"
+#include "private/source.h"
+#include "private/read.h"
+
+#define SRBIO_TAR_BLOCK 512
+#define SRBIO_TAR_NAME_MAX 4096
+
+// the archive is a byte stream through the decoder, members are consumed
+// in order and never written anywhere
+struct rb_tar {
+    FILE *fp;
+    rb_decoder_t dec;
+    char name[SRBIO_TAR_NAME_MAX];
+    char longname[SRBIO_TAR_NAME_MAX];  // from a GNU 'L' or pax 'x' entry
+    size_t size;
+    size_t remaining;   // unread bytes of the current member
+    size_t pad;         // zeros up to the next header
+    int eof;
+};
+
+static long SRB_tar_fread(void *buff, size_t size, void *p){
+    size_t n = fread(buff, 1, size, (FILE*)p);
+    if (n == 0 && ferror((FILE*)p))
+        return -1;
+    return (long)n;
+}
+
+// read exactly `size` bytes, 0 on success
+static int SRB_tar_fill(rb_tar_t *tar, char *buff, size_t size){
+    while (size > 0){
+        long n = SRB_decoder_read(buff, size, &tar->dec);
+        if (n <= 0)
+            return -1;
+        buff += n;
+        size -= n;
+    }
+    return 0;
+}
+
+// drop `size` bytes, plain archives are seeked over
+static int SRB_tar_skip(rb_tar_t *tar, size_t size){
+    char buff[16 * SRBIO_TAR_BLOCK];
+
+    if (size == 0)
+        return 0;
+    if (tar->dec.codec == 'n' && fseeko(tar->fp, (off_t)size, SEEK_CUR) == 0)
+        return 0;
+    while (size > 0){
+        size_t n = size < sizeof(buff) ? size : sizeof(buff);
+        if (SRB_tar_fill(tar, buff, n) != 0)
+            return -1;
+        size -= n;
+    }
+    return 0;
+}
+
+// octal field, or base-256 as written by GNU tar for large members
+static size_t SRB_tar_number(const char *field, int len){
+    size_t v = 0;
+    if ((unsigned char)field[0] & 0x80){
+        v = (unsigned char)field[0] & 0x7f;
+        for (int i = 1; i < len; ++i)
+            v = (v << 8) | (unsigned char)field[i];
+        return v;
+    }
+    for (int i = 0; i < len && field[i] != '\0'; ++i){
+        if (field[i] >= '0' && field[i] <= '7')
+            v = v * 8 + (field[i] - '0');
+    }
+    return v;
+}
+
+static int SRB_tar_checksum(const unsigned char *h){
+    size_t sum = 0;
+    for (int i = 0; i < SRBIO_TAR_BLOCK; ++i)
+        sum += (i >= 148 && i < 156) ? ' ' : h[i];
+    return sum == SRB_tar_number((const char*)h + 148, 8);
+}
+
+// take `path=` out of the records of a pax extended header, -31 if a
+// record does not fit its length or the header
+static int SRB_tar_pax(rb_tar_t *tar, char *data, size_t len){
+    size_t pos = 0;
+    while (pos < len){
+        char *end;
+        if (data[pos] < '0' || data[pos] > '9')
+            return -31;
+        size_t rlen = strtoul(data + pos, &end, 10);
+        size_t prefix = end + 1 - (data + pos);    // "<len> "
+        if (*end != ' ' || rlen <= prefix || rlen > len - pos)
+            return -31;
+        char *key = end + 1;
+        char *rec_end = data + pos + rlen - 1;  // the trailing '\n'
+        if (rec_end - key >= 5 && strncmp(key, "path=", 5) == 0){
+            size_t n = rec_end - (key + 5);
+            if (n >= SRBIO_TAR_NAME_MAX) n = SRBIO_TAR_NAME_MAX - 1;
+            memcpy(tar->longname, key + 5, n);
+            tar->longname[n] = '\0';
+        }
+        pos += rlen;
+    }
+    return 0;
+}
+
+rb_tar_t *SRB_tar_open(const char *filename, rb_file_compress_t flag){
+    rb_tar_t *tar = (rb_tar_t*)calloc(1, sizeof(rb_tar_t));
+    if (tar == NULL)
+        return NULL;
+
+    tar->fp = fopen(filename, "rb");
+    if (tar->fp == NULL){
+        fprintf(stderr, "Failed to open file: %s.\n", filename);
+        free(tar);
+        return NULL;
+    }
+    if (SRB_decoder_init(&tar->dec, SRB_tar_fread, tar->fp, flag) != 0){
+        fclose(tar->fp);
+        free(tar);
+        return NULL;
+    }
+    return tar;
+}
+
+void SRB_tar_close(rb_tar_t *tar){
+    SRB_decoder_free(&tar->dec);
+    fclose(tar->fp);
+    free(tar);
+}
+
+// returns 1 with the name and size of the next regular member, 0 at the
+// end of the archive, -1 if it is damaged, -31 for a malformed pax header
+int SRB_tar_next(rb_tar_t *tar, const char **name, size_t *size){
+    unsigned char h[SRBIO_TAR_BLOCK];
+
+    if (tar->eof)
+        return 0;
+    if (SRB_tar_skip(tar, tar->remaining + tar->pad) != 0)
+        return -1;
+    tar->remaining = tar->pad = 0;
+
+    for (;;){
+        if (SRB_tar_fill(tar, (char*)h, SRBIO_TAR_BLOCK) != 0){
+            // archives cut after the last member are accepted
+            tar->eof = 1;
+            return 0;
+        }
+
+        int zero = 1;
+        for (int i = 0; i < SRBIO_TAR_BLOCK && zero; ++i) zero = h[i] == 0;
+        if (zero){
+            tar->eof = 1;
+            return 0;
+        }
+        if (!SRB_tar_checksum(h)){
+            fprintf(stderr, "SRB_tar_next: header checksum mismatch.\n");
+            return -1;
+        }
+
+        size_t len = SRB_tar_number((const char*)h + 124, 12);
+        size_t pad = (SRBIO_TAR_BLOCK - len % SRBIO_TAR_BLOCK) % SRBIO_TAR_BLOCK;
+        char type = (char)h[156];
+
+        if (type == 'L' || type == 'x'){
+            // the name of the next member is carried in the data
+            char *data = (char*)malloc(len + 1);
+            if (data == NULL || SRB_tar_fill(tar, data, len) != 0 || SRB_tar_skip(tar, pad) != 0){
+                free(data);
+                return -1;
+            }
+            data[len] = '\0';
+            int ret = 0;
+            if (type == 'L')
+                snprintf(tar->longname, SRBIO_TAR_NAME_MAX, "%s", data);
+            else
+                ret = SRB_tar_pax(tar, data, len);
+            free(data);
+            if (ret != 0){
+                fprintf(stderr, "SRB_tar_next: malformed pax header.\n");
+                return ret;
+            }
+            continue;
+        }
+
+        if (type != '0' && type != '\0' && type != '7'){
+            // directories, links, global pax headers, ...
+            if (SRB_tar_skip(tar, len + pad) != 0)
+                return -1;
+            tar->longname[0] = '\0';
+            continue;
+        }
+
+        if (tar->longname[0] != '\0'){
+            snprintf(tar->name, SRBIO_TAR_NAME_MAX, "%s", tar->longname);
+            tar->longname[0] = '\0';
+        } else if (memcmp(h + 257, "ustar", 5) == 0 && h[345] != '\0'){
+            snprintf(tar->name, SRBIO_TAR_NAME_MAX, "%.155s/%.100s", h + 345, h);
+        } else {
+            snprintf(tar->name, SRBIO_TAR_NAME_MAX, "%.100s", h);
+        }
+
+        tar->size = tar->remaining = len;
+        tar->pad = pad;
+        if (name != NULL) *name = tar->name;
+        if (size != NULL) *size = len;
+        return 1;
+    }
+}
+
+// bytes of the current member only
+static long SRB_tar_member_read(void *buff, size_t size, void *p){
+    rb_tar_t *tar = (rb_tar_t*)p;
+    if (size > tar->remaining)
+        size = tar->remaining;
+    if (size == 0)
+        return 0;
+    long n = SRB_decoder_read(buff, size, &tar->dec);
+    if (n <= 0)
+        return -1;
+    tar->remaining -= n;
+    return n;
+}
+
+// parse the current member, whatever the parser leaves is skipped by the
+// next SRB_tar_next
+int SRB_tar_read(rb_tar_t *tar, rb_matrix_info_t *mat, const rb_read_opts_t *opts){
+    rb_source_t src;
+    int ret;
+
+    if (SRB_source_init(&src, SRB_tar_member_read, tar, 0) != 0)
+        return -1;
+    ret = SRB_read_stream(&src, mat, SRB_source_gets, opts, NULL);
+    SRB_source_free(&src);
+    return ret;
+}
+
+// load `member` (full path or file name), or the first .rb member if NULL
+int SRB_read_tar(const char *filename, rb_file_compress_t flag, const char *member,
+        rb_matrix_info_t *mat){
+    const char *name;
+    rb_tar_t *tar;
+    int ret;
+
+    tar = SRB_tar_open(filename, flag);
+    if (tar == NULL)
+        return -100;
+
+    while ((ret = SRB_tar_next(tar, &name, NULL)) == 1){
+        const char *base = strrchr(name, '/');
+        base = base != NULL ? base + 1 : name;
+        size_t len = strlen(name);
+
+        if (member == NULL ? (len > 3 && strcmp(name + len - 3, ".rb") == 0)
+                : (strcmp(name, member) == 0 || strcmp(base, member) == 0)){
+            ret = SRB_tar_read(tar, mat, NULL);
+            SRB_tar_close(tar);
+            return ret;
+        }
+    }
+
+    SRB_tar_close(tar);
+    if (ret == 0){
+        fprintf(stderr, "SRB_read_tar: no member %s in %s.\n",
+                member != NULL ? member : "*.rb", filename);
+        return -100;
+    }
+    return ret;
+}
@@ -62,6 +62,21 @@ void SRB_destroy(rb_matrix_info_t *mat){
     }
 }
 
+void SRB_buffer_init(rb_buffer_t *buf){
+    buf->data = NULL;
+    buf->size = 0;
+    buf->capacity = 0;
+}
+
+void SRB_buffer_free(rb_buffer_t *buf){
+    if (buf->data != NULL){
+        free(buf->data);
+        buf->data = NULL;
+    }
+    buf->size = 0;
+    buf->capacity = 0;
+}
+
 void SRB_print(const rb_matrix_info_t *mat){
     switch (mat->ftype){
         case 'a':
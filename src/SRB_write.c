@@ -21,10 +21,18 @@
 #include <string.h>
 
 #include "SRBio.h"
-#include "private/wrap.h"
-
-int SRB_write_csc_impl(void*, const rb_matrix_info_t*, int, SRB_puts_f);
-int SRB_write_impl(const char *, const rb_matrix_info_t*, int, SRB_open_f, SRB_close_f, SRB_puts_f);
+#include "private/sink.h"
+#include "private/write.h"
+#include "private/fingerprint.h"
+#include "private/context.h"
+#include "private/kernels.h"
+
+int SRB_write_csc_impl(rb_sink_t*, const rb_matrix_info_t*, int, const SRB_INT*, SRB_INT,
+        uint64_t*);
+int SRB_write_impl(const char *, const char *, const rb_matrix_info_t*, int,
+        rb_file_compress_t, const rb_write_opts_t*, rb_context_t*);
+int SRB_write_shards(const char *, const rb_matrix_info_t*, int, rb_file_compress_t,
+        const rb_write_opts_t*, rb_context_t*);
 
 int SRB_write(const char *filename, const rb_matrix_info_t *mat, rb_file_compress_t flag){
     return SRB_write_p(filename, mat, -1, flag);
@@ -32,29 +40,86 @@ int SRB_write(const char *filename, const rb_matrix_info_t *mat, rb_file_compres
 
 int SRB_write_p(const char *filename, const rb_matrix_info_t *mat,
         int precision, rb_file_compress_t flag){
-    SRB_puts_f rb_puts;
-    SRB_close_f rb_close;
-    SRB_open_f rb_open;
-    switch (flag) {
+    return SRB_write_ex(filename, mat, precision, flag, NULL);
+}
+
+int SRB_write_ex(const char *filename, const rb_matrix_info_t *mat,
+        int precision, rb_file_compress_t flag, const rb_write_opts_t *opts){
+    precision = SRB_write_precision(precision, flag);
+    if (precision < 0)
+        return -999;
+
+    if (flag & SRB_SHARDS_MASK)
+        return SRB_write_shards(filename, mat, precision, flag, opts, NULL);
+    return SRB_write_impl(filename, (flag & SRB_IO_DIRECT) ? "wd" : "w",
+            mat, precision, flag, opts, NULL);
+}
+
+// as SRB_write_ex with the buffers and deflate state of the context, whose
+// workers write the shards of SRB_WRITE_SHARDS; opts NULL: its defaults
+int SRB_write_ctx(rb_context_t *ctx, const char *filename, const rb_matrix_info_t *mat,
+        int precision, rb_file_compress_t flag, const rb_write_opts_t *opts){
+    if (opts == NULL)
+        opts = &ctx->write_opts;
+    precision = SRB_write_precision(precision, flag);
+    if (precision < 0)
+        return -999;
+
+    if (flag & SRB_SHARDS_MASK)
+        return SRB_write_shards(filename, mat, precision, flag, opts, ctx);
+    return SRB_write_impl(filename, (flag & SRB_IO_DIRECT) ? "wd" : "w",
+            mat, precision, flag, opts, ctx);
+}
+
+static int SRB_buffer_write(const void *data, size_t len, void *p){
+    rb_buffer_t *buf = (rb_buffer_t*)p;
+    if (buf->capacity - buf->size < len){
+        size_t cap = buf->capacity > 0 ? buf->capacity : SRBIO_LINE_MAX;
+        while (cap - buf->size < len)
+            cap *= 2;
+        char *data_new = (char*)realloc(buf->data, cap);
+        if (data_new == NULL)
+            return -1;
+        buf->data = data_new;
+        buf->capacity = cap;
+    }
+    memcpy(buf->data + buf->size, data, len);
+    buf->size += len;
+    return 0;
+}
+
+// the encoded matrix is appended to buf
+int SRB_write_mem(rb_buffer_t *buf, const rb_matrix_info_t *mat,
+        int precision, rb_file_compress_t flag, const rb_write_opts_t *opts){
+    rb_sink_t sink;
+    int ret;
+
+    precision = SRB_write_precision(precision, flag);
+    if (precision < 0)
+        return -999;
+
+    ret = SRB_sink_init(&sink, SRB_buffer_write, NULL, buf, flag, opts);
+    if (ret != 0)
+        return ret;
+
+    ret = SRB_write_sink(&sink, mat, precision, flag, opts);
+    if (SRB_sink_close(&sink) != 0 && ret == 0)
+        ret = -101;
+    return ret;
+}
+
+// check the compress flag and resolve the precision, -1 if the flag is
+// not supported
+int SRB_write_precision(int precision, rb_file_compress_t flag){
+    switch (flag & SRB_COMPRESS_MASK) {
         case SRB_COMPRESS_NONE:
-            rb_open = SRB_fopen;
-            rb_close = SRB_fclose;
-            rb_puts = SRB_fputs;
-            break;
 #ifdef SRBIO_USE_ZLIB
         case SRB_COMPRESS_GZIP:
-            rb_open = SRB_gzopen;
-            rb_close = SRB_gzclose;
-            rb_puts = SRB_gzputs;
-            break;
 #endif
 #ifdef SRBIO_USE_BZIP2
         case SRB_COMPRESS_BZIP2:
-            rb_open = SRB_bz2open;
-            rb_close = SRB_bz2close;
-            rb_puts = SRB_bz2puts;
-            break;
 #endif
+            break;
         default:
             return -999;
     }
@@ -73,45 +138,109 @@ int SRB_write_p(const char *filename, const rb_matrix_info_t *mat,
     printf("Compress mode: %d | Precision: %d\n", flag, precision);
 #endif
 
-    return SRB_write_impl(filename, mat, precision, rb_open, rb_close, rb_puts);
+    return precision;
 }
 
-int SRB_write_impl(const char *filename, const rb_matrix_info_t *mat, int precision,
-        SRB_open_f rb_open, SRB_close_f rb_close, SRB_puts_f rb_puts){
-    void *fp;
-    char buffer[SRBIO_LINE_MAX + 2];
+int SRB_write_impl(const char *filename, const char *mode,
+        const rb_matrix_info_t *mat, int precision,
+        rb_file_compress_t flag, const rb_write_opts_t *opts, rb_context_t *ctx){
+    rb_sink_t sink;
     int ret;
 
-    fp = rb_open(filename, "w");
-    if (fp == NULL){
+    ret = SRB_sink_open_ctx(&sink, filename, mode, flag, opts, ctx);
+    if (ret != 0){
         fprintf(stderr, "Failed to open file: %s.\n", filename);
-        return -100;
+        return ret;
     }
 
 #ifndef NDEBUG
     printf("Writing to %s\n", filename);
 #endif
 
+    ret = SRB_write_sink(&sink, mat, precision, flag, opts);
+
+    if (SRB_sink_close(&sink) != 0 && ret == 0){
+        fprintf(stderr, "SRB_write: failed to write file: %s.\n", filename);
+        ret = -101;
+    }
+    return ret;
+}
+
+// column pointers of the lower triangle, entries are only filtered while
+// the cards are written
+static SRB_INT *SRB_write_lower(const rb_matrix_info_t *mat){
+    SRB_INT *lower = (SRB_INT*)malloc((mat->cols + 1) * sizeof(SRB_INT));
+    if (lower == NULL)
+        return NULL;
+    lower[0] = 1;
+    for (SRB_INT j = 0; j < mat->cols; ++j){
+        SRB_INT cnt = 0;
+        for (SRB_INT k = mat->colptr[j] - 1; k < mat->colptr[j + 1] - 1; ++k)
+            cnt += mat->rowind[k] > j;
+        lower[j + 1] = lower[j] + cnt;
+    }
+    return lower;
+}
+
+// next kept entry from k on, `col` follows the column of k
+static inline SRB_INT SRB_write_next(const rb_matrix_info_t *mat, SRB_INT k, SRB_INT *col){
+    for (;; ++k){
+        while (k >= mat->colptr[*col + 1] - 1) ++*col;
+        if (mat->rowind[k] > *col)
+            return k;
+    }
+}
+
+int SRB_write_sink(rb_sink_t *sink, const rb_matrix_info_t *mat, int precision,
+        rb_file_compress_t flag, const rb_write_opts_t *opts){
+    char buffer[SRBIO_LINE_MAX + 2];
+    rb_matrix_info_t view;
+    SRB_INT *lower = NULL;
+    SRB_INT shift = (flag & SRB_WRITE_ZERO_BASED) ? 1 : 0;
+    int ret;
+
+    if ((flag & SRB_WRITE_SYMMETRY) && shift){
+        fprintf(stderr, "SRB_write: SRB_WRITE_SYMMETRY needs indices from 1.\n");
+        return -999;
+    }
+
+    // write the lower triangle of a symmetric matrix under its new stype
+    if ((flag & SRB_WRITE_SYMMETRY) && mat->ftype == 'a' && mat->stype == 'u'){
+        char stype = SRB_symmetry(mat);
+        if (stype != 'u'){
+            lower = SRB_write_lower(mat);
+            if (lower == NULL)
+                return -1;
+            view = *mat;
+            view.stype = stype;
+            view.nnz = lower[mat->cols] - 1;
+            mat = &view;
+        }
+    }
+
     // line 1: title and id
     snprintf(buffer, SRBIO_LINE_MAX + 2, "%-72s%-8s\n", mat->descr, mat->key);
-    rb_puts(buffer, fp);
+    SRB_sink_puts(sink, buffer);
 
 #ifndef NDEBUG
     printf("Writing title and id\n");
 #endif
 
     // line 2-end:
-    ret = -999;
     if (mat->ftype == 'a') // csc format
-        ret = SRB_write_csc_impl(fp, mat, precision, rb_puts);
+        ret = SRB_write_csc_impl(sink, mat, precision, lower, shift,
+                opts != NULL ? opts->fingerprint : NULL);
     else if (mat->ftype == 'e') // elemental format
         ret = -999;
-
-    rb_close(fp);
+    else
+        ret = -999;
+    free(lower);
     return ret;
 }
 
-int SRB_write_csc_impl(void *fp, const rb_matrix_info_t *mat, int precision, SRB_puts_f rb_puts){
+// lines 2-4, the layout of the blocks is returned for the data cards
+int SRB_write_csc_header(rb_sink_t *sink, const rb_matrix_info_t *mat, int precision,
+        rb_layout_t *l){
     SRB_INT totcrd, ptrcrd, indcrd, valcrd;
     int ptr_w, ptr_n, ind_w, ind_n, val_w, val_n;
     char buffer[SRBIO_LINE_MAX + 2];
@@ -165,7 +294,7 @@ int SRB_write_csc_impl(void *fp, const rb_matrix_info_t *mat, int precision, SRB
     // line 2: line info
     snprintf(buffer, SRBIO_LINE_MAX + 2, "%14ld %13ld %13ld %13ld\n",
             (long)totcrd, (long)ptrcrd, (long)indcrd, (long)valcrd);
-    rb_puts(buffer, fp);
+    SRB_sink_puts(sink, buffer);
 
 #ifndef NDEBUG
     printf("Writing line info\n");
@@ -175,7 +304,7 @@ int SRB_write_csc_impl(void *fp, const rb_matrix_info_t *mat, int precision, SRB
     snprintf(buffer, SRBIO_LINE_MAX + 2, "%c%c%c            %13ld %13ld %13ld %13ld\n",
             mat->mtype, mat->stype, mat->ftype,
             (long)mat->rows, (long)mat->cols, (long)mat->nnz, 0L);
-    rb_puts(buffer, fp);
+    SRB_sink_puts(sink, buffer);
 
 #ifndef NDEBUG
     printf("Writing matrix info: rows = %ld, cols = %ld, nnz = %ld\n",
@@ -196,21 +325,69 @@ int SRB_write_csc_impl(void *fp, const rb_matrix_info_t *mat, int precision, SRB
             break;
     }
     snprintf(buffer, SRBIO_LINE_MAX + 2, "%-16s%-16s%-20s\n", ptrfmt, indfmt, valfmt);
-    rb_puts(buffer, fp);
+    SRB_sink_puts(sink, buffer);
 
 #ifndef NDEBUG
     printf("Writing FORTRAN format info\n");
 #endif
 
+    l->ptrcrd = ptrcrd;
+    l->indcrd = indcrd;
+    l->valcrd = valcrd;
+    l->ptr_w = ptr_w;
+    l->ptr_n = ptr_n;
+    l->ind_w = ind_w;
+    l->ind_n = ind_n;
+    l->val_w = val_w;
+    l->val_n = val_n;
+    l->precision = precision;
+    return 0;
+}
+
+// with `lower`, mat->nnz counts the kept entries only and colptr is
+// replaced by `lower`; `shift` is added to the indices in the file; the
+// fingerprint, if any, hashes the numbers as printed
+int SRB_write_csc_impl(rb_sink_t *sink, const rb_matrix_info_t *mat, int precision,
+        const SRB_INT *lower, SRB_INT shift, uint64_t *fingerprint){
+    const SRB_INT *colptr = lower != NULL ? lower : mat->colptr;
+    SRB_INT k, col;
+    SRB_INT ptrcrd, indcrd, valcrd;
+    int ptr_w, ptr_n, ind_w, ind_n, val_w, val_n;
+    rb_fingerprint_t fp, *hash = NULL;
+    int64_t card[SRBIO_CARD_NUMS];
+    rb_layout_t l;
+    int ret;
+
+    if (fingerprint != NULL){
+        SRB_fp_init(&fp);
+        hash = &fp;
+    }
+
+    ret = SRB_write_csc_header(sink, mat, precision, &l);
+    if (ret != 0)
+        return ret;
+    ptrcrd = l.ptrcrd;
+    indcrd = l.indcrd;
+    valcrd = l.valcrd;
+    ptr_w = l.ptr_w;
+    ptr_n = l.ptr_n;
+    ind_w = l.ind_w;
+    ind_n = l.ind_n;
+    val_w = l.val_w;
+    val_n = l.val_n;
+
     // data block: ptr
     SRB_INT n = 0;
     for (SRB_INT i = 0; i < ptrcrd; ++i){
-        int ipos = 0;
-        for (int j = 0; j < ptr_n && n < mat->cols + 1; ++j, ++n){
-            ipos += snprintf(buffer + ipos, SRBIO_LINE_MAX + 2 - ipos, "%*ld", ptr_w, (long)mat->colptr[n]);
+        char *line = SRB_sink_reserve(sink, SRBIO_FORMAT_MAX(ptr_n));
+        int j;
+        for (j = 0; j < ptr_n && n < mat->cols + 1; ++j, ++n){
+            card[j] = colptr[n] + shift;
+            if (hash != NULL) SRB_fp_int(hash, colptr[n] + shift);
         }
-        snprintf(buffer + ipos, 2, "\n");
-        rb_puts(buffer, fp);
+        int ipos = SRB_kernels->format_ints(line, card, j, ptr_w);
+        line[ipos++] = '\n';
+        SRB_sink_commit(sink, ipos);
     }
 
 #ifndef NDEBUG
@@ -219,13 +396,18 @@ int SRB_write_csc_impl(void *fp, const rb_matrix_info_t *mat, int precision, SRB
 
     // data block: ind
     n = 0;
+    k = col = 0;
     for (SRB_INT i = 0; i < indcrd; ++i){
-        int ipos = 0;
-        for (int j = 0; j < ind_n && n < mat->nnz; ++j, ++n){
-            ipos += snprintf(buffer + ipos, SRBIO_LINE_MAX + 2 - ipos, "%*ld", ind_w, (long)mat->rowind[n]);
+        char *line = SRB_sink_reserve(sink, SRBIO_FORMAT_MAX(ind_n));
+        int j;
+        for (j = 0; j < ind_n && n < mat->nnz; ++j, ++n, ++k){
+            if (lower != NULL) k = SRB_write_next(mat, k, &col);
+            card[j] = mat->rowind[k] + shift;
+            if (hash != NULL) SRB_fp_int(hash, mat->rowind[k] + shift);
         }
-        snprintf(buffer + ipos, 2, "\n");
-        rb_puts(buffer, fp);
+        int ipos = SRB_kernels->format_ints(line, card, j, ind_w);
+        line[ipos++] = '\n';
+        SRB_sink_commit(sink, ipos);
     }
     
 #ifndef NDEBUG
@@ -236,26 +418,36 @@ int SRB_write_csc_impl(void *fp, const rb_matrix_info_t *mat, int precision, SRB
     switch (mat->mtype){
         case 'r':
             n = 0;
+            k = col = 0;
             for (SRB_INT i = 0; i < valcrd; ++i){
+                char *line = SRB_sink_reserve(sink, SRBIO_LINE_MAX + 2);
                 int ipos = 0;
-                for (int j = 0; j < val_n && n < mat->nnz; ++j, ++n){
-                    ipos += snprintf(buffer + ipos, SRBIO_LINE_MAX + 2 - ipos, 
-                            "%*.*e", val_w, precision, mat->valptr_d[n]);
+                for (int j = 0; j < val_n && n < mat->nnz; ++j, ++n, ++k){
+                    if (lower != NULL) k = SRB_write_next(mat, k, &col);
+                    int len = snprintf(line + ipos, SRBIO_LINE_MAX + 2 - ipos,
+                            "%*.*e", val_w, precision, mat->valptr_d[k]);
+                    // the value a reader will get back
+                    if (hash != NULL) SRB_fp_real(hash, strtod(line + ipos, NULL));
+                    ipos += len;
                 }
-                snprintf(buffer + ipos, 2, "\n");
-                rb_puts(buffer, fp);
+                line[ipos++] = '\n';
+                SRB_sink_commit(sink, ipos);
             }
             break;
         case 'i':
             n = 0;
+            k = col = 0;
             for (SRB_INT i = 0; i < valcrd; ++i){
-                int ipos = 0;
-                for (int j = 0; j < val_n && n < mat->nnz; ++j, ++n){
-                    ipos += snprintf(buffer + ipos, SRBIO_LINE_MAX + 2 - ipos, 
-                            "%*ld", val_w, (long)mat->valptr_i[n]);
+                char *line = SRB_sink_reserve(sink, SRBIO_FORMAT_MAX(val_n));
+                int j;
+                for (j = 0; j < val_n && n < mat->nnz; ++j, ++n, ++k){
+                    if (lower != NULL) k = SRB_write_next(mat, k, &col);
+                    card[j] = mat->valptr_i[k];
+                    if (hash != NULL) SRB_fp_int(hash, mat->valptr_i[k]);
                 }
-                snprintf(buffer + ipos, 2, "\n");
-                rb_puts(buffer, fp);
+                int ipos = SRB_kernels->format_ints(line, card, j, val_w);
+                line[ipos++] = '\n';
+                SRB_sink_commit(sink, ipos);
             }
             break;
         case 'c':
@@ -272,5 +464,6 @@ int SRB_write_csc_impl(void *fp, const rb_matrix_info_t *mat, int precision, SRB
     printf("Writing data block: valptr\n");
 #endif
 
+    if (hash != NULL) SRB_fp_finish(hash, mat, fingerprint);
     return 0;
 }
@@ -0,0 +1,188 @@
+/*
+ * ===========================================================================
+ *
+ *       Filename:  context.c
+ *
+ *    Description:  worker pool and scratch state kept across calls
+ *
+ *        Version:  1.0
+ *        Created:  10/20/2026 03:31:05 AM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Haoyang Liu (), liuhaoyang@pku.edu.cn
+ *   Organization:  BICMR, Peking University
+ *      Copyright:  Copyright (c) 2021, Haoyang Liu
+ *
+ * ===========================================================================
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "SRBio.h"
+#include "private/context.h"
+
+static void *SRB_pool_worker(void *p){
+    rb_pool_t *pool = (rb_pool_t*)p;
+
+    pthread_mutex_lock(&pool->lock);
+    for (;;){
+        while (pool->head == NULL && !pool->stop)
+            pthread_cond_wait(&pool->work, &pool->lock);
+        if (pool->stop)
+            break;
+
+        rb_pool_job_t *job = pool->head;
+        if (--job->pending == 0){
+            pool->head = job->next;
+            if (pool->head == NULL)
+                pool->tail = NULL;
+        }
+        ++job->running;
+        pthread_mutex_unlock(&pool->lock);
+
+        job->fn(job->arg);
+
+        pthread_mutex_lock(&pool->lock);
+        --job->running;
+        pthread_cond_broadcast(&pool->done);
+    }
+    pthread_mutex_unlock(&pool->lock);
+    return NULL;
+}
+
+int SRB_pool_init(rb_pool_t *pool, int nthreads){
+    memset(pool, 0, sizeof(rb_pool_t));
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work, NULL);
+    pthread_cond_init(&pool->done, NULL);
+    if (nthreads <= 0)
+        return 0;
+
+    pool->threads = (pthread_t*)malloc(nthreads * sizeof(pthread_t));
+    if (pool->threads == NULL)
+        return -1;
+    for (; pool->nthreads < nthreads; ++pool->nthreads){
+        if (pthread_create(pool->threads + pool->nthreads, NULL, SRB_pool_worker, pool) != 0)
+            break;
+    }
+    return 0;
+}
+
+void SRB_pool_free(rb_pool_t *pool){
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = 1;
+    pthread_cond_broadcast(&pool->work);
+    pthread_mutex_unlock(&pool->lock);
+    for (int t = 0; t < pool->nthreads; ++t)
+        pthread_join(pool->threads[t], NULL);
+    free(pool->threads);
+    pthread_mutex_destroy(&pool->lock);
+    pthread_cond_destroy(&pool->work);
+    pthread_cond_destroy(&pool->done);
+    pool->threads = NULL;
+    pool->nthreads = 0;
+}
+
+// queue `fn(arg)` for n workers (at most all of them), returns at once
+void SRB_pool_submit(rb_pool_t *pool, rb_pool_job_t *job, void *(*fn)(void*),
+        void *arg, int n){
+    job->fn = fn;
+    job->arg = arg;
+    job->pending = n < pool->nthreads ? n : pool->nthreads;
+    job->running = 0;
+    job->next = NULL;
+    if (job->pending <= 0)
+        return;
+
+    pthread_mutex_lock(&pool->lock);
+    if (pool->tail != NULL)
+        pool->tail->next = job;
+    else
+        pool->head = job;
+    pool->tail = job;
+    pthread_cond_broadcast(&pool->work);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+// runs not started yet are dropped, the others are waited for
+void SRB_pool_wait(rb_pool_t *pool, rb_pool_job_t *job){
+    pthread_mutex_lock(&pool->lock);
+    if (job->pending > 0){
+        rb_pool_job_t **p = &pool->head, *prev = NULL;
+        while (*p != job){
+            prev = *p;
+            p = &(*p)->next;
+        }
+        *p = job->next;
+        if (pool->tail == job)
+            pool->tail = prev;
+        job->pending = 0;
+    }
+    while (job->running > 0)
+        pthread_cond_wait(&pool->done, &pool->lock);
+    pthread_mutex_unlock(&pool->lock);
+}
+
+char *SRB_context_buffer(char **buff, size_t *size, size_t want){
+    if (*buff == NULL || *size < want){
+        char *p = (char*)realloc(*buff, want);
+        if (p == NULL)
+            return NULL;
+        *buff = p;
+        *size = want;
+    }
+    return *buff;
+}
+
+// nthreads counts the caller, <= 0: one per online cpu
+rb_context_t *SRB_context_create(int nthreads){
+    rb_context_t *ctx = (rb_context_t*)calloc(1, sizeof(rb_context_t));
+    if (ctx == NULL)
+        return NULL;
+
+    if (nthreads <= 0){
+        long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+        nthreads = ncpu > 0 ? (int)ncpu : 1;
+    }
+    if (SRB_pool_init(&ctx->pool, nthreads - 1) != 0){
+        SRB_pool_free(&ctx->pool);
+        free(ctx);
+        return NULL;
+    }
+    SRB_read_opts_init(&ctx->read_opts);
+    SRB_write_opts_init(&ctx->write_opts);
+    return ctx;
+}
+
+void SRB_context_destroy(rb_context_t *ctx){
+    if (ctx == NULL)
+        return;
+    SRB_pool_free(&ctx->pool);
+#ifdef SRBIO_USE_ZLIB
+    if (ctx->has_inflate)
+        inflateEnd(&ctx->inflate);
+    if (ctx->has_deflate)
+        deflateEnd(&ctx->deflate);
+#endif
+    free(ctx->ibuf);
+    free(ctx->lbuf);
+    free(ctx->wbuf);
+    free(ctx->obuf);
+    free(ctx);
+}
+
+rb_read_opts_t *SRB_context_read_opts(rb_context_t *ctx){
+    return &ctx->read_opts;
+}
+
+rb_write_opts_t *SRB_context_write_opts(rb_context_t *ctx){
+    return &ctx->write_opts;
+}
+
+int SRB_context_threads(const rb_context_t *ctx){
+    return ctx->pool.nthreads + 1;
+}
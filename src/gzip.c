@@ -0,0 +1,599 @@
+/*
+ * ===========================================================================
+ *
+ *       Filename:  gzip.c
+ *
+ *    Description:  gzip reader with a saved access-point index
+ *
+ *        Version:  1.0
+ *        Created:  10/20/2026 02:48:12 AM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Haoyang Liu (), liuhaoyang@pku.edu.cn
+ *   Organization:  BICMR, Peking University
+ *      Copyright:  Copyright (c) 2021, Haoyang Liu
+ *
+ * ===========================================================================
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "SRBio.h"
+#include "private/gzip.h"
+
+#ifdef SRBIO_USE_ZLIB
+
+static const char SRB_gz_magic[8] = {'S', 'R', 'B', 'z', 'i', 'd', 'x', '2'};
+
+static void SRB_gz_index_free(rb_gz_index_t *idx){
+    for (size_t k = 0; k < idx->n; ++k)
+        free(idx->points[k].dict);
+    free(idx->points);
+    idx->points = NULL;
+    idx->n = idx->cap = 0;
+}
+
+static int SRB_gz_index_add(rb_gz_index_t *idx, z_stream *strm, uint64_t in,
+        uint64_t out){
+    if (idx->n == idx->cap){
+        size_t cap = idx->cap > 0 ? 2 * idx->cap : 64;
+        rb_gz_point_t *points = (rb_gz_point_t*)realloc(idx->points,
+                cap * sizeof(rb_gz_point_t));
+        if (points == NULL)
+            return -1;
+        idx->points = points;
+        idx->cap = cap;
+    }
+
+    rb_gz_point_t *p = idx->points + idx->n;
+    uInt len = 0;
+    p->dict = (unsigned char*)malloc(SRBIO_GZ_WINSIZE);
+    if (p->dict == NULL || inflateGetDictionary(strm, p->dict, &len) != Z_OK){
+        free(p->dict);
+        return -1;
+    }
+    p->in = in;
+    p->out = out;
+    p->bits = strm->data_type & 7;
+    p->dict_len = len;
+    ++idx->n;
+    return 0;
+}
+
+static int SRB_gz_index_load(rb_gz_index_t *idx, const char *path){
+    FILE *fp = fopen(path, "rb");
+    char magic[8];
+    uint32_t probe[2];
+    uint64_t n;
+
+    if (fp == NULL)
+        return -1;
+    if (fread(magic, 1, 8, fp) != 8 || memcmp(magic, SRB_gz_magic, 8) != 0 ||
+            fread(probe, sizeof(uint32_t), 2, fp) != 2 || probe[0] != 0x01020304 ||
+            fread(&idx->gz_ino, sizeof(uint64_t), 1, fp) != 1 ||
+            fread(&idx->gz_size, sizeof(uint64_t), 1, fp) != 1 ||
+            fread(&idx->gz_mtime, sizeof(int64_t), 1, fp) != 1 ||
+            fread(&idx->gz_mtime_ns, sizeof(int64_t), 1, fp) != 1 ||
+            fread(&idx->total, sizeof(uint64_t), 1, fp) != 1 ||
+            fread(&n, sizeof(uint64_t), 1, fp) != 1 || n == 0 || n > idx->total){
+        fclose(fp);
+        return -1;
+    }
+
+    idx->points = (rb_gz_point_t*)calloc(n, sizeof(rb_gz_point_t));
+    if (idx->points == NULL){
+        fclose(fp);
+        return -1;
+    }
+    idx->cap = n;
+    for (idx->n = 0; idx->n < n; ++idx->n){
+        rb_gz_point_t *p = idx->points + idx->n;
+        int32_t bits;
+        uint32_t len;
+        if (fread(&p->in, sizeof(uint64_t), 1, fp) != 1 ||
+                fread(&p->out, sizeof(uint64_t), 1, fp) != 1 ||
+                fread(&bits, sizeof(int32_t), 1, fp) != 1 ||
+                fread(&len, sizeof(uint32_t), 1, fp) != 1 ||
+                bits < 0 || bits > 7 || len > SRBIO_GZ_WINSIZE || p->out >= idx->total ||
+                (idx->n == 0 ? p->out != 0 : p->out <= p[-1].out))
+            break;
+        p->bits = bits;
+        p->dict_len = len;
+        p->dict = (unsigned char*)malloc(len > 0 ? len : 1);
+        if (p->dict == NULL || fread(p->dict, 1, len, fp) != len){
+            free(p->dict);
+            break;
+        }
+    }
+    fclose(fp);
+
+    if (idx->n < n){
+        SRB_gz_index_free(idx);
+        return -1;
+    }
+    return 0;
+}
+
+// written under a temporary name and renamed, a failure only costs the index
+static void SRB_gz_index_save(const rb_gz_index_t *idx, const char *path){
+    size_t len = strlen(path) + 32;
+    char *tmp = (char*)malloc(len);
+    uint32_t probe[2] = {0x01020304, 0};
+    uint64_t n = idx->n;
+    FILE *fp;
+    int ok;
+
+    if (tmp == NULL)
+        return;
+    snprintf(tmp, len, "%s.%ld", path, (long)getpid());
+    fp = fopen(tmp, "wb");
+    if (fp == NULL){
+        free(tmp);
+        return;
+    }
+
+    ok = fwrite(SRB_gz_magic, 1, 8, fp) == 8 &&
+        fwrite(probe, sizeof(uint32_t), 2, fp) == 2 &&
+        fwrite(&idx->gz_ino, sizeof(uint64_t), 1, fp) == 1 &&
+        fwrite(&idx->gz_size, sizeof(uint64_t), 1, fp) == 1 &&
+        fwrite(&idx->gz_mtime, sizeof(int64_t), 1, fp) == 1 &&
+        fwrite(&idx->gz_mtime_ns, sizeof(int64_t), 1, fp) == 1 &&
+        fwrite(&idx->total, sizeof(uint64_t), 1, fp) == 1 &&
+        fwrite(&n, sizeof(uint64_t), 1, fp) == 1;
+    for (size_t k = 0; ok && k < idx->n; ++k){
+        const rb_gz_point_t *p = idx->points + k;
+        int32_t bits = p->bits;
+        uint32_t dict_len = p->dict_len;
+        ok = fwrite(&p->in, sizeof(uint64_t), 1, fp) == 1 &&
+            fwrite(&p->out, sizeof(uint64_t), 1, fp) == 1 &&
+            fwrite(&bits, sizeof(int32_t), 1, fp) == 1 &&
+            fwrite(&dict_len, sizeof(uint32_t), 1, fp) == 1 &&
+            fwrite(p->dict, 1, p->dict_len, fp) == p->dict_len;
+    }
+    if (fclose(fp) != 0)
+        ok = 0;
+
+    if (!ok || rename(tmp, path) != 0){
+        unlink(tmp);
+#ifndef NDEBUG
+        printf("SRB_igzopen: could not save index %s\n", path);
+#endif
+    }
+    free(tmp);
+}
+
+// inflate the span of `p` into out[0..len), input read with pread; for the
+// last span the deflate stream has to end there, and the CRC-32 and ISIZE of
+// the member trailer are put in trailer
+static int SRB_gz_extract(int fd, const rb_gz_point_t *p, unsigned char *ibuf,
+        char *out, size_t len, uint32_t *trailer){
+    z_stream strm;
+    off_t off = (off_t)p->in - (p->bits ? 1 : 0);
+    int ret = Z_OK;
+
+    memset(&strm, 0, sizeof(z_stream));
+    if (inflateInit2(&strm, -15) != Z_OK)
+        return -1;
+    if (p->bits){
+        unsigned char c;
+        if (pread(fd, &c, 1, off) != 1){
+            inflateEnd(&strm);
+            return -1;
+        }
+        inflatePrime(&strm, p->bits, c >> (8 - p->bits));
+        ++off;
+    }
+    if (p->dict_len > 0)
+        inflateSetDictionary(&strm, p->dict, p->dict_len);
+
+    strm.next_out = (Bytef*)out;
+    strm.avail_out = (uInt)len;
+    while (strm.avail_out > 0){
+        if (strm.avail_in == 0){
+            ssize_t n = pread(fd, ibuf, SRBIO_GZ_BUFF_SIZE, off);
+            if (n <= 0)
+                break;
+            off += n;
+            strm.next_in = ibuf;
+            strm.avail_in = (uInt)n;
+        }
+        ret = inflate(&strm, Z_NO_FLUSH);
+        if (ret != Z_OK)
+            break;
+    }
+    len = strm.avail_out;
+
+    if (trailer != NULL && len == 0){
+        // run to the end of the stream, no more output is allowed
+        unsigned char extra;
+        while (ret == Z_OK){
+            if (strm.avail_in == 0){
+                ssize_t n = pread(fd, ibuf, SRBIO_GZ_BUFF_SIZE, off);
+                if (n <= 0)
+                    break;
+                off += n;
+                strm.next_in = ibuf;
+                strm.avail_in = (uInt)n;
+            }
+            strm.next_out = &extra;
+            strm.avail_out = 1;
+            ret = inflate(&strm, Z_NO_FLUSH);
+            if (strm.avail_out == 0)
+                ret = Z_DATA_ERROR;
+        }
+        unsigned char t[8];
+        if (ret != Z_STREAM_END || pread(fd, t, 8, off - strm.avail_in) != 8)
+            ret = Z_DATA_ERROR;
+        else {
+            trailer[0] = t[0] | (uint32_t)t[1] << 8 | (uint32_t)t[2] << 16 | (uint32_t)t[3] << 24;
+            trailer[1] = t[4] | (uint32_t)t[5] << 8 | (uint32_t)t[6] << 16 | (uint32_t)t[7] << 24;
+        }
+    }
+    inflateEnd(&strm);
+    return len == 0 && (ret == Z_OK || ret == Z_STREAM_END) ? 0 : -1;
+}
+
+static size_t SRB_gz_span(const rb_gz_file_t *gz, size_t k){
+    uint64_t end = k + 1 < gz->idx.n ? gz->idx.points[k + 1].out : gz->idx.total;
+    return (size_t)(end - gz->idx.points[k].out);
+}
+
+// spans are claimed in order, at most nslots ahead of the consumer
+static void *SRB_gz_worker(void *arg){
+    rb_gz_file_t *gz = (rb_gz_file_t*)arg;
+    unsigned char *ibuf = (unsigned char*)malloc(SRBIO_GZ_BUFF_SIZE);
+
+    pthread_mutex_lock(&gz->lock);
+    while (!gz->stop && gz->next < gz->idx.n){
+        if (gz->next >= gz->cur + gz->nslots){
+            pthread_cond_wait(&gz->cond, &gz->lock);
+            continue;
+        }
+        size_t k = gz->next++;
+        pthread_mutex_unlock(&gz->lock);
+
+        size_t len = SRB_gz_span(gz, k);
+        char *data = (char*)malloc(len);
+        uint32_t trailer[2];
+        int last = k + 1 == gz->idx.n;
+        int ok = ibuf != NULL && data != NULL &&
+            SRB_gz_extract(gz->fd, gz->idx.points + k, ibuf, data, len,
+                    last ? trailer : NULL) == 0;
+        uint32_t crc = ok ? (uint32_t)crc32(0L, (const Bytef*)data, (uInt)len) : 0;
+
+        pthread_mutex_lock(&gz->lock);
+        rb_gz_chunk_t *c = gz->slots + k % gz->nslots;
+        c->data = data;
+        c->len = len;
+        c->crc = crc;
+        c->state = ok ? 1 : -1;
+        if (ok && last){
+            gz->trailer[0] = trailer[0];
+            gz->trailer[1] = trailer[1];
+        }
+        pthread_cond_broadcast(&gz->cond);
+    }
+    pthread_mutex_unlock(&gz->lock);
+    free(ibuf);
+    return NULL;
+}
+
+static long SRB_gz_read_parallel(rb_gz_file_t *gz, char *buff, size_t size){
+    if (gz->cur == gz->idx.n)
+        return 0;
+
+    rb_gz_chunk_t *c = gz->slots + gz->cur % gz->nslots;
+    if (gz->pos == 0){
+        pthread_mutex_lock(&gz->lock);
+        while (c->state == 0)
+            pthread_cond_wait(&gz->cond, &gz->lock);
+        pthread_mutex_unlock(&gz->lock);
+        if (c->state < 0)
+            return -1;
+
+        // the spans are inflated raw, the member's CRC-32 and ISIZE are
+        // checked before the last one is handed over
+        gz->crc = (uint32_t)crc32_combine(gz->crc, c->crc, (z_off_t)c->len);
+        if (gz->cur + 1 == gz->idx.n && (gz->crc != gz->trailer[0] ||
+                    (uint32_t)gz->idx.total != gz->trailer[1])){
+            fprintf(stderr, "SRB_igzopen: CRC or length mismatch in the gzip trailer.\n");
+            c->state = -1;
+            return -1;
+        }
+    }
+    if (c->state < 0)
+        return -1;
+
+    size_t n = c->len - gz->pos;
+    if (n > size)
+        n = size;
+    memcpy(buff, c->data + gz->pos, n);
+    gz->pos += n;
+    if (gz->pos == c->len){
+        free(c->data);
+        c->data = NULL;
+        gz->pos = 0;
+        pthread_mutex_lock(&gz->lock);
+        c->state = 0;
+        ++gz->cur;
+        pthread_cond_broadcast(&gz->cond);
+        pthread_mutex_unlock(&gz->lock);
+    }
+    return (long)n;
+}
+
+static long SRB_gz_fill(rb_gz_file_t *gz){
+    ssize_t n = read(gz->fd, gz->ibuf, SRBIO_GZ_BUFF_SIZE);
+    if (n < 0)
+        return -1;
+    gz->in_off += n;
+    gz->strm->next_in = gz->ibuf;
+    gz->strm->avail_in = (uInt)n;
+    return (long)n;
+}
+
+// one pass over the stream; while building, inflate stops at every deflate
+// block (Z_BLOCK) so that a point can be taken once SRBIO_GZ_SPAN bytes of
+// output have passed since the last one
+static long SRB_gz_read_serial(rb_gz_file_t *gz, char *buff, size_t size){
+    z_stream *strm = gz->strm;
+
+    if (!gz->has_strm){
+        // not a gzip file, served as is like gzread does
+        if (strm->avail_in > 0){
+            size_t n = strm->avail_in < size ? strm->avail_in : size;
+            memcpy(buff, strm->next_in, n);
+            strm->next_in += n;
+            strm->avail_in -= n;
+            return (long)n;
+        }
+        return (long)read(gz->fd, buff, size);
+    }
+
+    strm->next_out = (Bytef*)buff;
+    strm->avail_out = (uInt)size;
+    while (strm->avail_out > 0 && !gz->eof){
+        if (strm->avail_in == 0){
+            long n = SRB_gz_fill(gz);
+            if (n <= 0)
+                return -1;      // truncated
+        }
+
+        uInt avail = strm->avail_out;
+        int ret = inflate(strm, gz->building ? Z_BLOCK : Z_NO_FLUSH);
+        gz->out_off += avail - strm->avail_out;
+        if (ret == Z_STREAM_END){
+            // concatenated members cannot be indexed, trailing garbage is
+            // ignored as in gzread
+            if (strm->avail_in == 0 && SRB_gz_fill(gz) < 0)
+                return -1;
+            if (strm->avail_in == 0 || strm->next_in[0] != 0x1f){
+                gz->eof = 1;
+                break;
+            }
+            if (gz->building)
+                SRB_gz_index_free(&gz->idx);
+            gz->building = 0;
+            inflateReset(strm);
+            continue;
+        }
+        if (ret != Z_OK && ret != Z_BUF_ERROR)
+            return -1;
+
+        if (gz->building && (strm->data_type & 128) && !(strm->data_type & 64)){
+            rb_gz_index_t *idx = &gz->idx;
+            if (idx->n == 0 ? gz->out_off == 0 :
+                    gz->out_off - idx->points[idx->n - 1].out >= SRBIO_GZ_SPAN){
+                if (SRB_gz_index_add(idx, strm, gz->in_off - strm->avail_in,
+                            gz->out_off) != 0){
+                    SRB_gz_index_free(idx);
+                    gz->building = 0;
+                }
+            }
+        }
+    }
+
+    if (gz->eof && gz->building){
+        gz->building = 0;
+        gz->idx.total = gz->out_off;
+        while (gz->idx.n > 0 && gz->idx.points[gz->idx.n - 1].out >= gz->idx.total){
+            --gz->idx.n;
+            free(gz->idx.points[gz->idx.n].dict);
+        }
+        if (gz->idx.n > 1)
+            SRB_gz_index_save(&gz->idx, gz->idx_path);
+    }
+    return (long)(size - strm->avail_out);
+}
+
+static long SRB_gz_read(void *buff, size_t size, void *p){
+    rb_gz_file_t *gz = (rb_gz_file_t*)p;
+    if (gz->started)
+        return SRB_gz_read_parallel(gz, (char*)buff, size);
+    return SRB_gz_read_serial(gz, (char*)buff, size);
+}
+
+static int SRB_gz_start(rb_gz_file_t *gz){
+    gz->nslots = 2 * gz->nthreads + 1;
+    gz->slots = (rb_gz_chunk_t*)calloc(gz->nslots, sizeof(rb_gz_chunk_t));
+    if (gz->slots == NULL)
+        return -1;
+    if (gz->ctx == NULL){
+        gz->threads = (pthread_t*)malloc(gz->nthreads * sizeof(pthread_t));
+        if (gz->threads == NULL)
+            return -1;
+    }
+
+    pthread_mutex_init(&gz->lock, NULL);
+    pthread_cond_init(&gz->cond, NULL);
+    gz->started = 1;
+    if (gz->ctx != NULL){
+        SRB_pool_submit(&gz->ctx->pool, &gz->job, SRB_gz_worker, gz, gz->nthreads);
+        return 0;
+    }
+    for (int t = 0; t < gz->nthreads; ++t){
+        if (pthread_create(gz->threads + t, NULL, SRB_gz_worker, gz) != 0){
+            // the threads already running are enough to finish the file
+            gz->nthreads = t;
+            break;
+        }
+    }
+    return gz->nthreads > 0 ? 0 : -1;
+}
+
+static int SRB_gz_start_serial(rb_gz_file_t *gz){
+    if (gz->ctx != NULL){
+        if (gz->ctx->ibuf == NULL)
+            gz->ctx->ibuf = (char*)malloc(SRBIO_GZ_BUFF_SIZE);
+        gz->ibuf = (unsigned char*)gz->ctx->ibuf;
+        gz->strm = &gz->ctx->inflate;
+    } else {
+        gz->ibuf = (unsigned char*)malloc(SRBIO_GZ_BUFF_SIZE);
+        gz->strm = &gz->zs;
+    }
+    if (gz->ibuf == NULL)
+        return -1;
+    if (SRB_gz_fill(gz) < 0)
+        return -1;
+    while (gz->strm->avail_in < 2){
+        ssize_t n = read(gz->fd, gz->ibuf + gz->strm->avail_in,
+                SRBIO_GZ_BUFF_SIZE - gz->strm->avail_in);
+        if (n <= 0)
+            break;
+        gz->in_off += n;
+        gz->strm->avail_in += n;
+    }
+    if (gz->plain || gz->strm->avail_in < 2 || gz->ibuf[0] != 0x1f || gz->ibuf[1] != 0x8b){
+        gz->building = 0;
+        return 0;
+    }
+
+    if (gz->ctx != NULL && gz->ctx->has_inflate){
+        if (inflateReset(gz->strm) != Z_OK)
+            return -1;
+    } else {
+        if (inflateInit2(gz->strm, 15 + 16) != Z_OK)
+            return -1;
+        if (gz->ctx != NULL)
+            gz->ctx->has_inflate = 1;
+    }
+    gz->has_strm = 1;
+    return 0;
+}
+
+void SRB_igzclose(void *p){
+    rb_gz_file_t *gz = (rb_gz_file_t*)p;
+
+    if (gz->started){
+        pthread_mutex_lock(&gz->lock);
+        gz->stop = 1;
+        pthread_cond_broadcast(&gz->cond);
+        pthread_mutex_unlock(&gz->lock);
+        if (gz->ctx != NULL)
+            SRB_pool_wait(&gz->ctx->pool, &gz->job);
+        for (int t = 0; gz->threads != NULL && t < gz->nthreads; ++t)
+            pthread_join(gz->threads[t], NULL);
+        pthread_mutex_destroy(&gz->lock);
+        pthread_cond_destroy(&gz->cond);
+    }
+    free(gz->threads);
+    if (gz->slots != NULL){
+        for (size_t k = 0; k < gz->nslots; ++k)
+            free(gz->slots[k].data);
+        free(gz->slots);
+    }
+    SRB_gz_index_free(&gz->idx);
+    SRB_source_free(&gz->src);
+    if (gz->ctx == NULL){
+        if (gz->has_strm)
+            inflateEnd(&gz->zs);
+        free(gz->ibuf);
+    }
+    free(gz->idx_path);
+    if (gz->fd >= 0)
+        close(gz->fd);
+    free(gz);
+}
+
+// plain: the file is served as it is (SRB_COMPRESS_NONE)
+void *SRB_igzopen_ctx(const char *filename, rb_context_t *ctx, int plain){
+    rb_gz_file_t *gz;
+    struct stat st;
+    size_t len = strlen(filename) + 6;
+    int ret;
+
+    gz = (rb_gz_file_t*)calloc(1, sizeof(rb_gz_file_t));
+    if (gz == NULL)
+        return NULL;
+    gz->ctx = ctx;
+    gz->plain = plain;
+    gz->fd = open(filename, O_RDONLY);
+    gz->idx_path = (char*)malloc(len);
+    if (ctx != NULL){
+        if (ctx->lbuf == NULL)
+            ctx->lbuf = (char*)malloc(SRBIO_SOURCE_BUFF_SIZE);
+        ret = ctx->lbuf == NULL ? -1 : 0;
+        if (ret == 0)
+            SRB_source_init_buffer(&gz->src, SRB_gz_read, gz, ctx->lbuf,
+                    SRBIO_SOURCE_BUFF_SIZE);
+        gz->nthreads = ctx->pool.nthreads;
+    } else {
+        long ncpu = SRBIO_GZ_THREADS > 0 ? SRBIO_GZ_THREADS : sysconf(_SC_NPROCESSORS_ONLN);
+        ret = SRB_source_init(&gz->src, SRB_gz_read, gz, 0);
+        // the parser takes one of the cpus
+        gz->nthreads = ncpu < SRBIO_GZ_MAX_THREADS ? (int)ncpu : SRBIO_GZ_MAX_THREADS;
+        if (gz->nthreads < 2)
+            gz->nthreads = 0;
+    }
+    if (gz->fd < 0 || gz->idx_path == NULL || fstat(gz->fd, &st) != 0 || ret != 0){
+        SRB_igzclose(gz);
+        return NULL;
+    }
+    snprintf(gz->idx_path, len, "%s.zidx", filename);
+
+    // a stale index is rebuilt, without workers it is of no use
+    if (!plain && st.st_size >= SRBIO_GZ_INDEX_MIN){
+        if (SRB_gz_index_load(&gz->idx, gz->idx_path) == 0 &&
+                gz->idx.gz_ino == (uint64_t)st.st_ino &&
+                gz->idx.gz_size == (uint64_t)st.st_size &&
+                gz->idx.gz_mtime == (int64_t)st.st_mtim.tv_sec &&
+                gz->idx.gz_mtime_ns == (int64_t)st.st_mtim.tv_nsec){
+            if (gz->nthreads > 0 && gz->idx.n > 1){
+                if (SRB_gz_start(gz) == 0)
+                    return gz;
+                SRB_igzclose(gz);
+                return NULL;
+            }
+        } else {
+            SRB_gz_index_free(&gz->idx);
+            gz->idx.gz_ino = (uint64_t)st.st_ino;
+            gz->idx.gz_size = (uint64_t)st.st_size;
+            gz->idx.gz_mtime = (int64_t)st.st_mtim.tv_sec;
+            gz->idx.gz_mtime_ns = (int64_t)st.st_mtim.tv_nsec;
+            gz->building = 1;
+        }
+    }
+
+    if (SRB_gz_start_serial(gz) != 0){
+        SRB_igzclose(gz);
+        return NULL;
+    }
+    return gz;
+}
+
+void *SRB_igzopen(const char *filename, const char *mode){
+    if (strchr(mode, 'r') == NULL)
+        return NULL;
+    return SRB_igzopen_ctx(filename, NULL, 0);
+}
+
+char *SRB_igzgets(char *buff, int size, void *p){
+    return SRB_source_gets(buff, size, &((rb_gz_file_t*)p)->src);
+}
+
+#endif
@@ -0,0 +1,478 @@
+/*
+ * ===========================================================================
+ *
+ *       Filename:  kernels.c
+ *
+ *    Description:  integer card kernels, dispatched on the cpu at load time
+ *
+ *        Version:  1.0
+ *        Created:  10/20/2026 04:16:40 AM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Haoyang Liu (), liuhaoyang@pku.edu.cn
+ *   Organization:  BICMR, Peking University
+ *      Copyright:  Copyright (c) 2021, Haoyang Liu
+ *
+ * ===========================================================================
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "SRBio.h"
+#include "private/kernels.h"
+
+// the variants are built for their instruction sets whatever the flags of
+// the build, and only called once cpuid has them
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define SRBIO_KERNELS_X86
+#include <immintrin.h>
+#endif
+
+static const char SRB_digit_pairs[201] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+static inline int SRB_is_space(char c){
+    return c == ' ' || (c >= '\t' && c <= '\r');
+}
+
+/* ------------------------------------------------------------------------- */
+/* generic                                                                   */
+/* ------------------------------------------------------------------------- */
+
+static int SRB_parse_ints_generic(const char *s, const char *end, int64_t *out, int n,
+        const char **stop){
+    int m = 0;
+    while (m < n){
+        while (s < end && SRB_is_space(*s))
+            ++s;
+        const char *t = s;
+        int64_t v = 0;
+        while (t < end && t - s < 16 && (unsigned)(*t - '0') < 10)
+            v = 10 * v + (*t++ - '0');
+        if (t == s || (t < end && !SRB_is_space(*t)))
+            break;
+        out[m++] = v;
+        s = t;
+    }
+    *stop = s;
+    return m;
+}
+
+// one field as "%*ld"
+static inline char *SRB_format_one(char *p, int64_t v, int w){
+    char tmp[20], *d = tmp + 20;
+    uint64_t u = v < 0 ? -(uint64_t)v : (uint64_t)v;
+    while (u >= 100){
+        d -= 2;
+        memcpy(d, SRB_digit_pairs + 2 * (u % 100), 2);
+        u /= 100;
+    }
+    if (u >= 10){
+        d -= 2;
+        memcpy(d, SRB_digit_pairs + 2 * u, 2);
+    } else {
+        *--d = (char)('0' + u);
+    }
+    int nd = (int)(tmp + 20 - d);
+    int pad = w - nd - (v < 0);
+    if (pad > 0){
+        memset(p, ' ', pad);
+        p += pad;
+    }
+    if (v < 0)
+        *p++ = '-';
+    memcpy(p, d, nd);
+    return p + nd;
+}
+
+static int SRB_format_ints_generic(char *dst, const int64_t *v, int n, int w){
+    char *p = dst;
+    for (int i = 0; i < n; ++i)
+        p = SRB_format_one(p, v[i], w);
+    return (int)(p - dst);
+}
+
+static const rb_kernels_t SRB_kernels_generic = {
+    SRB_KERNEL_GENERIC, SRB_parse_ints_generic, SRB_format_ints_generic
+};
+
+#ifdef SRBIO_KERNELS_X86
+
+/* ------------------------------------------------------------------------- */
+/* parsing: digit and white space masks of a card, then the runs between     */
+/* ------------------------------------------------------------------------- */
+
+// the SIMD parsers look at cards of up to 128 bytes at once
+#define SRBIO_PARSE_WINDOW 128
+
+__extension__ typedef unsigned __int128 rb_mask_t;
+
+static inline int SRB_ctz128(rb_mask_t m){
+    uint64_t lo = (uint64_t)m;
+    return lo != 0 ? __builtin_ctzll(lo) : 64 + __builtin_ctzll((uint64_t)(m >> 64));
+}
+
+// the number written by the last `len` (<= 8) of the 8 digits at p
+static inline uint64_t SRB_swar8(const char *p, int len){
+    uint64_t v;
+    memcpy(&v, p, 8);
+    v &= 0x0f0f0f0f0f0f0f0fULL & (~0ULL << (8 * (8 - len)));
+    v = (v * 2561) >> 8;
+    v = ((v & 0x00ff00ff00ff00ffULL) * 6553601) >> 16;
+    return ((v & 0x0000ffff0000ffffULL) * 42949672960001ULL) >> 32;
+}
+
+// p[0, len) with the digits d and white space w as bit masks; p[-16, 0)
+// must be readable
+static int SRB_parse_masked(const char *p, int len, rb_mask_t d, rb_mask_t w,
+        int64_t *out, int n, int *stop){
+    rb_mask_t valid = len < SRBIO_PARSE_WINDOW ? ((rb_mask_t)1 << len) - 1 : ~(rb_mask_t)0;
+    d &= valid;
+    w = (w & valid) | ~valid;
+
+    // the token of the first character that is neither ends the fast path
+    rb_mask_t other = ~(d | w);
+    int limit = other != 0 ? SRB_ctz128(other) : len;
+    while (limit > 0 && (int)(d >> (limit - 1)) & 1)
+        --limit;
+
+    rb_mask_t starts = d & ~(d << 1);
+    rb_mask_t ends = d & ~(d >> 1);
+    int m = 0, pos = 0;
+    while (m < n){
+        if (starts == 0 || SRB_ctz128(starts) >= limit){
+            pos = limit;
+            break;
+        }
+        int s = SRB_ctz128(starts);
+        int e = SRB_ctz128(ends);
+        int l = e - s + 1;
+        if (l > 16){
+            pos = s;
+            break;
+        }
+        if (l <= 8)
+            out[m++] = (int64_t)SRB_swar8(p + e - 7, l);
+        else
+            out[m++] = (int64_t)(SRB_swar8(p + e - 15, l - 8) * 100000000 + SRB_swar8(p + e - 7, 8));
+        pos = e + 1;
+        starts &= starts - 1;
+        ends &= ends - 1;
+    }
+    *stop = pos;
+    return m;
+}
+
+// the card copied behind 16 bytes of padding and zero filled
+#define SRB_PARSE_PROLOGUE                                                  \
+    size_t len = (size_t)(end - s);                                         \
+    if (len > SRBIO_PARSE_WINDOW)                                           \
+        return SRB_parse_ints_generic(s, end, out, n, stop);                \
+    char buff[16 + SRBIO_PARSE_WINDOW] __attribute__((aligned(64)));        \
+    char *p = buff + 16;                                                    \
+    memset(buff, 0, sizeof(buff));                                          \
+    memcpy(p, s, len);                                                      \
+    rb_mask_t d = 0, w = 0
+
+#define SRB_PARSE_EPILOGUE                                                  \
+    int pos;                                                                \
+    int m = SRB_parse_masked(p, (int)len, d, w, out, n, &pos);              \
+    *stop = s + pos;                                                        \
+    return m
+
+__attribute__((target("sse4.2")))
+static int SRB_parse_ints_sse42(const char *s, const char *end, int64_t *out, int n,
+        const char **stop){
+    SRB_PARSE_PROLOGUE;
+    const __m128i digit = _mm_setr_epi8('0', '9', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+    const __m128i space = _mm_setr_epi8(' ', '\t', '\n', '\v', '\f', '\r', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+    for (size_t k = 0; k < len; k += 16){
+        __m128i x = _mm_loadu_si128((const __m128i*)(p + k));
+        unsigned dk = (unsigned)_mm_cvtsi128_si32(_mm_cmpistrm(digit, x,
+                    _SIDD_UBYTE_OPS | _SIDD_CMP_RANGES | _SIDD_BIT_MASK));
+        unsigned wk = (unsigned)_mm_cvtsi128_si32(_mm_cmpistrm(space, x,
+                    _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY | _SIDD_BIT_MASK));
+        d |= (rb_mask_t)(dk & 0xffff) << k;
+        w |= (rb_mask_t)(wk & 0xffff) << k;
+    }
+    SRB_PARSE_EPILOGUE;
+}
+
+__attribute__((target("avx2")))
+static int SRB_parse_ints_avx2(const char *s, const char *end, int64_t *out, int n,
+        const char **stop){
+    SRB_PARSE_PROLOGUE;
+    const __m256i zero = _mm256_set1_epi8('0'), nine = _mm256_set1_epi8(9);
+    const __m256i tab = _mm256_set1_epi8('\t'), four = _mm256_set1_epi8(4);
+    const __m256i blank = _mm256_set1_epi8(' ');
+    for (size_t k = 0; k < len; k += 32){
+        __m256i x = _mm256_loadu_si256((const __m256i*)(p + k));
+        __m256i t = _mm256_sub_epi8(x, zero);
+        __m256i u = _mm256_sub_epi8(x, tab);
+        __m256i dk = _mm256_cmpeq_epi8(_mm256_min_epu8(t, nine), t);
+        __m256i wk = _mm256_or_si256(_mm256_cmpeq_epi8(_mm256_min_epu8(u, four), u),
+                _mm256_cmpeq_epi8(x, blank));
+        d |= (rb_mask_t)(uint32_t)_mm256_movemask_epi8(dk) << k;
+        w |= (rb_mask_t)(uint32_t)_mm256_movemask_epi8(wk) << k;
+    }
+    SRB_PARSE_EPILOGUE;
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static int SRB_parse_ints_avx512(const char *s, const char *end, int64_t *out, int n,
+        const char **stop){
+    SRB_PARSE_PROLOGUE;
+    const __m512i zero = _mm512_set1_epi8('0'), nine = _mm512_set1_epi8(9);
+    const __m512i tab = _mm512_set1_epi8('\t'), four = _mm512_set1_epi8(4);
+    const __m512i blank = _mm512_set1_epi8(' ');
+    for (size_t k = 0; k < len; k += 64){
+        __m512i x = _mm512_loadu_si512((const void*)(p + k));
+        uint64_t dk = _mm512_cmple_epu8_mask(_mm512_sub_epi8(x, zero), nine);
+        uint64_t wk = _mm512_cmple_epu8_mask(_mm512_sub_epi8(x, tab), four)
+            | _mm512_cmpeq_epi8_mask(x, blank);
+        d |= (rb_mask_t)dk << k;
+        w |= (rb_mask_t)wk << k;
+    }
+    SRB_PARSE_EPILOGUE;
+}
+
+/* ------------------------------------------------------------------------- */
+/* formatting: 16 digits of u < 1e16 per 128-bit lane, then placed in the    */
+/* field by a shuffle                                                        */
+/* ------------------------------------------------------------------------- */
+
+#define SRBIO_FORMAT_LIMIT 10000000000000000ULL
+
+// W. Mula's conversion of abcdefgh < 1e8, the low 32 bits of each 128-bit
+// lane, to the 16-bit digits a, b, ..., h of the lane
+#define SRB_DIV10000 ((int)0xd1b71759)
+#define SRB_DIV_POWERS 0x80003334147b20c5LL      // 8389, 5243, 13108, 32768
+#define SRB_SHIFT_POWERS 0x8000200008000080LL    // 1 << 7, 1 << 11, 1 << 13, 1 << 15
+
+__attribute__((target("sse4.2")))
+static inline __m128i SRB_convert8_sse(__m128i x){
+    __m128i abcd = _mm_srli_epi64(_mm_mul_epu32(x, _mm_set1_epi32(SRB_DIV10000)), 45);
+    __m128i efgh = _mm_sub_epi32(x, _mm_mul_epu32(abcd, _mm_set1_epi32(10000)));
+    __m128i v1 = _mm_slli_epi64(_mm_unpacklo_epi16(abcd, efgh), 2);
+    __m128i v2 = _mm_unpacklo_epi16(v1, v1);
+    v2 = _mm_unpacklo_epi32(v2, v2);
+    __m128i v4 = _mm_mulhi_epu16(_mm_mulhi_epu16(v2, _mm_set1_epi64x(SRB_DIV_POWERS)),
+            _mm_set1_epi64x(SRB_SHIFT_POWERS));
+    return _mm_sub_epi16(v4, _mm_slli_epi64(_mm_mullo_epi16(v4, _mm_set1_epi16(10)), 16));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i SRB_convert8_avx2(__m256i x){
+    __m256i abcd = _mm256_srli_epi64(_mm256_mul_epu32(x, _mm256_set1_epi32(SRB_DIV10000)), 45);
+    __m256i efgh = _mm256_sub_epi32(x, _mm256_mul_epu32(abcd, _mm256_set1_epi32(10000)));
+    __m256i v1 = _mm256_slli_epi64(_mm256_unpacklo_epi16(abcd, efgh), 2);
+    __m256i v2 = _mm256_unpacklo_epi16(v1, v1);
+    v2 = _mm256_unpacklo_epi32(v2, v2);
+    __m256i v4 = _mm256_mulhi_epu16(_mm256_mulhi_epu16(v2, _mm256_set1_epi64x(SRB_DIV_POWERS)),
+            _mm256_set1_epi64x(SRB_SHIFT_POWERS));
+    return _mm256_sub_epi16(v4, _mm256_slli_epi64(_mm256_mullo_epi16(v4, _mm256_set1_epi16(10)), 16));
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static inline __m512i SRB_convert8_avx512(__m512i x){
+    __m512i abcd = _mm512_srli_epi64(_mm512_mul_epu32(x, _mm512_set1_epi32(SRB_DIV10000)), 45);
+    __m512i efgh = _mm512_sub_epi32(x, _mm512_mul_epu32(abcd, _mm512_set1_epi32(10000)));
+    __m512i v1 = _mm512_slli_epi64(_mm512_unpacklo_epi16(abcd, efgh), 2);
+    __m512i v2 = _mm512_unpacklo_epi16(v1, v1);
+    v2 = _mm512_unpacklo_epi32(v2, v2);
+    __m512i v4 = _mm512_mulhi_epu16(_mm512_mulhi_epu16(v2, _mm512_set1_epi64(SRB_DIV_POWERS)),
+            _mm512_set1_epi64(SRB_SHIFT_POWERS));
+    return _mm512_sub_epi16(v4, _mm512_slli_epi64(_mm512_mullo_epi16(v4, _mm512_set1_epi16(10)), 16));
+}
+
+// the field of the number with digits `digits` (16 characters, leading
+// zeros included) at p; 16 bytes are written
+__attribute__((target("sse4.2")))
+static inline char *SRB_place(char *p, __m128i digits, int neg, int w){
+    const __m128i iota = _mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+    unsigned zeros = (unsigned)_mm_movemask_epi8(_mm_cmpeq_epi8(digits, _mm_set1_epi8('0')));
+    int nd = 16 - __builtin_ctz(~zeros | 0x8000);
+    int fw = nd + neg > w ? nd + neg : w;
+    if (fw > 16){
+        // -dddddddddddddddd, w <= 16
+        *p = '-';
+        _mm_storeu_si128((__m128i*)(p + 1), digits);
+        return p + 17;
+    }
+    __m128i x = _mm_shuffle_epi8(digits, _mm_add_epi8(iota, _mm_set1_epi8((char)(16 - fw))));
+    x = _mm_blendv_epi8(x, _mm_set1_epi8(' '), _mm_cmpgt_epi8(_mm_set1_epi8((char)(fw - nd)), iota));
+    _mm_storeu_si128((__m128i*)p, x);
+    if (neg)
+        p[fw - nd - 1] = '-';
+    return p + fw;
+}
+
+__attribute__((target("sse4.2")))
+static int SRB_format_ints_sse42(char *dst, const int64_t *v, int n, int w){
+    char *p = dst;
+    for (int i = 0; i < n; ++i){
+        uint64_t u = v[i] < 0 ? -(uint64_t)v[i] : (uint64_t)v[i];
+        if (u >= SRBIO_FORMAT_LIMIT || w > 16){
+            p = SRB_format_one(p, v[i], w);
+            continue;
+        }
+        __m128i hi = _mm_cvtsi32_si128((int)(u / 100000000));
+        __m128i lo = _mm_cvtsi32_si128((int)(u % 100000000));
+        __m128i a = SRB_convert8_sse(hi), b = SRB_convert8_sse(lo);
+        p = SRB_place(p, _mm_add_epi8(_mm_packus_epi16(a, b), _mm_set1_epi8('0')), v[i] < 0, w);
+    }
+    return (int)(p - dst);
+}
+
+__attribute__((target("avx2")))
+static int SRB_format_ints_avx2(char *dst, const int64_t *v, int n, int w){
+    char *p = dst;
+    int i = 0;
+    for (; i + 2 <= n && w <= 16; i += 2){
+        uint64_t u0 = v[i] < 0 ? -(uint64_t)v[i] : (uint64_t)v[i];
+        uint64_t u1 = v[i + 1] < 0 ? -(uint64_t)v[i + 1] : (uint64_t)v[i + 1];
+        if (u0 >= SRBIO_FORMAT_LIMIT || u1 >= SRBIO_FORMAT_LIMIT){
+            p = SRB_format_one(p, v[i], w);
+            p = SRB_format_one(p, v[i + 1], w);
+            continue;
+        }
+        __m256i hi = _mm256_setr_epi64x((long long)(u0 / 100000000), 0, (long long)(u1 / 100000000), 0);
+        __m256i lo = _mm256_setr_epi64x((long long)(u0 % 100000000), 0, (long long)(u1 % 100000000), 0);
+        __m256i a = SRB_convert8_avx2(hi), b = SRB_convert8_avx2(lo);
+        __m256i digits = _mm256_add_epi8(_mm256_packus_epi16(a, b), _mm256_set1_epi8('0'));
+        p = SRB_place(p, _mm256_castsi256_si128(digits), v[i] < 0, w);
+        p = SRB_place(p, _mm256_extracti128_si256(digits, 1), v[i + 1] < 0, w);
+    }
+    for (; i < n; ++i)
+        p = SRB_format_one(p, v[i], w);
+    return (int)(p - dst);
+}
+
+__attribute__((target("avx512f,avx512bw")))
+static int SRB_format_ints_avx512(char *dst, const int64_t *v, int n, int w){
+    char *p = dst;
+    int i = 0;
+    for (; i + 4 <= n && w <= 16; i += 4){
+        uint64_t u[4];
+        int big = 0;
+        for (int j = 0; j < 4; ++j){
+            u[j] = v[i + j] < 0 ? -(uint64_t)v[i + j] : (uint64_t)v[i + j];
+            big |= u[j] >= SRBIO_FORMAT_LIMIT;
+        }
+        if (big){
+            for (int j = 0; j < 4; ++j)
+                p = SRB_format_one(p, v[i + j], w);
+            continue;
+        }
+        __m512i hi = _mm512_setr_epi64((long long)(u[0] / 100000000), 0, (long long)(u[1] / 100000000), 0,
+                (long long)(u[2] / 100000000), 0, (long long)(u[3] / 100000000), 0);
+        __m512i lo = _mm512_setr_epi64((long long)(u[0] % 100000000), 0, (long long)(u[1] % 100000000), 0,
+                (long long)(u[2] % 100000000), 0, (long long)(u[3] % 100000000), 0);
+        __m512i a = SRB_convert8_avx512(hi), b = SRB_convert8_avx512(lo);
+        __m512i digits = _mm512_add_epi8(_mm512_packus_epi16(a, b), _mm512_set1_epi8('0'));
+        p = SRB_place(p, _mm512_castsi512_si128(digits), v[i] < 0, w);
+        p = SRB_place(p, _mm512_extracti32x4_epi32(digits, 1), v[i + 1] < 0, w);
+        p = SRB_place(p, _mm512_extracti32x4_epi32(digits, 2), v[i + 2] < 0, w);
+        p = SRB_place(p, _mm512_extracti32x4_epi32(digits, 3), v[i + 3] < 0, w);
+    }
+    for (; i < n; ++i)
+        p = SRB_format_one(p, v[i], w);
+    return (int)(p - dst);
+}
+
+static const rb_kernels_t SRB_kernels_sse42 = {
+    SRB_KERNEL_SSE42, SRB_parse_ints_sse42, SRB_format_ints_sse42
+};
+
+static const rb_kernels_t SRB_kernels_avx2 = {
+    SRB_KERNEL_AVX2, SRB_parse_ints_avx2, SRB_format_ints_avx2
+};
+
+static const rb_kernels_t SRB_kernels_avx512 = {
+    SRB_KERNEL_AVX512, SRB_parse_ints_avx512, SRB_format_ints_avx512
+};
+#endif // of ifdef SRBIO_KERNELS_X86
+
+/* ------------------------------------------------------------------------- */
+/* dispatch                                                                  */
+/* ------------------------------------------------------------------------- */
+
+const rb_kernels_t *SRB_kernels = &SRB_kernels_generic;
+static int SRB_kernel_detected = SRB_KERNEL_GENERIC;
+
+static const char *SRB_kernel_names[] = {"generic", "sse4.2", "avx2", "avx512"};
+
+// the kernels of a level, NULL if this cpu or build has not got them
+static const rb_kernels_t *SRB_kernel_table(int level){
+    switch (level){
+        case SRB_KERNEL_GENERIC:
+            return &SRB_kernels_generic;
+#ifdef SRBIO_KERNELS_X86
+        // __builtin_cpu_supports also asks whether the OS saves the registers
+        case SRB_KERNEL_SSE42:
+            return __builtin_cpu_supports("sse4.2") ? &SRB_kernels_sse42 : NULL;
+        case SRB_KERNEL_AVX2:
+            return __builtin_cpu_supports("avx2") ? &SRB_kernels_avx2 : NULL;
+        case SRB_KERNEL_AVX512:
+            return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") ?
+                &SRB_kernels_avx512 : NULL;
+#endif
+        default:
+            return NULL;
+    }
+}
+
+#if defined(__GNUC__) || defined(__clang__)
+__attribute__((constructor))
+#endif
+static void SRB_kernel_detect(void){
+#ifdef SRBIO_KERNELS_X86
+    __builtin_cpu_init();
+#endif
+    int level = SRB_KERNEL_AVX512;
+    while (SRB_kernel_table(level) == NULL)
+        --level;
+    SRB_kernel_detected = level;
+    SRB_kernels = SRB_kernel_table(level);
+
+    const char *env = getenv("SRBIO_KERNEL");
+    if (env == NULL || *env == '\0')
+        return;
+    for (level = SRB_KERNEL_GENERIC; level <= SRB_KERNEL_AVX512; ++level){
+        if (strcmp(env, SRB_kernel_names[level]) == 0)
+            break;
+    }
+    if (level > SRB_KERNEL_AVX512 || SRB_kernel_table(level) == NULL){
+        fprintf(stderr, "SRBio: SRBIO_KERNEL=%s is not available, using %s.\n",
+                env, SRB_kernel_names[SRB_kernel_detected]);
+        return;
+    }
+    SRB_kernels = SRB_kernel_table(level);
+}
+
+int SRB_kernel_get(void){
+    return SRB_kernels->level;
+}
+
+int SRB_kernel_set(int level){
+    if (level < 0)
+        level = SRB_kernel_detected;
+    const rb_kernels_t *k = SRB_kernel_table(level);
+    if (k == NULL){
+        fprintf(stderr, "SRB_kernel_set: %d is not available on this cpu.\n", level);
+        return -999;
+    }
+    SRB_kernels = k;
+    return 0;
+}
+
+const char *SRB_kernel_name(int level){
+    if (level < SRB_KERNEL_GENERIC || level > SRB_KERNEL_AVX512)
+        return NULL;
+    return SRB_kernel_names[level];
+}
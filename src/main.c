@@ -19,19 +19,221 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include "SRBio.h"
 
-int main(int argc, char **argv){
-    if (argc != 2 && argc != 3){
-        fprintf(stderr, "Usage: ./main filename [compress mode]\n");
+// compress mode from the file extension
+static rb_file_compress_t rbio_flag(const char *filename){
+    size_t len = strlen(filename);
+    if (len > 3 && strcmp(filename + len - 3, ".gz") == 0)
+        return SRB_COMPRESS_GZIP;
+    if (len > 4 && strcmp(filename + len - 4, ".bz2") == 0)
+        return SRB_COMPRESS_BZIP2;
+    return SRB_COMPRESS_NONE;
+}
+
+// rbio diff [-a atol] [-r rtol] A B
+// exit status: 0 equal, 1 different, 2 error
+static int rbio_diff(int argc, char **argv){
+    double atol = 0.0, rtol = 0.0;
+    const char *file[2];
+    int nfile = 0;
+    rb_diff_t diff;
+
+    for (int i = 0; i < argc; ++i){
+        if (strcmp(argv[i], "-a") == 0 && i + 1 < argc)
+            atol = strtod(argv[++i], NULL);
+        else if (strcmp(argv[i], "-r") == 0 && i + 1 < argc)
+            rtol = strtod(argv[++i], NULL);
+        else if (nfile < 2)
+            file[nfile++] = argv[i];
+        else
+            nfile = 3;
+    }
+    if (nfile != 2){
+        fprintf(stderr, "Usage: rbio diff [-a atol] [-r rtol] A B\n");
+        return 2;
+    }
+
+    int info = SRB_diff(file[0], rbio_flag(file[0]), file[1], rbio_flag(file[1]),
+            atol, rtol, &diff);
+    if (info){
+        printf("SRB_diff exited with error (%d)\n", info);
+        return 2;
+    }
+    if (!diff.header){
+        printf("shape or symmetry differ, nothing compared\n");
+        return 1;
+    }
+
+    for (int i = 0; i < diff.nreport; ++i){
+        const struct rb_diff_entry *r = diff.report + i;
+        if (r->kind == 'v')
+            printf("(%ld, %ld): %.16e vs %.16e\n", (long)r->row, (long)r->col, r->a, r->b);
+        else
+            printf("(%ld, %ld): only in %s\n", (long)r->row, (long)r->col,
+                    r->kind == 'a' ? "A" : "B");
+    }
+    if (diff.nreport > 0)
+        printf("\n");
+
+    printf("common entries:     %ld\n", (long)diff.common);
+    printf("only in A:          %ld\n", (long)diff.only_a);
+    printf("only in B:          %ld\n", (long)diff.only_b);
+    if (diff.values){
+        printf("out of tolerance:   %ld\n", (long)diff.mismatched);
+        printf("max abs error:      %.6e\n", diff.max_abs);
+        printf("max rel error:      %.6e\n", diff.max_rel);
+        printf("||A - B||_F:        %.6e\n", diff.norm_diff);
+        printf("||A - B||_F/||B||_F: %.6e\n",
+                diff.norm_b > 0 ? diff.norm_diff / diff.norm_b : diff.norm_diff);
+    }
+    return diff.equal ? 0 : 1;
+}
+
+// rbio info A: header and structure, the matrix is parsed but not stored
+static int rbio_info(int argc, char **argv){
+    rb_matrix_info_t mat;
+    rb_read_opts_t opts;
+    rb_stats_t stats;
+    uint64_t fingerprint[2];
+
+    if (argc != 1){
+        fprintf(stderr, "Usage: rbio info A\n");
+        return 2;
+    }
+    SRB_init(&mat);
+    SRB_read_opts_init(&opts);
+    opts.flags = SRB_READ_NO_STORE;
+    opts.stats = &stats;
+    opts.fingerprint = fingerprint;
+
+    int info = SRB_read_ex(argv[0], &mat, rbio_flag(argv[0]), &opts);
+    if (info){
+        printf("SRB_read exited with error (%d)\n", info);
+        return 2;
+    }
+
+    printf("title:              %s\n", mat.descr);
+    printf("key:                %s\n", mat.key);
+    printf("type:               %c%c%c\n", mat.mtype, mat.stype, mat.ftype);
+    printf("size:               %ld x %ld, %ld entries\n",
+            (long)mat.rows, (long)mat.cols, (long)mat.nnz);
+    printf("fingerprint:        %016llx%016llx\n",
+            (unsigned long long)fingerprint[0], (unsigned long long)fingerprint[1]);
+    printf("entries per column: min %ld, max %ld, avg %.2f\n",
+            (long)stats.colnnz_min, (long)stats.colnnz_max,
+            mat.cols > 0 ? (double)mat.nnz / mat.cols : 0.0);
+    for (int b = 0; b < SRB_STATS_BINS; ++b){
+        if (stats.colhist[b] == 0)
+            continue;
+        if (b == 0)
+            printf("    %20s: %ld\n", "0", (long)stats.colhist[b]);
+        else {
+            char range[48];
+            snprintf(range, sizeof(range), "%ld-%ld", 1L << (b - 1), (1L << b) - 1);
+            printf("    %20s: %ld\n", range, (long)stats.colhist[b]);
+        }
+    }
+    printf("lower/diag/upper:   %ld / %ld / %ld\n",
+            (long)stats.lower, (long)stats.diag, (long)stats.upper);
+    printf("missing diagonal:   %ld\n", (long)stats.diag_missing);
+    printf("bandwidth:          lower %ld, upper %ld\n",
+            (long)stats.bw_lower, (long)stats.bw_upper);
+    printf("profile:            %lld\n", stats.profile);
+    if (stats.values){
+        printf("explicit zeros:     %ld\n", (long)stats.zeros);
+        printf("magnitude:          min %.6e, max %.6e\n", stats.min_abs, stats.max_abs);
+    }
+
+    SRB_destroy(&mat);
+    return 0;
+}
+
+// rbio convert [-t] [-e] [-m MB] [-p precision] A B: B is A transposed
+// and/or expanded without loading A
+static int rbio_convert(int argc, char **argv){
+    const char *file[2];
+    int nfile = 0, how = 0, precision = -1;
+    size_t budget = 0;
+
+    for (int i = 0; i < argc; ++i){
+        if (strcmp(argv[i], "-t") == 0)
+            how |= SRB_CONVERT_TRANSPOSE;
+        else if (strcmp(argv[i], "-e") == 0)
+            how |= SRB_CONVERT_EXPAND;
+        else if (strcmp(argv[i], "-m") == 0 && i + 1 < argc)
+            budget = (size_t)strtol(argv[++i], NULL, 10) << 20;
+        else if (strcmp(argv[i], "-p") == 0 && i + 1 < argc)
+            precision = (int)strtol(argv[++i], NULL, 10);
+        else if (nfile < 2)
+            file[nfile++] = argv[i];
+        else
+            nfile = 3;
+    }
+    if (nfile != 2 || how == 0){
+        fprintf(stderr, "Usage: rbio convert [-t] [-e] [-m MB] [-p precision] A B\n");
+        return 2;
+    }
+
+    int info = SRB_convert(file[0], rbio_flag(file[0]), file[1], precision,
+            rbio_flag(file[1]), how, budget);
+    if (info){
+        printf("SRB_convert exited with error (%d)\n", info);
+        return 2;
+    }
+    return 0;
+}
+
+// rbio recompress [-c] [-j threads] [-l level] A B: B is A in the codec
+// of its extension, byte for byte the same text
+static int rbio_recompress(int argc, char **argv){
+    const char *file[2];
+    int nfile = 0, how = 0, nthreads = 0;
+    rb_write_opts_t opts;
+
+    SRB_write_opts_init(&opts);
+    for (int i = 0; i < argc; ++i){
+        if (strcmp(argv[i], "-c") == 0)
+            how |= SRB_RECOMPRESS_CHECK;
+        else if (strcmp(argv[i], "-j") == 0 && i + 1 < argc)
+            nthreads = (int)strtol(argv[++i], NULL, 10);
+        else if (strcmp(argv[i], "-l") == 0 && i + 1 < argc){
+            // gzip level, bzip2 block size
+            opts.level = (int)strtol(argv[++i], NULL, 10);
+            opts.block_size = opts.level;
+        }
+        else if (nfile < 2)
+            file[nfile++] = argv[i];
+        else
+            nfile = 3;
+    }
+    if (nfile != 2){
+        fprintf(stderr, "Usage: rbio recompress [-c] [-j threads] [-l level] A B\n");
+        return 2;
+    }
+
+    int info = SRB_recompress(file[0], rbio_flag(file[0]), file[1], rbio_flag(file[1]),
+            &opts, nthreads, how);
+    if (info){
+        printf("SRB_recompress exited with error (%d)\n", info);
+        return 2;
+    }
+    return 0;
+}
+
+// rbio filename [compress mode]: read the file and write it to rbmat
+static int rbio_copy(int argc, char **argv){
+    if (argc != 1 && argc != 2){
+        fprintf(stderr, "Usage: rbio filename [compress mode]\n");
         return -1;
     }
     rb_file_compress_t flag = 0;
-    if (argc == 3)
-        flag = (rb_file_compress_t)strtol(argv[2], NULL, 10);
+    if (argc == 2)
+        flag = (rb_file_compress_t)strtol(argv[1], NULL, 10);
     rb_matrix_info_t mat;
     SRB_init(&mat);
-    int info = SRB_read(argv[1], &mat, flag);
+    int info = SRB_read(argv[0], &mat, flag);
 
     if (info){
         printf("SRB_read exited with error (%d)\n", info);
@@ -50,3 +252,23 @@ int main(int argc, char **argv){
     SRB_destroy(&mat);
     return 0;
 }
+
+int main(int argc, char **argv){
+    if (argc < 2){
+        fprintf(stderr, "Usage: rbio filename [compress mode]\n"
+                "       rbio diff [-a atol] [-r rtol] A B\n"
+                "       rbio info A\n"
+                "       rbio convert [-t] [-e] [-m MB] [-p precision] A B\n"
+                "       rbio recompress [-c] [-j threads] [-l level] A B\n");
+        return -1;
+    }
+    if (strcmp(argv[1], "diff") == 0)
+        return rbio_diff(argc - 2, argv + 2);
+    if (strcmp(argv[1], "info") == 0)
+        return rbio_info(argc - 2, argv + 2);
+    if (strcmp(argv[1], "convert") == 0)
+        return rbio_convert(argc - 2, argv + 2);
+    if (strcmp(argv[1], "recompress") == 0)
+        return rbio_recompress(argc - 2, argv + 2);
+    return rbio_copy(argc - 1, argv + 1);
+}
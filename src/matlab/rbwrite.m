@@ -25,13 +25,8 @@ if numel(key) > 8
     key = key(1:8);
 end
 
-% automatically detect whether A is symmetric
-if (issymmetric(A))
-    sym_flag = 1;
-    A = tril(A); % only lower part of A is stored
-else
-    sym_flag = 0;
-end
+% symmetry is detected by the writer, which then stores the lower part of A
+sym_flag = -1;
 
 flag = 0;
 [filedir, name, ext] = fileparts(filename);
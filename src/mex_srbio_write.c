@@ -25,6 +25,10 @@
 #include "SRBio.h"
 
 /* mex_srbio_write(filename, A, descr, key, precision, sym_flag, compress_flag)
+ *
+ * sym_flag > 0: A holds the lower triangle of a symmetric matrix
+ * sym_flag < 0: A is complete, symmetry is detected and only the lower
+ *               triangle is written
  */
 
 void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]){
@@ -72,13 +76,16 @@ void mexFunction(int nlhs, mxArray *plhs[], int nrhs, const mxArray *prhs[]){
     int flag = (int)*mxGetPr(prhs[6]);
 
     // create rb_matrix
+    SRB_init(&mat);
     strncpy(mat.descr, descr, 72);
     strncpy(mat.key, key, 8);
     mat.cols = cols;
     mat.rows = rows;
     mat.nnz = nnz;
     mat.mtype = 'r';
-    mat.stype = issym ? 's' : 'u';
+    mat.stype = issym > 0 ? 's' : 'u';
+    if (issym < 0)
+        flag |= SRB_WRITE_SYMMETRY;
     mat.ftype = 'a';
 
     // matlab uses 0-based indexing
@@ -0,0 +1,221 @@
+/*
+ * ===========================================================================
+ *
+ *       Filename:  numa.c
+ *
+ *    Description:  first-touch placement of a parallel load
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 07:05:13 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Haoyang Liu (), liuhaoyang@pku.edu.cn
+ *   Organization:  BICMR, Peking University
+ *      Copyright:  Copyright (c) 2021, Haoyang Liu
+ *
+ * ===========================================================================
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#endif
+
+#include "SRBio.h"
+#include "private/numa.h"
+
+#define SRBIO_NUMA_BATCH 1024
+
+#ifndef CPU_SETSIZE
+#define CPU_SETSIZE 1024
+#endif
+
+// byte ranges zeroed by one worker
+struct rb_touch {
+    int cpu;            // -1: not pinned
+    int nseg;
+    char *seg[2];
+    size_t len[2];
+};
+
+static void *SRB_numa_worker(void *p){
+    struct rb_touch *w = (struct rb_touch*)p;
+#ifdef __linux__
+    if (w->cpu >= 0){
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(w->cpu, &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &set);
+    }
+#endif
+    for (int s = 0; s < w->nseg; ++s)
+        memset(w->seg[s], 0, w->len[s]);
+    return NULL;
+}
+
+int SRB_numa_active(const rb_read_opts_t *opts){
+    return opts != NULL && opts->nthreads > 0;
+}
+
+int SRB_numa_check(const rb_read_opts_t *opts, SRB_INT cols){
+    if (opts->pin == SRB_PIN_LIST && opts->cpus == NULL){
+        fprintf(stderr, "SRB_read: SRB_PIN_LIST needs cpus.\n");
+        return -51;
+    }
+    if (opts->col_part == NULL)
+        return 0;
+    if (opts->col_part[0] != 0 || opts->col_part[opts->nthreads] != cols){
+        fprintf(stderr, "SRB_read: col_part does not cover the %d columns.\n", (int)cols);
+        return -51;
+    }
+    for (int t = 0; t < opts->nthreads; ++t){
+        if (opts->col_part[t + 1] < opts->col_part[t]){
+            fprintf(stderr, "SRB_read: col_part is not monotone at %d.\n", t);
+            return -51;
+        }
+    }
+    return 0;
+}
+
+// first column of part t
+static SRB_INT SRB_numa_part(const rb_read_opts_t *opts, SRB_INT cols, int t){
+    SRB_INT n = opts->nthreads;
+    if (opts->col_part != NULL)
+        return opts->col_part[t];
+    return cols / n * t + (t < cols % n ? t : cols % n);
+}
+
+// start one pinned worker per part and wait for all of them
+static void SRB_numa_run(const rb_read_opts_t *opts, struct rb_touch *w){
+    int n = opts->nthreads;
+    int allowed[CPU_SETSIZE], nallowed = 0;
+    pthread_t *threads = (pthread_t*)malloc(n * sizeof(pthread_t));
+    char *started = (char*)calloc(n, 1);
+
+#ifdef __linux__
+    cpu_set_t set;
+    if (opts->pin != SRB_PIN_NONE && sched_getaffinity(0, sizeof(cpu_set_t), &set) == 0){
+        for (int c = 0; c < CPU_SETSIZE; ++c)
+            if (CPU_ISSET(c, &set)) allowed[nallowed++] = c;
+    }
+#endif
+
+    for (int t = 0; t < n; ++t){
+        w[t].cpu = -1;
+        if (opts->pin == SRB_PIN_LIST)
+            w[t].cpu = opts->cpus[t];
+        else if (opts->pin == SRB_PIN_COMPACT && nallowed > 0)
+            w[t].cpu = allowed[t % nallowed];
+        else if (opts->pin == SRB_PIN_SPREAD && nallowed > 0)
+            w[t].cpu = allowed[(int)((long)t * nallowed / n) % nallowed];
+    }
+
+    // a part whose worker cannot start is touched here, unplaced but valid
+    for (int t = 0; t < n; ++t){
+        if (threads != NULL && started != NULL &&
+                pthread_create(&threads[t], NULL, SRB_numa_worker, &w[t]) == 0){
+            started[t] = 1;
+        } else {
+            int cpu = w[t].cpu;
+            w[t].cpu = -1;
+            SRB_numa_worker(&w[t]);
+            w[t].cpu = cpu;
+        }
+    }
+    for (int t = 0; t < n; ++t)
+        if (started != NULL && started[t])
+            pthread_join(threads[t], NULL);
+
+    free(threads);
+    free(started);
+}
+
+void SRB_numa_touch_colptr(const rb_read_opts_t *opts, rb_matrix_info_t *mat){
+    int n = opts->nthreads;
+    struct rb_touch *w = (struct rb_touch*)calloc(n, sizeof(struct rb_touch));
+    if (w == NULL)
+        return;
+
+    for (int t = 0; t < n; ++t){
+        SRB_INT lo = SRB_numa_part(opts, mat->cols, t);
+        SRB_INT hi = SRB_numa_part(opts, mat->cols, t + 1) + (t == n - 1);
+        w[t].nseg = 1;
+        w[t].seg[0] = (char*)(mat->colptr + lo);
+        w[t].len[0] = (hi - lo) * sizeof(SRB_INT);
+    }
+    SRB_numa_run(opts, w);
+    free(w);
+}
+
+void SRB_numa_touch_entries(const rb_read_opts_t *opts, rb_matrix_info_t *mat,
+        const SRB_INT *ptr, SRB_INT base){
+    int n = opts->nthreads;
+    struct rb_touch *w = (struct rb_touch*)calloc(n, sizeof(struct rb_touch));
+    if (w == NULL)
+        return;
+
+    for (int t = 0; t < n; ++t){
+        SRB_INT lo = ptr[SRB_numa_part(opts, mat->cols, t)] - base;
+        SRB_INT hi = ptr[SRB_numa_part(opts, mat->cols, t + 1)] - base;
+
+        // colptr is not validated yet
+        if (lo < 0) lo = 0;
+        if (hi > mat->nnz) hi = mat->nnz;
+        if (hi < lo) hi = lo;
+
+        if (mat->rowind != NULL){
+            w[t].seg[w[t].nseg] = (char*)(mat->rowind + lo);
+            w[t].len[w[t].nseg++] = (hi - lo) * sizeof(SRB_INT);
+        }
+        if (mat->valptr_d != NULL){
+            w[t].seg[w[t].nseg] = (char*)(mat->valptr_d + lo);
+            w[t].len[w[t].nseg++] = (hi - lo) * sizeof(SRB_Scalar);
+        } else if (mat->valptr_i != NULL){
+            w[t].seg[w[t].nseg] = (char*)(mat->valptr_i + lo);
+            w[t].len[w[t].nseg++] = (hi - lo) * sizeof(SRB_INT);
+        }
+    }
+    SRB_numa_run(opts, w);
+    free(w);
+}
+
+long SRB_numa_pages(const void *addr, size_t bytes, long *count, int nnodes){
+#if defined(__linux__) && defined(SYS_move_pages)
+    void *pages[SRBIO_NUMA_BATCH];
+    int status[SRBIO_NUMA_BATCH];
+    uintptr_t psize = (uintptr_t)sysconf(_SC_PAGESIZE);
+    uintptr_t first = (uintptr_t)addr & ~(psize - 1);
+    uintptr_t last = ((uintptr_t)addr + bytes + psize - 1) & ~(psize - 1);
+    long other = 0;
+
+    for (int i = 0; i < nnodes; ++i) count[i] = 0;
+    if (bytes == 0)
+        return 0;
+
+    // with nodes == NULL, move_pages only reports where each page lives
+    for (uintptr_t p = first; p < last; ){
+        unsigned long m = 0;
+        for (; m < SRBIO_NUMA_BATCH && p < last; ++m, p += psize)
+            pages[m] = (void*)p;
+        if (syscall(SYS_move_pages, 0, m, pages, NULL, status, 0) != 0)
+            return -1;
+        for (unsigned long i = 0; i < m; ++i){
+            if (status[i] >= 0 && status[i] < nnodes) ++count[status[i]];
+            else ++other;
+        }
+    }
+    return other;
+#else
+    return -999;
+#endif
+}
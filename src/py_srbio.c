@@ -0,0 +1,299 @@
+/*
+ * ===========================================================================
+ *
+ *       Filename:  py_srbio.c
+ *
+ *    Description:  python interface, arrays are handed over without copies
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 08:52:04 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Haoyang Liu (), liuhaoyang@pku.edu.cn
+ *   Organization:  BICMR, Peking University
+ *      Copyright:  Copyright (c) 2021, Haoyang Liu
+ *
+ * ===========================================================================
+ */
+
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <stdlib.h>
+#include <string.h>
+
+#define SRBIO_ILP64
+#include "SRBio.h"
+
+/* (rows, cols, mtype, stype, indptr, indices, data) = _srbio.read(filename, flag, pattern)
+ * _srbio.write(filename, rows, cols, indptr, indices, data, descr, key, stype, precision, flag)
+ *
+ * indices count from 0 in both directions, data is None for patterns
+ */
+
+// owns one array of the library, exported through the buffer protocol so
+// numpy.asarray() wraps it in place; freed with the last view
+typedef struct {
+    PyObject_HEAD
+    void *data;
+    Py_ssize_t shape[1];
+    Py_ssize_t itemsize;
+    char *format;
+} rb_pyarray_t;
+
+static void SRB_pyarray_dealloc(rb_pyarray_t *self){
+    free(self->data);
+    Py_TYPE(self)->tp_free((PyObject*)self);
+}
+
+static int SRB_pyarray_getbuffer(rb_pyarray_t *self, Py_buffer *view, int flags){
+    view->obj = (PyObject*)self;
+    view->buf = self->data;
+    view->len = self->shape[0] * self->itemsize;
+    view->readonly = 0;
+    view->itemsize = self->itemsize;
+    view->format = (flags & PyBUF_FORMAT) ? self->format : NULL;
+    view->ndim = 1;
+    view->shape = (flags & PyBUF_ND) ? self->shape : NULL;
+    view->strides = (flags & PyBUF_STRIDES) ? &view->itemsize : NULL;
+    view->suboffsets = NULL;
+    view->internal = NULL;
+    Py_INCREF(self);
+    return 0;
+}
+
+static PyBufferProcs SRB_pyarray_as_buffer = {
+    (getbufferproc)SRB_pyarray_getbuffer,
+    NULL,
+};
+
+static PyTypeObject SRB_pyarray_type = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "_srbio.array",
+    .tp_basicsize = sizeof(rb_pyarray_t),
+    .tp_dealloc = (destructor)SRB_pyarray_dealloc,
+    .tp_as_buffer = &SRB_pyarray_as_buffer,
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_doc = "array owned by SRBio",
+};
+
+// takes `data` over, it is freed here on failure
+static PyObject *SRB_pyarray_new(void *data, SRB_INT n, Py_ssize_t itemsize, char *format){
+    rb_pyarray_t *self = PyObject_New(rb_pyarray_t, &SRB_pyarray_type);
+    if (self == NULL){
+        free(data);
+        return NULL;
+    }
+    self->data = data;
+    self->shape[0] = n;
+    self->itemsize = itemsize;
+    self->format = format;
+    return (PyObject*)self;
+}
+
+static PyObject *SRB_py_read(PyObject *module, PyObject *args){
+    const char *filename;
+    Py_ssize_t rows, cols;
+    int flag = 0, pattern = 0, info, mtype, stype;
+    rb_matrix_info_t mat;
+    rb_read_opts_t opts;
+    PyObject *indptr, *indices, *data = Py_None;
+
+    if (!PyArg_ParseTuple(args, "s|ip", &filename, &flag, &pattern))
+        return NULL;
+
+    SRB_init(&mat);
+    SRB_read_opts_init(&opts);
+    opts.flags = SRB_READ_ZERO_BASED | (pattern ? SRB_READ_PATTERN : 0);
+
+    Py_BEGIN_ALLOW_THREADS
+    info = SRB_read_ex(filename, &mat, (rb_file_compress_t)flag, &opts);
+    Py_END_ALLOW_THREADS
+
+    if (info != 0){
+        SRB_destroy(&mat);
+        PyErr_Format(PyExc_IOError, "SRB_read exited with code %d: %s", info, filename);
+        return NULL;
+    }
+    if (mat.mtype != 'r' && mat.mtype != 'i' && mat.mtype != 'p'){
+        SRB_destroy(&mat);
+        PyErr_Format(PyExc_ValueError, "unsupported matrix type %c", mat.mtype);
+        return NULL;
+    }
+
+    rows = mat.rows;
+    cols = mat.cols;
+    mtype = mat.mtype;
+    stype = mat.stype;
+
+    // the arrays change hands one by one, whatever is left stays in mat
+    indptr = SRB_pyarray_new(mat.colptr, mat.cols + 1, sizeof(SRB_INT), "l");
+    mat.colptr = NULL;
+    indices = SRB_pyarray_new(mat.rowind, mat.nnz, sizeof(SRB_INT), "l");
+    mat.rowind = NULL;
+    if (mat.mtype == 'r'){
+        data = SRB_pyarray_new(mat.valptr_d, mat.nnz, sizeof(SRB_Scalar), "d");
+        mat.valptr_d = NULL;
+    } else if (mat.mtype == 'i'){
+        data = SRB_pyarray_new(mat.valptr_i, mat.nnz, sizeof(SRB_INT), "l");
+        mat.valptr_i = NULL;
+    } else {
+        Py_INCREF(data);
+    }
+    SRB_destroy(&mat);
+
+    if (indptr == NULL || indices == NULL || data == NULL){
+        Py_XDECREF(indptr);
+        Py_XDECREF(indices);
+        Py_XDECREF(data);
+        return NULL;
+    }
+    return Py_BuildValue("(nnCCNNN)", (Py_ssize_t)rows, (Py_ssize_t)cols,
+            mtype, stype, indptr, indices, data);
+}
+
+// struct code of a native scalar buffer, 0 for anything else
+static char SRB_py_format(const Py_buffer *view){
+    const char *f = view->format;
+    if (f[0] == '@' || f[0] == '=' || f[0] == '<')
+        ++f;
+    return f[0] != '\0' && f[1] == '\0' ? f[0] : 0;
+}
+
+static int SRB_py_is_int(const Py_buffer *view){
+    char f = SRB_py_format(view);
+    return f != 0 && strchr("ilq", f) != NULL;
+}
+
+static PyObject *SRB_py_write(PyObject *module, PyObject *args){
+    const char *filename, *descr, *key;
+    Py_ssize_t rows, cols;
+    PyObject *o_ptr, *o_ind, *o_val;
+    int stype, precision, flag, info = 0;
+    Py_buffer ptr, ind, val;
+    SRB_INT *colptr = NULL;
+    SRB_INT *rowind = NULL;
+    rb_matrix_info_t mat;
+
+    if (!PyArg_ParseTuple(args, "snnOOOssCii", &filename, &rows, &cols,
+                &o_ptr, &o_ind, &o_val, &descr, &key, &stype, &precision, &flag))
+        return NULL;
+
+    if (PyObject_GetBuffer(o_ptr, &ptr, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT) != 0)
+        return NULL;
+    if (PyObject_GetBuffer(o_ind, &ind, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT) != 0){
+        PyBuffer_Release(&ptr);
+        return NULL;
+    }
+    memset(&val, 0, sizeof(Py_buffer));
+    if (o_val != Py_None && PyObject_GetBuffer(o_val, &val, PyBUF_C_CONTIGUOUS | PyBUF_FORMAT) != 0){
+        PyBuffer_Release(&ptr);
+        PyBuffer_Release(&ind);
+        return NULL;
+    }
+
+    SRB_init(&mat);
+    snprintf(mat.descr, sizeof(mat.descr), "%s", descr);
+    snprintf(mat.key, sizeof(mat.key), "%s", key);
+    mat.rows = rows;
+    mat.cols = cols;
+    mat.nnz = ind.len / (ind.itemsize > 0 ? ind.itemsize : 1);
+    mat.mtype = o_val != Py_None ? 'r' : 'p';
+    mat.stype = (char)stype;
+    mat.ftype = 'a';
+
+    if (!SRB_py_is_int(&ptr) || !SRB_py_is_int(&ind) ||
+            (ptr.itemsize != 4 && ptr.itemsize != 8) || (ind.itemsize != 4 && ind.itemsize != 8) ||
+            ptr.len / ptr.itemsize != cols + 1){
+        PyErr_SetString(PyExc_ValueError, "indptr/indices must be int32 or int64 of matching size");
+        info = 1;
+    } else if (mat.mtype == 'r' && (SRB_py_format(&val) != 'd' || val.len / val.itemsize != mat.nnz)){
+        PyErr_SetString(PyExc_ValueError, "data must be float64 of the size of indices");
+        info = 1;
+    }
+
+    // arrays of the width of SRB_INT are used in place, the others widened
+    if (info == 0){
+        if (ptr.itemsize == sizeof(SRB_INT)){
+            mat.colptr = (SRB_INT*)ptr.buf;
+        } else {
+            colptr = (SRB_INT*)malloc((cols + 1) * sizeof(SRB_INT));
+            if (colptr == NULL){
+                PyErr_NoMemory();
+                info = 1;
+            } else {
+                for (Py_ssize_t j = 0; j <= cols; ++j)
+                    colptr[j] = ((const int32_t*)ptr.buf)[j];
+                mat.colptr = colptr;
+            }
+        }
+        if (ind.itemsize == sizeof(SRB_INT)){
+            mat.rowind = (SRB_INT*)ind.buf;
+        } else if (info == 0){
+            rowind = (SRB_INT*)malloc((mat.nnz > 0 ? mat.nnz : 1) * sizeof(SRB_INT));
+            if (rowind == NULL){
+                PyErr_NoMemory();
+                info = 1;
+            } else {
+                for (Py_ssize_t k = 0; k < mat.nnz; ++k)
+                    rowind[k] = ((const int32_t*)ind.buf)[k];
+                mat.rowind = rowind;
+            }
+        }
+        mat.valptr_d = (SRB_Scalar*)val.buf;
+    }
+
+    if (info == 0){
+        Py_BEGIN_ALLOW_THREADS
+        info = SRB_write_p(filename, &mat, precision,
+                (rb_file_compress_t)(flag | SRB_WRITE_ZERO_BASED));
+        Py_END_ALLOW_THREADS
+        if (info != 0)
+            PyErr_Format(PyExc_IOError, "SRB_write_p exited with code %d: %s", info, filename);
+    }
+
+    free(colptr);
+    free(rowind);
+    PyBuffer_Release(&ptr);
+    PyBuffer_Release(&ind);
+    if (o_val != Py_None)
+        PyBuffer_Release(&val);
+    if (info != 0)
+        return NULL;
+    Py_RETURN_NONE;
+}
+
+static PyMethodDef SRB_py_methods[] = {
+    {"read", SRB_py_read, METH_VARARGS,
+        "read(filename, flag=0, pattern=False) -> (rows, cols, mtype, stype, indptr, indices, data)"},
+    {"write", SRB_py_write, METH_VARARGS,
+        "write(filename, rows, cols, indptr, indices, data, descr, key, stype, precision, flag)"},
+    {NULL, NULL, 0, NULL}
+};
+
+static struct PyModuleDef SRB_py_module = {
+    PyModuleDef_HEAD_INIT,
+    "_srbio",
+    "Rutherford-Boeing I/O through SRBio",
+    -1,
+    SRB_py_methods,
+    NULL, NULL, NULL, NULL
+};
+
+PyMODINIT_FUNC PyInit__srbio(void){
+    PyObject *m;
+
+    if (PyType_Ready(&SRB_pyarray_type) < 0)
+        return NULL;
+    m = PyModule_Create(&SRB_py_module);
+    if (m == NULL)
+        return NULL;
+    Py_INCREF(&SRB_pyarray_type);
+    if (PyModule_AddObject(m, "array", (PyObject*)&SRB_pyarray_type) < 0){
+        Py_DECREF(&SRB_pyarray_type);
+        Py_DECREF(m);
+        return NULL;
+    }
+    return m;
+}
@@ -0,0 +1,74 @@
+"""Rutherford-Boeing I/O for scipy.sparse through SRBio.
+
+The arrays of the library are wrapped in place: a matrix read here owns the
+buffers filled by the parser, and a csc_matrix with float64 data is written
+from its own buffers.
+"""
+
+import os
+
+import numpy as np
+import scipy.sparse as sp
+
+import _srbio
+
+__all__ = ['rbread', 'rbwrite']
+
+
+def _compress_flag(filename, compress):
+    ext = os.path.splitext(filename)[1]
+    if compress == 'auto':
+        return {'.gz': 1, '.bz2': 2}.get(ext, 0)
+    if compress in ('none', None):
+        return 0
+    if compress in ('gzip', 'gz'):
+        return 1
+    if compress in ('bz2', 'bzip2'):
+        return 2
+    raise ValueError('Unknown compress mode %s' % compress)
+
+
+def rbread(filename, compress='auto', pattern=False, expand=True):
+    """Read an RB file into a scipy.sparse.csc_matrix.
+
+    With expand=False, symmetric and skew-symmetric matrices keep the lower
+    triangle stored in the file and are returned without any copy.
+    """
+    flag = _compress_flag(filename, compress)
+    rows, cols, mtype, stype, indptr, indices, data = \
+        _srbio.read(os.fspath(filename), flag, pattern)
+
+    indptr = np.asarray(indptr)
+    indices = np.asarray(indices)
+    data = np.ones(indices.size) if data is None else np.asarray(data)
+
+    # the constructor would narrow small int64 indices to int32 with a copy
+    A = sp.csc_matrix((rows, cols), dtype=data.dtype)
+    A.data, A.indices, A.indptr = data, indices, indptr
+
+    if expand and stype == 's':
+        A = A + sp.tril(A, -1).T
+    elif expand and stype == 'z':
+        A = A - sp.tril(A, -1).T
+    return A
+
+
+def rbwrite(filename, A, descr='', key='', compress='auto', precision=-1,
+            symmetric=False):
+    """Write a sparse matrix to an RB file.
+
+    A float64 csc_matrix is passed to the library as is. With symmetric=True
+    only the lower triangle of A is written and the file is marked 's'.
+    """
+    flag = _compress_flag(filename, compress)
+    stype = 'u'
+    if symmetric:
+        A = sp.tril(A)
+        stype = 's'
+    if not sp.isspmatrix_csc(A):
+        A = sp.csc_matrix(A)
+
+    data = A.data if A.dtype == np.float64 else A.data.astype(np.float64)
+    rows, cols = A.shape
+    _srbio.write(os.fspath(filename), rows, cols, A.indptr, A.indices, data,
+                 descr[:72], key[:8], stype, precision, flag)
@@ -0,0 +1,321 @@
+/*
+ * ===========================================================================
+ *
+ *       Filename:  sink.c
+ *
+ *    Description:  buffered output sink with gzip/bzip2 encoders
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 02:44:51 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Haoyang Liu (), liuhaoyang@pku.edu.cn
+ *   Organization:  BICMR, Peking University
+ *      Copyright:  Copyright (c) 2021, Haoyang Liu
+ *
+ * ===========================================================================
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "SRBio.h"
+
+#ifdef SRBIO_USE_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef SRBIO_USE_BZIP2
+#include <bzlib.h>
+#endif
+
+#include "private/wrap.h"
+#include "private/sink.h"
+#include "private/context.h"
+
+static int SRB_sink_fwrite(const void *data, size_t len, void *p){
+    return fwrite(data, 1, len, (FILE*)p) == len ? 0 : -1;
+}
+
+static int SRB_sink_fclose(void *p){
+    return fclose((FILE*)p) == 0 ? 0 : -1;
+}
+
+void SRB_write_opts_init(rb_write_opts_t *opts){
+    opts->level = -1;
+    opts->strategy = -1;
+    opts->window_bits = -1;
+    opts->mem_level = -1;
+    opts->block_size = -1;
+    opts->work_factor = -1;
+    opts->buffer_size = 0;
+    opts->fingerprint = NULL;
+}
+
+int SRB_sink_open(rb_sink_t *sink, const char *filename, const char *mode,
+        rb_file_compress_t flag, const rb_write_opts_t *opts){
+    return SRB_sink_open_ctx(sink, filename, mode, flag, opts, NULL);
+}
+
+// with a context, plain text goes through stdio unless O_DIRECT is asked
+// for: setting up a ring and its buffers costs more than a small file
+int SRB_sink_open_ctx(rb_sink_t *sink, const char *filename, const char *mode,
+        rb_file_compress_t flag, const rb_write_opts_t *opts, rb_context_t *ctx){
+    void *target;
+    SRB_write_f out = SRB_sink_fwrite;
+    SRB_finish_f finish = SRB_sink_fclose;
+
+#ifdef SRBIO_USE_IO_URING
+    if ((flag & SRB_COMPRESS_MASK) == SRB_COMPRESS_NONE &&
+            (ctx == NULL || strchr(mode, 'd') != NULL)){
+        target = SRB_uringopen(filename, mode);
+        out = SRB_uringwrite;
+        finish = SRB_uringfinish;
+    } else
+#endif
+    target = fopen(filename, "wb");
+
+    if (target == NULL)
+        return -100;
+
+    int ret = SRB_sink_init_ctx(sink, out, finish, target, flag, opts, ctx);
+    if (ret != 0)
+        finish(target);
+    return ret;
+}
+
+int SRB_sink_init(rb_sink_t *sink, SRB_write_f out, SRB_finish_f finish,
+        void *target, rb_file_compress_t flag, const rb_write_opts_t *opts){
+    return SRB_sink_init_ctx(sink, out, finish, target, flag, opts, NULL);
+}
+
+#ifdef SRBIO_USE_ZLIB
+// the deflate state of the context, reset when the parameters match
+static z_stream *SRB_sink_deflate(rb_context_t *ctx, const int *params){
+    if (ctx->has_deflate){
+        if (memcmp(ctx->deflate_params, params, sizeof(ctx->deflate_params)) == 0)
+            return deflateReset(&ctx->deflate) == Z_OK ? &ctx->deflate : NULL;
+        deflateEnd(&ctx->deflate);
+        ctx->has_deflate = 0;
+    }
+    memset(&ctx->deflate, 0, sizeof(z_stream));
+    if (deflateInit2(&ctx->deflate, params[0], Z_DEFLATED, 16 + params[1], params[2],
+                params[3]) != Z_OK)
+        return NULL;
+    memcpy(ctx->deflate_params, params, sizeof(ctx->deflate_params));
+    ctx->has_deflate = 1;
+    return &ctx->deflate;
+}
+#endif
+
+int SRB_sink_init_ctx(rb_sink_t *sink, SRB_write_f out, SRB_finish_f finish,
+        void *target, rb_file_compress_t flag, const rb_write_opts_t *opts,
+        rb_context_t *ctx){
+    rb_write_opts_t defaults;
+    if (opts == NULL){
+        SRB_write_opts_init(&defaults);
+        opts = &defaults;
+    }
+
+    memset(sink, 0, sizeof(rb_sink_t));
+    sink->out = out;
+    sink->finish = finish;
+    sink->target = target;
+    sink->ctx = ctx;
+    sink->size = opts->buffer_size > 0 ? opts->buffer_size : SRBIO_SINK_BUFF_SIZE;
+    if (sink->size < 4 * (SRBIO_LINE_MAX + 2))
+        sink->size = 4 * (SRBIO_LINE_MAX + 2);
+
+    switch (flag & SRB_COMPRESS_MASK){
+        case SRB_COMPRESS_NONE:
+            sink->codec = 'n';
+            break;
+#ifdef SRBIO_USE_ZLIB
+        case SRB_COMPRESS_GZIP: {
+            int params[4] = {
+                opts->level >= 0 ? opts->level : Z_DEFAULT_COMPRESSION,
+                opts->window_bits > 0 ? opts->window_bits : 15,
+                opts->mem_level > 0 ? opts->mem_level : 8,
+                opts->strategy >= 0 ? opts->strategy : Z_DEFAULT_STRATEGY
+            };
+            if (ctx != NULL){
+                sink->state = SRB_sink_deflate(ctx, params);
+                if (sink->state == NULL)
+                    return -999;
+                sink->codec = 'g';
+                break;
+            }
+            z_stream *strm = (z_stream*)calloc(1, sizeof(z_stream));
+            if (strm == NULL)
+                return -1;
+            // +16: gzip wrapper, readable by gzopen and gunzip
+            if (deflateInit2(strm, params[0], Z_DEFLATED, 16 + params[1], params[2],
+                        params[3]) != Z_OK){
+                free(strm);
+                return -999;
+            }
+            sink->codec = 'g';
+            sink->state = strm;
+            break;
+        }
+#endif
+#ifdef SRBIO_USE_BZIP2
+        case SRB_COMPRESS_BZIP2: {
+            bz_stream *strm = (bz_stream*)calloc(1, sizeof(bz_stream));
+            if (strm == NULL)
+                return -1;
+            int block = opts->block_size > 0 ? opts->block_size : 9;
+            int work = opts->work_factor >= 0 ? opts->work_factor : 0;
+            if (BZ2_bzCompressInit(strm, block, 0, work) != BZ_OK){
+                free(strm);
+                return -999;
+            }
+            sink->codec = 'b';
+            sink->state = strm;
+            break;
+        }
+#endif
+        default:
+            return -999;
+    }
+
+    if (sink->codec != 'n')
+        sink->osize = sink->size;
+    if (ctx != NULL){
+        sink->buffer = SRB_context_buffer(&ctx->wbuf, &ctx->wsize, sink->size);
+        if (sink->codec != 'n')
+            sink->obuf = SRB_context_buffer(&ctx->obuf, &ctx->osize, sink->osize);
+    } else {
+        sink->buffer = (char*)malloc(sink->size);
+        if (sink->codec != 'n')
+            sink->obuf = (char*)malloc(sink->osize);
+    }
+    if (sink->buffer == NULL || (sink->codec != 'n' && sink->obuf == NULL)){
+        // the target is left to the caller
+        sink->finish = NULL;
+        SRB_sink_close(sink);
+        return -1;
+    }
+    return 0;
+}
+
+// run the encoder on `len` bytes, finish the stream if `last` is set
+static int SRB_sink_encode(rb_sink_t *sink, const char *data, size_t len, int last){
+    switch (sink->codec){
+        case 'n':
+            if (len > 0 && sink->out(data, len, sink->target) != 0)
+                return -1;
+            return 0;
+#ifdef SRBIO_USE_ZLIB
+        case 'g': {
+            z_stream *strm = (z_stream*)sink->state;
+            int info;
+            strm->next_in = (Bytef*)data;
+            strm->avail_in = (uInt)len;
+            do {
+                strm->next_out = (Bytef*)sink->obuf;
+                strm->avail_out = (uInt)sink->osize;
+                info = deflate(strm, last ? Z_FINISH : Z_NO_FLUSH);
+                if (info == Z_STREAM_ERROR)
+                    return -1;
+                size_t have = sink->osize - strm->avail_out;
+                if (have > 0 && sink->out(sink->obuf, have, sink->target) != 0)
+                    return -1;
+            } while (strm->avail_out == 0 || (last && info != Z_STREAM_END));
+            return 0;
+        }
+#endif
+#ifdef SRBIO_USE_BZIP2
+        case 'b': {
+            bz_stream *strm = (bz_stream*)sink->state;
+            int info;
+            strm->next_in = (char*)data;
+            strm->avail_in = (unsigned int)len;
+            do {
+                strm->next_out = sink->obuf;
+                strm->avail_out = (unsigned int)sink->osize;
+                info = BZ2_bzCompress(strm, last ? BZ_FINISH : BZ_RUN);
+                if (info < 0)
+                    return -1;
+                size_t have = sink->osize - strm->avail_out;
+                if (have > 0 && sink->out(sink->obuf, have, sink->target) != 0)
+                    return -1;
+            } while (strm->avail_in > 0 || (last && info != BZ_STREAM_END));
+            return 0;
+        }
+#endif
+        default:
+            return -1;
+    }
+}
+
+int SRB_sink_flush(rb_sink_t *sink){
+    if (sink->len == 0 || sink->err)
+        return sink->err;
+    if (SRB_sink_encode(sink, sink->buffer, sink->len, 0) != 0)
+        sink->err = -1;
+    sink->len = 0;
+    return sink->err;
+}
+
+int SRB_sink_write(rb_sink_t *sink, const void *data, size_t len){
+    if (sink->size - sink->len < len){
+        SRB_sink_flush(sink);
+
+        // large blocks bypass the staging buffer
+        if (len >= sink->size){
+            if (!sink->err && SRB_sink_encode(sink, (const char*)data, len, 0) != 0)
+                sink->err = -1;
+            return sink->err;
+        }
+    }
+    memcpy(sink->buffer + sink->len, data, len);
+    sink->len += len;
+    return sink->err;
+}
+
+int SRB_sink_puts(rb_sink_t *sink, const char *str){
+    return SRB_sink_write(sink, str, strlen(str));
+}
+
+// finish the codec stream and close the target, returns 0 if every
+// byte was written
+int SRB_sink_close(rb_sink_t *sink){
+    if (sink->buffer != NULL){
+        SRB_sink_flush(sink);
+        if (!sink->err && sink->codec != 'n' && SRB_sink_encode(sink, NULL, 0, 1) != 0)
+            sink->err = -1;
+    }
+
+#ifdef SRBIO_USE_ZLIB
+    if (sink->codec == 'g' && sink->ctx == NULL){
+        deflateEnd((z_stream*)sink->state);
+        free(sink->state);
+    }
+#endif
+#ifdef SRBIO_USE_BZIP2
+    if (sink->codec == 'b'){
+        bz_stream *strm = (bz_stream*)sink->state;
+#ifndef NDEBUG
+        printf("BZ2: original: %u bytes; compressed: %u bytes.\n",
+                strm->total_in_lo32, strm->total_out_lo32);
+#endif
+        BZ2_bzCompressEnd(strm);
+        free(strm);
+    }
+#endif
+    sink->state = NULL;
+
+    if (sink->finish != NULL && sink->finish(sink->target) != 0)
+        sink->err = -1;
+    sink->finish = NULL;
+
+    if (sink->ctx == NULL){
+        free(sink->buffer);
+        free(sink->obuf);
+    }
+    sink->buffer = NULL;
+    sink->obuf = NULL;
+    return sink->err;
+}
@@ -0,0 +1,292 @@
+/*
+ * ===========================================================================
+ *
+ *       Filename:  source.c
+ *
+ *    Description:  buffered line source with gzip/bzip2 decoders
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 04:08:22 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Haoyang Liu (), liuhaoyang@pku.edu.cn
+ *   Organization:  BICMR, Peking University
+ *      Copyright:  Copyright (c) 2021, Haoyang Liu
+ *
+ * ===========================================================================
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "SRBio.h"
+
+#ifdef SRBIO_USE_ZLIB
+#include <zlib.h>
+#endif
+
+#ifdef SRBIO_USE_BZIP2
+#include <bzlib.h>
+#endif
+
+#include "private/source.h"
+
+long SRB_memread(void *buff, size_t size, void *p){
+    rb_memfile_t *mf = (rb_memfile_t*)p;
+    size_t n = mf->len - mf->pos;
+    if (n > size)
+        n = size;
+    memcpy(buff, mf->data + mf->pos, n);
+    mf->pos += n;
+    return (long)n;
+}
+
+int SRB_decoder_init(rb_decoder_t *dec, SRB_read_f in, void *in_ctx,
+        rb_file_compress_t flag){
+    memset(dec, 0, sizeof(rb_decoder_t));
+    dec->in = in;
+    dec->in_ctx = in_ctx;
+
+    switch (flag & SRB_COMPRESS_MASK){
+        case SRB_COMPRESS_NONE:
+            dec->codec = 'n';
+            return 0;
+#ifdef SRBIO_USE_ZLIB
+        case SRB_COMPRESS_GZIP: {
+            z_stream *strm = (z_stream*)calloc(1, sizeof(z_stream));
+            if (strm == NULL)
+                return -1;
+            // +32: detect gzip or zlib header
+            if (inflateInit2(strm, 15 + 32) != Z_OK){
+                free(strm);
+                return -1;
+            }
+            dec->codec = 'g';
+            dec->state = strm;
+            break;
+        }
+#endif
+#ifdef SRBIO_USE_BZIP2
+        case SRB_COMPRESS_BZIP2: {
+            bz_stream *strm = (bz_stream*)calloc(1, sizeof(bz_stream));
+            if (strm == NULL)
+                return -1;
+            if (BZ2_bzDecompressInit(strm, 0, 0) != BZ_OK){
+                free(strm);
+                return -1;
+            }
+            dec->codec = 'b';
+            dec->state = strm;
+            break;
+        }
+#endif
+        default:
+            return -999;
+    }
+
+    dec->isize = SRBIO_SOURCE_BUFF_SIZE;
+    dec->ibuf = (char*)malloc(dec->isize);
+    if (dec->ibuf == NULL){
+        SRB_decoder_free(dec);
+        return -1;
+    }
+    return 0;
+}
+
+// refill the input buffer once it is drained, returns bytes available
+static long SRB_decoder_fill(rb_decoder_t *dec, size_t avail, char **next){
+    if (avail > 0 || dec->in_eof)
+        return (long)avail;
+    long n = dec->in(dec->ibuf, dec->isize, dec->in_ctx);
+    if (n < 0)
+        return -1;
+    if (n == 0)
+        dec->in_eof = 1;
+    *next = dec->ibuf;
+    return n;
+}
+
+// read up to `size` decompressed bytes, 0 at the end of the stream
+long SRB_decoder_read(void *buff, size_t size, void *p){
+    rb_decoder_t *dec = (rb_decoder_t*)p;
+
+    if (dec->eof)
+        return 0;
+
+    switch (dec->codec){
+        case 'n':
+            return dec->in(buff, size, dec->in_ctx);
+#ifdef SRBIO_USE_ZLIB
+        case 'g': {
+            z_stream *strm = (z_stream*)dec->state;
+            strm->next_out = (Bytef*)buff;
+            strm->avail_out = (uInt)size;
+            while (strm->avail_out == size){
+                char *next = (char*)strm->next_in;
+                long avail = SRB_decoder_fill(dec, strm->avail_in, &next);
+                if (avail < 0)
+                    return -1;
+                strm->next_in = (Bytef*)next;
+                strm->avail_in = (uInt)avail;
+                if (avail == 0)
+                    break;
+
+                int info = inflate(strm, Z_NO_FLUSH);
+                if (info == Z_STREAM_END){
+                    // concatenated members, as written by gzip/pigz
+                    next = (char*)strm->next_in;
+                    avail = SRB_decoder_fill(dec, strm->avail_in, &next);
+                    if (avail <= 0){
+                        dec->eof = 1;
+                        break;
+                    }
+                    inflateReset(strm);
+                    strm->next_in = (Bytef*)next;
+                    strm->avail_in = (uInt)avail;
+                } else if (info != Z_OK && info != Z_BUF_ERROR){
+                    return -1;
+                }
+            }
+            return (long)(size - strm->avail_out);
+        }
+#endif
+#ifdef SRBIO_USE_BZIP2
+        case 'b': {
+            bz_stream *strm = (bz_stream*)dec->state;
+            strm->next_out = (char*)buff;
+            strm->avail_out = (unsigned int)size;
+            while (strm->avail_out == size){
+                char *next = strm->next_in;
+                long avail = SRB_decoder_fill(dec, strm->avail_in, &next);
+                if (avail < 0)
+                    return -1;
+                strm->next_in = next;
+                strm->avail_in = (unsigned int)avail;
+                if (avail == 0)
+                    break;
+
+                int info = BZ2_bzDecompress(strm);
+                if (info == BZ_STREAM_END){
+                    // concatenated streams, as written by pbzip2
+                    next = strm->next_in;
+                    avail = SRB_decoder_fill(dec, strm->avail_in, &next);
+                    if (avail <= 0){
+                        dec->eof = 1;
+                        break;
+                    }
+                    char *out = strm->next_out;
+                    unsigned int avail_out = strm->avail_out;
+                    BZ2_bzDecompressEnd(strm);
+                    memset(strm, 0, sizeof(bz_stream));
+                    if (BZ2_bzDecompressInit(strm, 0, 0) != BZ_OK)
+                        return -1;
+                    strm->next_in = next;
+                    strm->avail_in = (unsigned int)avail;
+                    strm->next_out = out;
+                    strm->avail_out = avail_out;
+                } else if (info != BZ_OK){
+                    return -1;
+                }
+            }
+            return (long)(size - strm->avail_out);
+        }
+#endif
+        default:
+            return -1;
+    }
+}
+
+void SRB_decoder_free(rb_decoder_t *dec){
+#ifdef SRBIO_USE_ZLIB
+    if (dec->codec == 'g' && dec->state != NULL){
+        inflateEnd((z_stream*)dec->state);
+        free(dec->state);
+    }
+#endif
+#ifdef SRBIO_USE_BZIP2
+    if (dec->codec == 'b' && dec->state != NULL){
+        BZ2_bzDecompressEnd((bz_stream*)dec->state);
+        free(dec->state);
+    }
+#endif
+    dec->state = NULL;
+    free(dec->ibuf);
+    dec->ibuf = NULL;
+}
+
+int SRB_source_init(rb_source_t *src, SRB_read_f read, void *ctx, size_t size){
+    memset(src, 0, sizeof(rb_source_t));
+    src->read = read;
+    src->src = ctx;
+    src->size = size > 0 ? size : SRBIO_SOURCE_BUFF_SIZE;
+    src->buffer = (char*)malloc(src->size);
+    src->owned = 1;
+    return src->buffer == NULL ? -1 : 0;
+}
+
+// as SRB_source_init with a buffer kept by the caller
+void SRB_source_init_buffer(rb_source_t *src, SRB_read_f read, void *ctx, char *buffer,
+        size_t size){
+    memset(src, 0, sizeof(rb_source_t));
+    src->read = read;
+    src->src = ctx;
+    src->buffer = buffer;
+    src->size = size;
+}
+
+// lines are served from `data` directly, nothing is copied ahead
+void SRB_source_init_mem(rb_source_t *src, const char *data, size_t len){
+    memset(src, 0, sizeof(rb_source_t));
+    src->buffer = (char*)data;
+    src->size = len;
+    src->len = len;
+    src->eof = 1;
+}
+
+// same contract as fgets: at most size - 1 chars, newline kept
+char *SRB_source_gets(char *buff, int size, void *p){
+    rb_source_t *src = (rb_source_t*)p;
+    int i = 0;
+
+    while (i < size - 1){
+        if (src->pos == src->len){
+            if (src->eof || src->err)
+                break;
+            long n = src->read(src->buffer, src->size, src->src);
+            if (n < 0){
+                src->err = 1;
+                break;
+            }
+            if (n == 0){
+                src->eof = 1;
+                break;
+            }
+            src->pos = 0;
+            src->len = (size_t)n;
+        }
+
+        size_t n = src->len - src->pos;
+        if (n > (size_t)(size - 1 - i))
+            n = size - 1 - i;
+        char *nl = (char*)memchr(src->buffer + src->pos, '\n', n);
+        if (nl != NULL)
+            n = nl - (src->buffer + src->pos) + 1;
+        memcpy(buff + i, src->buffer + src->pos, n);
+        src->pos += n;
+        i += n;
+        if (nl != NULL)
+            break;
+    }
+
+    if (i == 0)
+        return NULL;
+    buff[i] = '\0';
+    return buff;
+}
+
+void SRB_source_free(rb_source_t *src){
+    if (src->owned)
+        free(src->buffer);
+    src->buffer = NULL;
+}
@@ -0,0 +1,440 @@
+/*
+ * ===========================================================================
+ *
+ *       Filename:  uring.c
+ *
+ *    Description:  io_uring backend for uncompressed files
+ *
+ *        Version:  1.0
+ *        Created:  10/19/2026 01:15:08 PM
+ *       Revision:  none
+ *       Compiler:  gcc
+ *
+ *         Author:  Haoyang Liu (), liuhaoyang@pku.edu.cn
+ *   Organization:  BICMR, Peking University
+ *      Copyright:  Copyright (c) 2021, Haoyang Liu
+ *
+ * ===========================================================================
+ */
+
+#define _GNU_SOURCE
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+
+#include "SRBio.h"
+
+#ifdef SRBIO_USE_IO_URING
+#include <linux/io_uring.h>
+
+#include "private/wrap.h"
+
+// buffer states
+#define RB_URING_IDLE   0
+#define RB_URING_BUSY   1
+#define RB_URING_READY  2
+
+static int rb_uring_setup(rb_uring_t *ring, unsigned entries){
+    struct io_uring_params p;
+    size_t sq_len, cq_len;
+
+    memset(ring, 0, sizeof(rb_uring_t));
+    memset(&p, 0, sizeof(p));
+    ring->fd = (int)syscall(__NR_io_uring_setup, entries, &p);
+    if (ring->fd < 0)
+        return -1;
+
+    sq_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    cq_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if ((p.features & IORING_FEAT_SINGLE_MMAP) && cq_len > sq_len)
+        sq_len = cq_len;
+
+    ring->sq_ptr = mmap(NULL, sq_len, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+    if (ring->sq_ptr == MAP_FAILED)
+        goto FAILED;
+    ring->sq_len = sq_len;
+
+    if (p.features & IORING_FEAT_SINGLE_MMAP){
+        ring->cq_ptr = ring->sq_ptr;
+        ring->cq_len = 0;
+    } else {
+        ring->cq_ptr = mmap(NULL, cq_len, PROT_READ | PROT_WRITE,
+                MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+        if (ring->cq_ptr == MAP_FAILED)
+            goto FAILED;
+        ring->cq_len = cq_len;
+    }
+
+    ring->sqes = mmap(NULL, p.sq_entries * sizeof(struct io_uring_sqe),
+            PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+            ring->fd, IORING_OFF_SQES);
+    if (ring->sqes == MAP_FAILED)
+        goto FAILED;
+    ring->sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+
+    ring->sq_tail = (unsigned*)((char*)ring->sq_ptr + p.sq_off.tail);
+    ring->sq_mask = (unsigned*)((char*)ring->sq_ptr + p.sq_off.ring_mask);
+    ring->sq_array = (unsigned*)((char*)ring->sq_ptr + p.sq_off.array);
+    ring->cq_head = (unsigned*)((char*)ring->cq_ptr + p.cq_off.head);
+    ring->cq_tail = (unsigned*)((char*)ring->cq_ptr + p.cq_off.tail);
+    ring->cq_mask = (unsigned*)((char*)ring->cq_ptr + p.cq_off.ring_mask);
+    ring->cqes = (struct io_uring_cqe*)((char*)ring->cq_ptr + p.cq_off.cqes);
+    return 0;
+
+FAILED:
+    if (ring->sq_ptr != NULL && ring->sq_ptr != MAP_FAILED)
+        munmap(ring->sq_ptr, ring->sq_len);
+    if (ring->cq_len > 0 && ring->cq_ptr != MAP_FAILED)
+        munmap(ring->cq_ptr, ring->cq_len);
+    close(ring->fd);
+    return -1;
+}
+
+static void rb_uring_teardown(rb_uring_t *ring){
+    munmap(ring->sqes, ring->sqes_len);
+    if (ring->cq_len > 0)
+        munmap(ring->cq_ptr, ring->cq_len);
+    munmap(ring->sq_ptr, ring->sq_len);
+    close(ring->fd);
+}
+
+static int rb_uring_queue(rb_uring_file_t *f, int k);
+
+// set the ring up and register the buffers, once per file
+static void rb_uring_start(rb_uring_file_t *f){
+    if (f->ring_tried)
+        return;
+    f->ring_tried = 1;
+    f->has_ring = rb_uring_setup(&f->ring, SRBIO_URING_DEPTH) == 0;
+    if (f->has_ring){
+        struct iovec iov[SRBIO_URING_DEPTH];
+        for (int k = 0; k < f->depth; ++k){
+            iov[k].iov_base = f->buffers + (size_t)k * f->bsize;
+            iov[k].iov_len = f->bsize;
+        }
+        f->registered = syscall(__NR_io_uring_register, f->ring.fd,
+                IORING_REGISTER_BUFFERS, iov, f->depth) == 0;
+    }
+
+#ifndef NDEBUG
+    printf("io_uring: %s, registered buffers: %s, O_DIRECT: %s\n",
+            f->has_ring ? "on" : "off (fallback)",
+            f->registered ? "yes" : "no", f->direct ? "yes" : "no");
+#endif
+}
+
+// record the completion of buffer k: short writes are finished
+// synchronously, the rest of a short read is asked for again unless the
+// read returned 0 bytes or reached the end of the file
+static void rb_uring_complete(rb_uring_file_t *f, int k, long res){
+    if (f->mode == 'r' && res >= 0){
+        f->done[k] += res;
+        if (res > 0 && f->done[k] < f->request[k] &&
+                f->offset[k] + (off_t)f->done[k] < f->size){
+            // O_DIRECT cannot go on from an unaligned position
+            if (!(f->direct && f->done[k] % SRBIO_URING_ALIGN != 0) &&
+                    rb_uring_queue(f, k) == 0)
+                return;
+            res = -EIO;
+        } else {
+            res = (long)f->done[k];
+        }
+    }
+    if (f->mode == 'w' && res >= 0 && (size_t)res < f->request[k]){
+        char *buf = f->buffers + (size_t)k * f->bsize;
+        size_t done = res;
+        while (done < f->request[k]){
+            ssize_t ret = pwrite(f->fd, buf + done, f->request[k] - done,
+                    f->offset[k] + done);
+            if (ret <= 0)
+                break;
+            done += ret;
+        }
+        res = done < f->request[k] ? -EIO : (long)done;
+    }
+    f->result[k] = res;
+    f->state[k] = RB_URING_READY;
+}
+
+// queue what is left of the transfer of buffer k,
+// done synchronously if the ring is not available
+static int rb_uring_queue(rb_uring_file_t *f, int k){
+    char *buf = f->buffers + (size_t)k * f->bsize + f->done[k];
+    off_t off = f->offset[k] + f->done[k];
+    size_t len = f->request[k] - f->done[k];
+
+    if (!f->has_ring){
+        ssize_t ret = f->mode == 'r' ?
+            pread(f->fd, buf, len, off) : pwrite(f->fd, buf, len, off);
+        rb_uring_complete(f, k, ret < 0 ? -errno : (long)ret);
+        return 0;
+    }
+
+    rb_uring_t *ring = &f->ring;
+    unsigned tail = *ring->sq_tail;
+    unsigned idx = tail & *ring->sq_mask;
+    struct io_uring_sqe *sqe = ring->sqes + idx;
+
+    memset(sqe, 0, sizeof(struct io_uring_sqe));
+    if (f->registered){
+        sqe->opcode = f->mode == 'r' ? IORING_OP_READ_FIXED : IORING_OP_WRITE_FIXED;
+        sqe->buf_index = k;
+    } else {
+        sqe->opcode = f->mode == 'r' ? IORING_OP_READ : IORING_OP_WRITE;
+    }
+    sqe->fd = f->fd;
+    sqe->off = off;
+    sqe->addr = (unsigned long)buf;
+    sqe->len = len;
+    sqe->user_data = k;
+    ring->sq_array[idx] = idx;
+    __atomic_store_n(ring->sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+    if (syscall(__NR_io_uring_enter, ring->fd, 1, 0, 0, NULL, 0) < 0)
+        return -1;
+    return 0;
+}
+
+// start the transfer of buffer k at file offset off
+static int rb_uring_submit(rb_uring_file_t *f, int k, off_t off, size_t len){
+    if (f->depth > 1)
+        rb_uring_start(f);
+    f->offset[k] = off;
+    f->request[k] = len;
+    f->done[k] = 0;
+    f->state[k] = RB_URING_BUSY;
+    if (rb_uring_queue(f, k) != 0){
+        f->state[k] = RB_URING_IDLE;
+        return -1;
+    }
+    return 0;
+}
+
+// block until buffer k is complete, returns -1 if the transfer failed
+static int rb_uring_wait(rb_uring_file_t *f, int k){
+    rb_uring_t *ring = &f->ring;
+
+    while (f->state[k] == RB_URING_BUSY){
+        unsigned head = *ring->cq_head;
+        unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+        if (head == tail){
+            if (syscall(__NR_io_uring_enter, ring->fd, 0, 1,
+                        IORING_ENTER_GETEVENTS, NULL, 0) < 0 && errno != EINTR)
+                return -1;
+            continue;
+        }
+        struct io_uring_cqe *cqe = ring->cqes + (head & *ring->cq_mask);
+        int i = (int)cqe->user_data;
+        long res = cqe->res;
+        __atomic_store_n(ring->cq_head, head + 1, __ATOMIC_RELEASE);
+        rb_uring_complete(f, i, res);
+    }
+    return f->state[k] == RB_URING_READY && f->result[k] < 0 ? -1 : 0;
+}
+
+void *SRB_uringopen(const char *filename, const char *mode){
+    rb_uring_file_t *f;
+    struct stat st;
+    int flags, k;
+
+    f = (rb_uring_file_t*)calloc(1, sizeof(rb_uring_file_t));
+    if (f == NULL)
+        return NULL;
+
+    f->mode = strstr(mode, "r") ? 'r' : 'w';
+    f->direct = strstr(mode, "d") != NULL;
+    flags = f->mode == 'r' ? O_RDONLY : (O_WRONLY | O_CREAT | O_TRUNC);
+
+    f->fd = -1;
+    if (f->direct)
+        f->fd = open(filename, flags | O_DIRECT, 0666);
+    if (f->fd < 0){
+        // O_DIRECT is not supported by every filesystem
+        f->direct = 0;
+        f->fd = open(filename, flags, 0666);
+    }
+    if (f->fd < 0){
+        free(f);
+        return NULL;
+    }
+
+    // a ring and its buffers cost more than a small file takes to read
+    f->depth = SRBIO_URING_DEPTH;
+    f->bsize = SRBIO_URING_BUFF_SIZE;
+    if (f->mode == 'r'){
+        f->size = fstat(f->fd, &st) == 0 ? st.st_size : 0;
+        if (!f->direct && f->size < SRBIO_URING_MIN_SIZE){
+            f->depth = 1;
+            f->bsize = SRBIO_URING_SMALL_BUFF;
+            f->ring_tried = 1;
+        }
+    }
+
+    // aligned for O_DIRECT
+    if (posix_memalign((void**)&f->buffers, SRBIO_URING_ALIGN,
+                (size_t)f->depth * f->bsize) != 0){
+        close(f->fd);
+        free(f);
+        return NULL;
+    }
+
+    // keep all buffers in flight for reading, a writer falls back to
+    // synchronous pwrite if io_uring is unavailable
+    f->next = 0;
+    if (f->mode == 'r'){
+        for (k = 0; k < f->depth; ++k){
+            if (rb_uring_submit(f, k, f->next, f->bsize) != 0)
+                f->err = 1;
+            f->next += f->bsize;
+        }
+    }
+    f->cur = 0;
+    f->ipos = 0;
+    return f;
+}
+
+void SRB_uringclose(void *p){
+    SRB_uringfinish(p);
+}
+
+// close the file, returns -1 if any transfer failed
+int SRB_uringfinish(void *p){
+    rb_uring_file_t *f = (rb_uring_file_t*)p;
+    int k, ret;
+
+    if (f->mode == 'w' && !f->err){
+        // flush the tail, which may not be aligned for O_DIRECT
+        for (k = 0; k < f->depth; ++k)
+            if (rb_uring_wait(f, k) != 0)
+                f->err = 1;
+        if (f->ipos > 0){
+            char *buf = f->buffers + (size_t)f->cur * f->bsize;
+            size_t done = 0;
+            if (f->direct)
+                fcntl(f->fd, F_SETFL, fcntl(f->fd, F_GETFL) & ~O_DIRECT);
+            while (done < f->ipos){
+                ssize_t ret = pwrite(f->fd, buf + done, f->ipos - done, f->next + done);
+                if (ret <= 0){
+                    f->err = 1;
+                    break;
+                }
+                done += ret;
+            }
+        }
+    } else {
+        // drain in-flight requests before the buffers are released
+        for (k = 0; k < f->depth; ++k)
+            rb_uring_wait(f, k);
+    }
+
+    if (f->has_ring)
+        rb_uring_teardown(&f->ring);
+    if (close(f->fd) != 0)
+        f->err = 1;
+    ret = f->err ? -1 : 0;
+    free(f->buffers);
+    free(f);
+    return ret;
+}
+
+char *SRB_uringgets(char *buff, int size, void *p){
+    rb_uring_file_t *f = (rb_uring_file_t*)p;
+    int i = 0;
+
+    while (i < size - 1){
+        char *buf = f->buffers + (size_t)f->cur * f->bsize;
+
+        if (f->err || f->state[f->cur] == RB_URING_IDLE)
+            break;
+        if (rb_uring_wait(f, f->cur) != 0){
+            f->err = 1;
+            break;
+        }
+
+        // end of file
+        size_t len = f->result[f->cur];
+        if (f->ipos >= len){
+            if (len < f->bsize){
+                f->state[f->cur] = RB_URING_IDLE;
+                break;
+            }
+
+            // buffer consumed, reuse it for the next block
+            if (rb_uring_submit(f, f->cur, f->next, f->bsize) != 0)
+                f->err = 1;
+            f->next += f->bsize;
+            f->cur = (f->cur + 1) % f->depth;
+            f->ipos = 0;
+            continue;
+        }
+
+        // copy until newline or buff is full
+        size_t n = len - f->ipos;
+        if (n > (size_t)(size - 1 - i))
+            n = size - 1 - i;
+        char *nl = (char*)memchr(buf + f->ipos, '\n', n);
+        if (nl != NULL)
+            n = nl - (buf + f->ipos) + 1;
+        memcpy(buff + i, buf + f->ipos, n);
+        f->ipos += n;
+        i += n;
+        if (nl != NULL)
+            break;
+    }
+
+    if (i == 0)
+        return NULL;
+    buff[i] = '\0';
+    return buff;
+}
+
+int SRB_uringputs(const char *buff, void *p){
+    size_t len = strlen(buff);
+    return SRB_uringwrite(buff, len, p) == 0 ? (int)len : -1;
+}
+
+int SRB_uringwrite(const void *data, size_t len, void *p){
+    rb_uring_file_t *f = (rb_uring_file_t*)p;
+    const char *buff = (const char*)data;
+    size_t done = 0;
+
+    if (f->err)
+        return -1;
+
+    while (done < len){
+        char *buf = f->buffers + (size_t)f->cur * f->bsize;
+        size_t n = f->bsize - f->ipos;
+        if (n > len - done)
+            n = len - done;
+        memcpy(buf + f->ipos, buff + done, n);
+        f->ipos += n;
+        done += n;
+
+        if (f->ipos == f->bsize){
+            // hand the full buffer over and move to the next one
+            if (rb_uring_submit(f, f->cur, f->next, f->bsize) != 0){
+                f->err = 1;
+                return -1;
+            }
+            f->next += f->bsize;
+            f->cur = (f->cur + 1) % f->depth;
+            f->ipos = 0;
+            if (rb_uring_wait(f, f->cur) != 0){
+                f->err = 1;
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+#endif
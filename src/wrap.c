@@ -123,7 +123,9 @@ void *SRB_bz2open(const char *filename, const char *mode){
     rb_bzf->mode = rw;
     rb_bzf->f = fp;
     rb_bzf->bzf = bzf;
-    rb_bzf->ipos = SRBIO_BZ2_BUFF_SIZE;
+    rb_bzf->ipos = 0;
+    rb_bzf->len = 0;
+    rb_bzf->eof = 0;
     return rb_bzf;
 }
 
@@ -132,9 +134,10 @@ void SRB_bz2close(void *p){
     int info;
     rb_bzip2_file_t *rb_bzf = (rb_bzip2_file_t*)p;
 
-    if (rb_bzf->mode == 'r')
-        BZ2_bzReadClose(&info, rb_bzf->bzf);
-    else {
+    if (rb_bzf->mode == 'r'){
+        if (rb_bzf->bzf != NULL)
+            BZ2_bzReadClose(&info, rb_bzf->bzf);
+    } else {
 #ifndef NDEBUG
         unsigned int nbytes_in, nbytes_out;
         BZ2_bzWriteClose(&info, rb_bzf->bzf, 0, &nbytes_in, &nbytes_out);
@@ -148,29 +151,66 @@ void SRB_bz2close(void *p){
 }
 
 
+// refill the buffer, a stream that ends is followed by the next one of
+// the file as written by pbzip2; len is left at 0 at the end of the file
+static int SRB_bz2fill(rb_bzip2_file_t *rb_bzf){
+    int info;
+    rb_bzf->ipos = 0;
+    rb_bzf->len = 0;
+    while (rb_bzf->len == 0 && !rb_bzf->eof){
+        rb_bzf->len = BZ2_bzRead(&info, rb_bzf->bzf, rb_bzf->buffer, SRBIO_BZ2_BUFF_SIZE);
+        if (info == BZ_OK)
+            continue;
+        if (info != BZ_STREAM_END)
+            return -1;
+
+        char unused[BZ_MAX_UNUSED];
+        void *tail;
+        int ntail;
+        BZ2_bzReadGetUnused(&info, rb_bzf->bzf, &tail, &ntail);
+        memcpy(unused, tail, ntail);
+        BZ2_bzReadClose(&info, rb_bzf->bzf);
+        rb_bzf->bzf = NULL;
+
+        int c = ntail > 0 ? 0 : getc(rb_bzf->f);
+        if (c == EOF){
+            rb_bzf->eof = 1;
+            break;
+        }
+        if (ntail == 0)
+            unused[ntail++] = (char)c;
+        rb_bzf->bzf = BZ2_bzReadOpen(&info, rb_bzf->f, 0, 0, unused, ntail);
+        if (info != BZ_OK)
+            return -1;
+    }
+    return 0;
+}
+
 char *SRB_bz2gets(char *buff, int size, void *p){
-    int info, i;
+    int i;
     rb_bzip2_file_t *rb_bzf = (rb_bzip2_file_t*)p;
 
     // copy at most (size - 1) chars from rb_bzf->buffer to buff
     for (i = 0; i < size - 1; ++i, ++rb_bzf->ipos){
         // if the end of rb_bzf->buffer is reached,
         // then read another data block
-        if (rb_bzf->ipos == SRBIO_BZ2_BUFF_SIZE){
-            BZ2_bzRead(&info, rb_bzf->bzf, rb_bzf->buffer, SRBIO_BZ2_BUFF_SIZE);
-            if (info != BZ_OK && info != BZ_STREAM_END)
+        if (rb_bzf->ipos == rb_bzf->len){
+            if (SRB_bz2fill(rb_bzf) != 0)
                 return NULL;
-            rb_bzf->ipos = 0;
+            if (rb_bzf->len == 0)
+                break;
         }
 
         buff[i] = rb_bzf->buffer[rb_bzf->ipos];
         if (buff[i] == '\n' || buff[i] == '\r'){
             // discard CR/CRLF
-            while (rb_bzf->buffer[rb_bzf->ipos] == '\n' ||
-                    rb_bzf->buffer[rb_bzf->ipos] == '\r') ++rb_bzf->ipos;
+            while (rb_bzf->ipos < rb_bzf->len && (rb_bzf->buffer[rb_bzf->ipos] == '\n' ||
+                    rb_bzf->buffer[rb_bzf->ipos] == '\r')) ++rb_bzf->ipos;
             break;
         }
     }
+    if (i == 0 && rb_bzf->len == 0)
+        return NULL;
     
     // append '\0'
     buff[i] = '\0';